@@ -0,0 +1,76 @@
+/*
+ *    arenabench.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <arena.h>
+#include <multiarray.h>
+#include <catch/catch.hpp>
+
+typedef marray::trectlayout<2> layout2;
+typedef marray::tresource_allocator<double, marray::tarena> arena_allocator;
+typedef marray::tresource_allocator<double, marray::tpool> pool_allocator;
+typedef marray::tmultiarray<double, 2> heap_array2;
+typedef marray::tmultiarray<double, 2, double*, size_t, ptrdiff_t, false, layout2, arena_allocator> arena_array2;
+typedef marray::tmultiarray<double, 2, double*, size_t, ptrdiff_t, false, layout2, pool_allocator> pool_array2;
+
+/*
+Makes, touches and drops a small 2d temporary, as an expression evaluation would.
+*/
+template<typename A, typename... R>
+double
+temporary(const layout2& layout, R&... resource) {
+  A array_2(layout, typename A::allocator_type(resource...));
+  array_2(0, 0) = 1.0;
+  return array_2(0, 0);
+}
+
+TEST_CASE("Small temporaries from the heap, an arena and a pool", "[benchmark]") {
+  const size_t count = 10000;
+  layout2::index_type dims = {{4, 4}};
+  layout2 layout(dims);
+  marray::tarena arena(1 << 16);
+  marray::tpool pool;
+  double heap_sum(0.0), arena_sum(0.0), pool_sum(0.0);
+
+  BENCHMARK("global heap") {
+    heap_sum = 0.0;
+    for(size_t t = 0; t < count; ++t) {
+      heap_sum += temporary<heap_array2>(layout);
+    }
+  }
+
+  BENCHMARK("arena") {
+    arena_sum = 0.0;
+    for(size_t t = 0; t < count; ++t) {
+      marray::tarenascope scope(arena);
+      arena_sum += temporary<arena_array2>(layout, arena);
+    }
+  }
+
+  BENCHMARK("pool") {
+    pool_sum = 0.0;
+    for(size_t t = 0; t < count; ++t) {
+      pool_sum += temporary<pool_array2>(layout, pool);
+    }
+  }
+
+  REQUIRE(arena_sum == heap_sum);
+  REQUIRE(pool_sum == heap_sum);
+  REQUIRE(arena.stats().fallbacks == 0);
+  REQUIRE(pool.stats().fallbacks == 0);
+}
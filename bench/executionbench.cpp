@@ -0,0 +1,155 @@
+/*
+ *    executionbench.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <execution.h>
+#include <string>
+#include <vector>
+#include <catch/catch.hpp>
+
+typedef marray::tmultiarray<float, 2> fm_array2;
+typedef marray::trectlayout<2> layout2;
+
+namespace {
+  /*
+  Pools of 1, 2, 4 ... threads, up to and including the hardware threads.
+  */
+  std::vector<size_t>
+  thread_counts() {
+    std::vector<size_t> result;
+    const size_t most = marray::hardware_threads();
+
+    for(size_t threads = 1; threads < most; threads *= 2) {
+      result.push_back(threads);
+    }
+    result.push_back(most);
+    return result;
+  }
+}
+
+/*
+Elementwise addition, filling, a transposing copy and sums along both axes of 4096 x 4096
+arrays, on pools of each size, to show how each scales with the number of threads.
+*/
+TEST_CASE("Parallel operations from one thread to all", "[benchmark]") {
+  const size_t n = 4096;
+  layout2::index_type dims = {{n, n}};
+  fm_array2 a(layout2{dims}), b(layout2{dims}), c(layout2{dims}), d(layout2{dims});
+  std::vector<size_t> counts(thread_counts());
+
+  {
+    marray::tthreadpool pool(counts.back());
+    marray::tparallel all(pool);
+
+    marray::elementwise_fill(all, c, 0.0f);
+    marray::elementwise_fill(all, d, 0.0f);
+    pool.run(n, [&](size_t i) {
+      for(size_t j = 0; j < n; ++j) {
+        a(i, j) = static_cast<float>((i + 3 * j) % 101) * 0.01f;
+        b(i, j) = static_cast<float>((7 * i + j) % 53) * 0.02f;
+      }
+    });
+  }
+
+  for(size_t k = 0; k < counts.size(); ++k) {
+    marray::tthreadpool pool(counts[k]);
+    marray::tparallel policy(pool), deterministic(pool, true);
+    const std::string threads(" on " + std::to_string(counts[k]) + " threads");
+    auto transposed = d.transpose();
+
+    BENCHMARK("add" + threads) {
+      marray::elementwise_add(policy, c, a, b);
+    }
+
+    BENCHMARK("fill" + threads) {
+      marray::elementwise_fill(policy, c, 1.0f);
+    }
+
+    BENCHMARK("transposing copy" + threads) {
+      marray::blocked_copy(policy, a, transposed);
+    }
+
+    BENCHMARK("sum over rows" + threads) {
+      marray::sum(policy, a, 0);
+    }
+
+    BENCHMARK("sum over rows, deterministic" + threads) {
+      marray::sum(deterministic, a, 0);
+    }
+
+    BENCHMARK("sum over columns" + threads) {
+      marray::sum(policy, a, 1);
+    }
+  }
+
+  REQUIRE(d(5, 7) == a(7, 5));
+  REQUIRE(marray::sum(marray::tparallel(marray::default_pool(), true), a, 0)[9] == Approx(marray::sum(a, 0)[9]));
+}
+
+/*
+An escape time kernel over a 1024 x 1024 grid, whose cost per element ranges from one step
+to a thousand and is concentrated in a band of rows, run by parallel_for and by equal blocks
+of rows, on pools of each size.
+*/
+TEST_CASE("Parallel for over an irregular kernel from one thread to all", "[benchmark]") {
+  const size_t n = 1024;
+  layout2::index_type dims = {{n, n}};
+  marray::tmultiarray<int, 2> steps(layout2{dims});
+  std::vector<size_t> counts(thread_counts());
+
+  auto escape = [n](size_t i, size_t j) {
+    const float cx = -2.0f + 2.5f * j / n, cy = -1.25f + 2.5f * i / n;
+    float x(0.0f), y(0.0f);
+    int k(0);
+
+    for(; k < 1000 && x * x + y * y < 4.0f; ++k) {
+      const float t = x * x - y * y + cx;
+      y = 2.0f * x * y + cy;
+      x = t;
+    }
+    return k;
+  };
+
+  for(size_t k = 0; k < counts.size(); ++k) {
+    marray::tthreadpool pool(counts[k]);
+    const std::string threads(" on " + std::to_string(counts[k]) + " threads");
+
+    BENCHMARK("work stealing" + threads) {
+      marray::parallel_for(marray::tparallel(pool), steps,
+        [&escape](marray::tmultiarray<int, 2, int*, size_t, ptrdiff_t, true, marray::tboxlayout<2> >& view, const marray::tindexbox<2>& box) {
+          for(size_t i = 0; i < view.dim(0); ++i) {
+            for(size_t j = 0; j < view.dim(1); ++j) {
+              view(i, j) = escape(box.lower[0] + i, box.lower[1] + j);
+            }}
+        }, 1024);
+    }
+
+    BENCHMARK("equal blocks of rows" + threads) {
+      const size_t parts = pool.threads();
+      pool.run(parts, [&](size_t part) {
+        std::pair<size_t, size_t> range = marray::block_range(n, parts, part);
+        for(size_t i = range.first; i < range.second; ++i) {
+          for(size_t j = 0; j < n; ++j) {
+            steps(i, j) = escape(i, j);
+          }}
+      });
+    }
+  }
+
+  REQUIRE(steps(n / 2, n / 4) == escape(n / 2, n / 4));
+}
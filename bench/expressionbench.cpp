@@ -0,0 +1,102 @@
+/*
+ *    expressionbench.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <algorithm>
+#include <expression.h>
+#include <catch/catch.hpp>
+
+typedef marray::tmultiarray<double, 2> dm_array2;
+typedef marray::trectlayout<2> layout2;
+
+namespace {
+  /*
+  The same sum computed with a temporary for each operation, as operators returning arrays
+  would.
+  */
+  void
+  with_temporaries(dm_array2& c, const dm_array2& a, double x, const dm_array2& b) {
+    dm_array2 ax(a.layout());
+    const double* pa = a.begin().data();
+    for(double* p = ax.begin().data(); p != ax.end().data(); ++p, ++pa) {
+      *p = *pa * x;
+    }
+    dm_array2 sum(a.layout());
+    const double* pax = ax.begin().data();
+    const double* pb = b.begin().data();
+    for(double* p = sum.begin().data(); p != sum.end().data(); ++p, ++pax, ++pb) {
+      *p = *pax + *pb;
+    }
+    c = std::move(sum);
+  }
+}
+
+/*
+c = a * x + b over dense arrays and over transposed views, as a fused expression, with a
+temporary per operation, and as a hand written loop.
+*/
+TEST_CASE("Fused elementwise expressions", "[benchmark]") {
+  const size_t n = 1024;
+  layout2::index_type dims = {{n, n}};
+  dm_array2 a(layout2{dims}), b(layout2{dims}), c(layout2{dims}), d(layout2{dims});
+  const double x = 1.5;
+
+  for(size_t i = 0; i < n; ++i) {
+    for(size_t j = 0; j < n; ++j) {
+      a(i, j) = static_cast<double>((i * n + j) % 101);
+      b(i, j) = static_cast<double>((i + j) % 37);
+    }}
+  std::fill(c.begin().data(), c.end().data(), 0.0);
+  std::fill(d.begin().data(), d.end().data(), 0.0);
+
+  BENCHMARK("expression c = a * x + b") {
+    c = a * x + b;
+  }
+
+  BENCHMARK("temporary per operation") {
+    with_temporaries(d, a, x, b);
+  }
+
+  REQUIRE(std::equal(c.begin().data(), c.end().data(), d.begin().data()));
+
+  BENCHMARK("hand written loop") {
+    const double* pa = a.begin().data();
+    const double* pb = b.begin().data();
+    for(double* p = d.begin().data(); p != d.end().data(); ++p, ++pa, ++pb) {
+      *p = *pa * x + *pb;
+    }
+  }
+
+  REQUIRE(std::equal(c.begin().data(), c.end().data(), d.begin().data()));
+
+  auto at = a.transpose();
+  auto bt = b.transpose();
+
+  BENCHMARK("expression over transposed views") {
+    c = at * x + bt;
+  }
+
+  BENCHMARK("hand written loop over transposed views") {
+    for(size_t i = 0; i < n; ++i) {
+      for(size_t j = 0; j < n; ++j) {
+        d(i, j) = at(i, j) * x + bt(i, j);
+      }}
+  }
+
+  REQUIRE(std::equal(c.begin().data(), c.end().data(), d.begin().data()));
+}
@@ -0,0 +1,78 @@
+/*
+ *    firsttouchbench.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <multiarray.h>
+#include <parallel.h>
+#include <chrono>
+#include <iostream>
+#include <catch/catch.hpp>
+
+typedef marray::tmultiarray<double, 2> dm_array2;
+typedef marray::trectlayout<2> layout2;
+
+/*
+Parallel triad a = b + s c over the data, split between threads as first touch splits it.
+Reports the memory bandwidth it reached when given a name.
+*/
+void
+triad(const char* name, dm_array2& a, const dm_array2& b, const dm_array2& c, size_t threads) {
+  const size_t n = a.end() - a.begin();
+  double* pa = a.begin().data();
+  const double* pb = b.begin().data();
+  const double* pc = c.begin().data();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  marray::for_each_block(n, threads, marray::page_elements<double>(), [=](size_t begin, size_t end) {
+    for(size_t i = begin; i < end; ++i) {
+      pa[i] = pb[i] + 3.0 * pc[i];
+    }
+  });
+
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+  if(name) {
+    std::cout << name << ": " << 3.0 * n * sizeof(double) / seconds.count() / 1e9 << " GB/s" << std::endl;
+  }
+}
+
+TEST_CASE("Triad bandwidth after serial and first touch construction", "[benchmark]") {
+  const size_t threads = marray::hardware_threads();
+  layout2::index_type dims = {{4096, 4096}};
+  layout2 layout(dims);
+
+  {
+    dm_array2 a(layout, 0.0), b(layout, 1.0), c(layout, 2.0);
+
+    triad("serial construction", a, b, c, threads);
+    BENCHMARK("triad after serial construction") {
+      triad(nullptr, a, b, c, threads);
+    }
+    REQUIRE(a(4095, 4095) == 7.0);
+  }
+  {
+    dm_array2 a(layout, marray::tfirsttouch(threads), 0.0);
+    dm_array2 b(layout, marray::tfirsttouch(threads), 1.0);
+    dm_array2 c(layout, marray::tfirsttouch(threads), 2.0);
+
+    triad("first touch construction", a, b, c, threads);
+    BENCHMARK("triad after first touch construction") {
+      triad(nullptr, a, b, c, threads);
+    }
+    REQUIRE(a(4095, 4095) == 7.0);
+  }
+}
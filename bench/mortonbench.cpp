@@ -0,0 +1,138 @@
+/*
+ *    mortonbench.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <mortonlayout.h>
+#include <vector>
+#include <iostream>
+#include <catch/catch.hpp>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+typedef marray::trectlayout<3> rect_layout3;
+typedef marray::tmortonlayout<3> morton_layout3;
+typedef marray::tmultiarray<float, 3> fm_array3;
+typedef marray::tmultiarray<float, 3, float*, size_t, ptrdiff_t, false, morton_layout3> fz_array3;
+
+/*
+Counts last level cache misses over its lifetime where the kernel lets us, and reports them
+with the given name.
+*/
+struct cachemisses {
+  cachemisses(const char* name) : name_(name), fd_(-1) {
+#ifdef __linux__
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    if(fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  ~cachemisses() {
+#ifdef __linux__
+    if(fd_ >= 0) {
+      long long count(0);
+      ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if(read(fd_, &count, sizeof(count)) == sizeof(count)) {
+        std::cout << name_ << ": " << count << " cache misses" << std::endl;
+      }
+      close(fd_);
+      return;
+    }
+#endif
+    std::cout << name_ << ": cache miss counter unavailable" << std::endl;
+  }
+
+private:
+  const char* name_;
+  int fd_;
+};
+
+/*
+Sums the 3x3x3 neighbourhood of each of a fixed set of random points.
+*/
+template<typename A>
+float
+neighbourhoods(const A& array, const std::vector<size_t>& centres) {
+  float result(0.0f);
+
+  for(size_t p = 0; p < centres.size(); p += 3) {
+    for(size_t i = centres[p] - 1; i <= centres[p] + 1; ++i) {
+      for(size_t j = centres[p + 1] - 1; j <= centres[p + 1] + 1; ++j) {
+        for(size_t k = centres[p + 2] - 1; k <= centres[p + 2] + 1; ++k) {
+          result += array(i, j, k);
+        }}}
+  }
+  return result;
+}
+
+TEST_CASE("Neighbourhood access, Morton against row major", "[benchmark]") {
+  const size_t n = 256, points = 1 << 16;
+  rect_layout3::index_type dims = {{n, n, n}};
+
+  fm_array3 rect_3((rect_layout3(dims)));
+  fz_array3 morton_3((morton_layout3(dims)));
+
+  for(size_t i = 0; i < n; ++i) {
+    for(size_t j = 0; j < n; ++j) {
+      for(size_t k = 0; k < n; ++k) {
+        rect_3(i, j, k) = morton_3(i, j, k) = static_cast<float>((i + j + k) % 7);
+      }}}
+
+  std::vector<size_t> centres(3 * points);
+  size_t seed(12345);
+  for(size_t p = 0; p < centres.size(); ++p) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    centres[p] = 1 + (seed >> 33) % (n - 2);
+  }
+
+  float rect_sum(0.0f), morton_sum(0.0f);
+
+  {
+    cachemisses misses("row major");
+    rect_sum = neighbourhoods(rect_3, centres);
+  }
+  {
+    cachemisses misses("Morton");
+    morton_sum = neighbourhoods(morton_3, centres);
+  }
+
+  BENCHMARK("row major neighbourhoods") {
+    rect_sum = neighbourhoods(rect_3, centres);
+  }
+
+  BENCHMARK("Morton neighbourhoods") {
+    morton_sum = neighbourhoods(morton_3, centres);
+  }
+
+  REQUIRE(rect_sum == morton_sum);
+}
@@ -0,0 +1,74 @@
+/*
+ *    offsetbench.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#define CATCH_CONFIG_MAIN
+#include <multiarray.h>
+#include <catch/catch.hpp>
+
+typedef marray::tmultiarray<double, 3> dm_array3;
+typedef marray::trectlayout<3> layout3;
+
+/*
+Element access through the multiarray, by index_type and by coordinates, against
+hand-written pointer arithmetic over the same block.
+*/
+TEST_CASE("Element offset calculation", "[benchmark]") {
+  const size_t n0 = 64, n1 = 128, n2 = 128;
+  layout3::index_type dims = {{n0, n1, n2}};
+  dm_array3 array_3(layout3{dims});
+
+  double x = 0.0;
+  for(dm_array3::iterator ptr = array_3.begin(); ptr != array_3.end(); ++ptr) {
+    *ptr = x++;
+  }
+
+  double by_index = 0.0, by_coordinates = 0.0, by_pointer = 0.0;
+
+  BENCHMARK("operator()(index_type)") {
+    layout3::index_type idx;
+    by_index = 0.0;
+    for(idx[0] = 0; idx[0] < n0; ++idx[0]) {
+      for(idx[1] = 0; idx[1] < n1; ++idx[1]) {
+        for(idx[2] = 0; idx[2] < n2; ++idx[2]) {
+          by_index += array_3(idx);
+        }}}
+  }
+
+  BENCHMARK("operator()(i, j, k)") {
+    by_coordinates = 0.0;
+    for(size_t i = 0; i < n0; ++i) {
+      for(size_t j = 0; j < n1; ++j) {
+        for(size_t k = 0; k < n2; ++k) {
+          by_coordinates += array_3(i, j, k);
+        }}}
+  }
+
+  BENCHMARK("hand-written pointer arithmetic") {
+    const double* data = array_3.begin().data();
+    by_pointer = 0.0;
+    for(size_t i = 0; i < n0; ++i) {
+      for(size_t j = 0; j < n1; ++j) {
+        for(size_t k = 0; k < n2; ++k) {
+          by_pointer += data[(i * n1 + j) * n2 + k];
+        }}}
+  }
+
+  REQUIRE(by_index == by_pointer);
+  REQUIRE(by_coordinates == by_pointer);
+}
@@ -0,0 +1,95 @@
+/*
+ *    reductionbench.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <reduction.h>
+#include <catch/catch.hpp>
+
+typedef marray::tmultiarray<float, 3> fm_array3;
+typedef marray::tmultiarray<float, 2> fm_array2;
+typedef marray::trectlayout<3> layout3;
+
+/*
+Summing a (time, row, column) array over time, the leading axis, and over columns, the
+contiguous one, with each summation, against loops by coordinates in the order that keeps the
+inner loop contiguous.
+*/
+TEST_CASE("Axis reductions of a 3-D array", "[benchmark]") {
+  const size_t n0 = 512, n1 = 64, n2 = 128;
+  layout3::index_type dims = {{n0, n1, n2}};
+  fm_array3 array_3(layout3{dims});
+
+  for(size_t i = 0; i < n0; ++i) {
+    for(size_t j = 0; j < n1; ++j) {
+      for(size_t k = 0; k < n2; ++k) {
+        array_3(i, j, k) = static_cast<float>((i + 3 * j + 7 * k) % 101) * 0.01f;
+      }}}
+
+  fm_array2 over_time(marray::sum(array_3, 0)), over_columns(marray::sum(array_3, 2));
+  fm_array2 by_hand(marray::sum(array_3, 0));
+
+  BENCHMARK("over time, naive") {
+    over_time = marray::sum(array_3, 0, marray::SUM_NAIVE);
+  }
+
+  BENCHMARK("over time, pairwise") {
+    over_time = marray::sum(array_3, 0, marray::SUM_PAIRWISE);
+  }
+
+  BENCHMARK("over time, Kahan") {
+    over_time = marray::sum(array_3, 0, marray::SUM_KAHAN);
+  }
+
+  BENCHMARK("over time, by hand") {
+    std::fill(by_hand.begin().data(), by_hand.end().data(), 0.0f);
+    for(size_t i = 0; i < n0; ++i) {
+      for(size_t j = 0; j < n1; ++j) {
+        for(size_t k = 0; k < n2; ++k) {
+          by_hand(j, k) += array_3(i, j, k);
+        }}}
+  }
+
+  REQUIRE(over_time(5, 7) == Approx(by_hand(5, 7)));
+
+  BENCHMARK("over columns, naive") {
+    over_columns = marray::sum(array_3, 2, marray::SUM_NAIVE);
+  }
+
+  BENCHMARK("over columns, pairwise") {
+    over_columns = marray::sum(array_3, 2, marray::SUM_PAIRWISE);
+  }
+
+  BENCHMARK("over columns, Kahan") {
+    over_columns = marray::sum(array_3, 2, marray::SUM_KAHAN);
+  }
+
+  fm_array2 columns_by_hand(marray::sum(array_3, 2));
+
+  BENCHMARK("over columns, by hand") {
+    for(size_t i = 0; i < n0; ++i) {
+      for(size_t j = 0; j < n1; ++j) {
+        float total = 0.0f;
+        for(size_t k = 0; k < n2; ++k) {
+          total += array_3(i, j, k);
+        }
+        columns_by_hand(i, j) = total;
+      }}
+  }
+
+  REQUIRE(over_columns(5, 7) == Approx(columns_by_hand(5, 7)));
+}
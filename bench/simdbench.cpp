@@ -0,0 +1,74 @@
+/*
+ *    simdbench.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <algorithm>
+#include <functional>
+#include <array.h>
+#include <simd.h>
+#include <catch/catch.hpp>
+
+typedef marray::tarray<float> f_array;
+
+/*
+Sums and fused multiply adds of float arrays that fit in the level 2 cache, by the kernel of
+each instruction set and by std::transform through the array iterators.
+*/
+TEST_CASE("Elementwise kernels by instruction set", "[benchmark]") {
+  const size_t n = 1 << 15;
+  const size_t repeats = 200;
+  f_array a(n), b(n), c(n), to(n), expected(n);
+
+  for(size_t i = 0; i < n; ++i) {
+    a[i] = static_cast<float>(i % 101);
+    b[i] = static_cast<float>(i % 37) * 0.5f;
+    c[i] = 1.0f;
+  }
+  marray::simd_isa previous = marray::simd_active();
+
+  BENCHMARK("std::transform, a + b") {
+    for(size_t r = 0; r < repeats; ++r) {
+      std::transform(a.begin(), a.end(), b.begin(), expected.begin(), std::plus<float>());
+    }
+  }
+
+  const marray::simd_isa isas[] = { marray::SIMD_SCALAR, marray::SIMD_SSE2, marray::SIMD_AVX2, marray::SIMD_AVX512 };
+  const char* add_names[] = { "scalar add", "SSE2 add", "AVX2 add", "AVX-512 add" };
+  const char* fma_names[] = { "scalar fma", "SSE2 fma", "AVX2 fma", "AVX-512 fma" };
+
+  for(size_t k = 0; k < 4; ++k) {
+    if(isas[k] > marray::simd_supported()) {
+      continue;
+    }
+    marray::simd_use(isas[k]);
+
+    BENCHMARK(add_names[k]) {
+      for(size_t r = 0; r < repeats; ++r) {
+        marray::elementwise_add(to, a, b);
+      }
+    }
+    REQUIRE(std::equal(to.begin().data(), to.end().data(), expected.begin().data()));
+
+    BENCHMARK(fma_names[k]) {
+      for(size_t r = 0; r < repeats; ++r) {
+        marray::elementwise_fma(to, a, b, c);
+      }
+    }
+  }
+  marray::simd_use(previous);
+}
@@ -0,0 +1,77 @@
+/*
+ *    slicebench.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <multiarray.h>
+#include <catch/catch.hpp>
+
+typedef marray::tmultiarray<double, 3> dm_array3;
+typedef marray::trectlayout<3> layout3;
+
+/*
+Chained operator[] access, each call making its slice views by value, against the same walk
+through slices held in a single member that is reset on every call, as operator[] used to do,
+and against access by coordinates.
+*/
+TEST_CASE("Slicing by value", "[benchmark]") {
+  const size_t n0 = 64, n1 = 128, n2 = 128;
+  layout3::index_type dims = {{n0, n1, n2}};
+  dm_array3 array_3(layout3{dims});
+  const dm_array3& const_3(array_3);
+
+  double x = 0.0;
+  for(dm_array3::iterator ptr = array_3.begin(); ptr != array_3.end(); ++ptr) {
+    *ptr = x++;
+  }
+
+  double by_value = 0.0, by_cached = 0.0, by_coordinates = 0.0;
+
+  BENCHMARK("operator[] views by value") {
+    by_value = 0.0;
+    for(size_t i = 0; i < n0; ++i) {
+      for(size_t j = 0; j < n1; ++j) {
+        for(size_t k = 0; k < n2; ++k) {
+          by_value += const_3[i][j][k];
+        }}}
+  }
+
+  BENCHMARK("views reset in a cached member") {
+    dm_array3::slice_type plane;
+    dm_array3::slice_type::slice_type row;
+    by_cached = 0.0;
+    for(size_t i = 0; i < n0; ++i) {
+      for(size_t j = 0; j < n1; ++j) {
+        for(size_t k = 0; k < n2; ++k) {
+          plane.reset(array_3.begin() + marray::slice_stride(array_3.layout(), i), array_3.layout().slice(0));
+          row.reset(plane.begin() + marray::slice_stride(plane.layout(), j), plane.layout().slice(0));
+          by_cached += row[k];
+        }}}
+  }
+
+  BENCHMARK("operator()(i, j, k)") {
+    by_coordinates = 0.0;
+    for(size_t i = 0; i < n0; ++i) {
+      for(size_t j = 0; j < n1; ++j) {
+        for(size_t k = 0; k < n2; ++k) {
+          by_coordinates += const_3(i, j, k);
+        }}}
+  }
+
+  REQUIRE(by_value == by_coordinates);
+  REQUIRE(by_cached == by_coordinates);
+}
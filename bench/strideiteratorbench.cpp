@@ -0,0 +1,63 @@
+/*
+ *    strideiteratorbench.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <multiarray.h>
+#include <numeric>
+#include <vector>
+#include <catch/catch.hpp>
+
+typedef marray::tmultiarray<double, 2> dm_array2;
+typedef marray::trectlayout<2> layout2;
+
+/*
+Column sums of a row major matrix, through a stride iterator handed to std::accumulate and by
+hand-written index arithmetic over the same block.
+*/
+TEST_CASE("Column sums through a stride iterator", "[benchmark]") {
+  const size_t n0 = 1024, n1 = 1024;
+  layout2::index_type dims = {{n0, n1}};
+  dm_array2 array_2((layout2(dims)));
+
+  for(size_t i = 0; i < n0; ++i) {
+    for(size_t j = 0; j < n1; ++j) {
+      array_2(i, j) = static_cast<double>((i * n1 + j) % 97);
+    }}
+
+  std::vector<double> by_iterator(n1), by_index(n1);
+
+  BENCHMARK("std::accumulate over stride iterators") {
+    for(size_t j = 0; j < n1; ++j) {
+      dm_array2::axis_slice_type column(array_2.slice(1, j));
+      by_iterator[j] = std::accumulate(column.stride_begin(), column.stride_end(), 0.0);
+    }
+  }
+
+  BENCHMARK("hand-written index arithmetic") {
+    const double* data = array_2.begin().data();
+    for(size_t j = 0; j < n1; ++j) {
+      double sum = 0.0;
+      for(size_t i = 0; i < n0; ++i) {
+        sum += data[i * n1 + j];
+      }
+      by_index[j] = sum;
+    }
+  }
+
+  REQUIRE(by_iterator == by_index);
+}
@@ -0,0 +1,79 @@
+/*
+ *    subspacebench.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <multiarray.h>
+#include <catch/catch.hpp>
+
+typedef marray::tmultiarray<double, 3> dm_array3;
+typedef marray::trectlayout<3> layout3;
+typedef marray::tsubspaceiterator<double, double*, size_t, ptrdiff_t, 3> subspace3;
+
+struct tsum {
+  tsum() : total(0.0) {}
+  void operator()(double value) { total += value; }
+  double total;
+};
+
+/*
+Summing a dense array through the subspace iterator, an element and a run at a time, against
+nested loops by coordinates and a flat pointer loop over the block.
+*/
+TEST_CASE("Subspace iteration over a dense box", "[benchmark]") {
+  const size_t n0 = 64, n1 = 128, n2 = 128;
+  layout3::index_type dims = {{n0, n1, n2}};
+  dm_array3 array_3(layout3{dims});
+
+  double x = 0.0;
+  for(dm_array3::iterator ptr = array_3.begin(); ptr != array_3.end(); ++ptr) {
+    *ptr = static_cast<double>(static_cast<long>(x++) % 101);
+  }
+
+  double by_element = 0.0, by_run = 0.0, by_coordinates = 0.0, by_pointer = 0.0;
+
+  BENCHMARK("subspace iterator, element by element") {
+    by_element = 0.0;
+    for(subspace3 ptr = marray::subspace_begin(array_3), end = marray::subspace_end(array_3); ptr != end; ++ptr) {
+      by_element += *ptr;
+    }
+  }
+
+  BENCHMARK("subspace_for_each, a run at a time") {
+    by_run = marray::subspace_for_each(marray::subspace_begin(array_3), marray::subspace_end(array_3), tsum()).total;
+  }
+
+  BENCHMARK("operator()(i, j, k)") {
+    by_coordinates = 0.0;
+    for(size_t i = 0; i < n0; ++i) {
+      for(size_t j = 0; j < n1; ++j) {
+        for(size_t k = 0; k < n2; ++k) {
+          by_coordinates += array_3(i, j, k);
+        }}}
+  }
+
+  BENCHMARK("flat pointer loop") {
+    by_pointer = 0.0;
+    for(const double* ptr = array_3.begin().data(); ptr != array_3.end().data(); ++ptr) {
+      by_pointer += *ptr;
+    }
+  }
+
+  REQUIRE(by_element == by_pointer);
+  REQUIRE(by_run == by_pointer);
+  REQUIRE(by_coordinates == by_pointer);
+}
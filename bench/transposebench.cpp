@@ -0,0 +1,56 @@
+/*
+ *    transposebench.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <multiarray.h>
+#include <catch/catch.hpp>
+
+typedef marray::tmultiarray<double, 2> dm_array2;
+typedef marray::trectlayout<2> layout2;
+
+TEST_CASE("Materializing a transposed view", "[benchmark]") {
+  const size_t n = 2048;
+  layout2::index_type dims = {{n, n}};
+  dm_array2 array_2((layout2(dims)));
+
+  for(size_t i = 0; i < n; ++i) {
+    for(size_t j = 0; j < n; ++j) {
+      array_2(i, j) = static_cast<double>(i * n + j);
+    }}
+
+  marray::tmultiarray<double, 2, double*, size_t, ptrdiff_t, true, marray::trectlayoutref<2, 2> > 
+    transposed(array_2.transpose());
+  dm_array2 naive((layout2(dims)));
+
+  BENCHMARK("element by element") {
+    for(size_t i = 0; i < n; ++i) {
+      for(size_t j = 0; j < n; ++j) {
+        naive(i, j) = transposed(i, j);
+      }}
+  }
+
+  dm_array2 blocked((layout2(dims)));
+
+  BENCHMARK("materialize") {
+    blocked = materialize(array_2.transpose());
+  }
+
+  REQUIRE(naive(3, 5) == array_2(5, 3));
+  REQUIRE(blocked(3, 5) == array_2(5, 3));
+  REQUIRE(blocked(n - 1, 0) == array_2(0, n - 1));
+}
@@ -0,0 +1,216 @@
+/*
+ *    allocator.h
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace marray {
+
+  /**
+  aligned_new
+
+  Raw block of the given size from the global heap, aligned to alignment bytes, which must be a
+  power of two no smaller than a pointer.  The pointer to the underlying block is kept just in
+  front of the aligned one.  A size of zero gives a null pointer.
+  */
+  inline void*
+  aligned_new(size_t bytes, size_t alignment) {
+    if(bytes == 0) {
+      return nullptr;
+    }
+    if(bytes > size_t(-1) - alignment - sizeof(void*)) {
+      throw std::bad_alloc();
+    }
+    void* block = ::operator new(bytes + alignment + sizeof(void*));
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(block) + sizeof(void*) + alignment - 1) & ~uintptr_t(alignment - 1);
+
+    reinterpret_cast<void**>(aligned)[-1] = block;
+    return reinterpret_cast<void*>(aligned);
+  }
+
+  /**
+  aligned_delete
+
+  Gives a block from aligned_new back to the global heap.
+  */
+  inline void
+  aligned_delete(void* ptr) {
+    if(ptr) {
+      ::operator delete(static_cast<void**>(ptr)[-1]);
+    }
+  }
+
+  /**
+  taligned_allocator
+
+  Allocator handing out blocks aligned to A bytes, by default a cache line, so that the data of
+  owning arrays can be read with aligned vector loads.  A must be a power of two.
+  */
+  template<
+    typename T,
+    size_t A = 64
+  > struct taligned_allocator {
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    enum{ ALIGNMENT = A };
+
+    template<typename U>
+    struct rebind { typedef taligned_allocator<U, A> other; };
+
+    taligned_allocator() {}
+
+    template<typename U>
+    taligned_allocator(const taligned_allocator<U, A>&) {}
+
+    /**
+    allocate
+
+    Room for n objects of type T, aligned to A bytes, from the global heap.
+    */
+    T*
+    allocate(size_type n) {
+      static_assert(A >= sizeof(void*) && (A & (A - 1)) == 0, "alignment must be a power of two");
+
+      if(n > (size_type(-1) - A - sizeof(void*)) / sizeof(T)) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T*>(aligned_new(n * sizeof(T), A));
+    }
+
+    void
+    deallocate(T* ptr, size_type) {
+      aligned_delete(ptr);
+    }
+  };
+
+  template<
+    typename T,
+    typename U,
+    size_t A
+  > bool operator==(const taligned_allocator<T, A>&, const taligned_allocator<U, A>&) { return true; }
+
+  template<
+    typename T,
+    typename U,
+    size_t A
+  > bool operator!=(const taligned_allocator<T, A>&, const taligned_allocator<U, A>&) { return false; }
+
+  /**
+  construct_block
+
+  Allocates n objects from (a copy of) the allocator and default constructs them, as new T[n] 
+  would.
+  */
+  template<
+    typename A
+  > typename A::value_type*
+  construct_block(A allocator, size_t n) {
+    typedef typename A::value_type T;
+    T* result = allocator.allocate(n);
+    size_t i = 0;
+
+    try {
+      for(; i < n; ++i) {
+        ::new(static_cast<void*>(result + i)) T;
+      }
+    }
+    catch(...) {
+      while(i-- > 0) {
+        result[i].~T();
+      }
+      allocator.deallocate(result, n);
+      throw;
+    }
+    return result;
+  }
+
+  /**
+  construct_block
+
+  Allocates n objects from (a copy of) the allocator and copy constructs each from value.
+  */
+  template<
+    typename A
+  > typename A::value_type*
+  construct_block(A allocator, size_t n, const typename A::value_type& value) {
+    typedef typename A::value_type T;
+    T* result = allocator.allocate(n);
+
+    try {
+      std::uninitialized_fill(result, result + n, value);
+    }
+    catch(...) {
+      allocator.deallocate(result, n);
+      throw;
+    }
+    return result;
+  }
+
+  /**
+  tuninitialized
+
+  Asks an owning array to leave its data uninitialized, so that no page of it is touched until
+  the data is first written.  Only for types with trivial default construction.
+  */
+  struct tuninitialized {};
+
+  static const tuninitialized uninitialized = tuninitialized();
+
+  /**
+  allocate_block
+
+  Allocates n objects from (a copy of) the allocator without constructing them.
+  */
+  template<
+    typename A
+  > typename A::value_type*
+  allocate_block(A allocator, size_t n) {
+    static_assert(
+      std::is_trivially_default_constructible<typename A::value_type>::value, 
+      "only trivially constructible data may be left uninitialized");
+    return allocator.allocate(n);
+  }
+
+  /**
+  destroy_block
+
+  Destroys the n objects made by construct_block and returns their memory to the allocator.
+  */
+  template<
+    typename A
+  > void
+  destroy_block(A& allocator, typename A::value_type* ptr, size_t n) {
+    typedef typename A::value_type T;
+
+    if(ptr) {
+      for(size_t i = n; i-- > 0;) {
+        ptr[i].~T();
+      }
+      allocator.deallocate(ptr, n);
+    }
+  }
+}
@@ -0,0 +1,372 @@
+/*
+ *    arena.h
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "allocator.h"
+
+namespace marray {
+
+  /**
+  tallocstats
+
+  Counters kept by the memory resources.  allocated is the number of bytes handed out and not yet
+  given back, high_water the largest it has been, and fallbacks the number of requests the
+  resource could not serve itself and passed on to the global heap.
+  */
+  struct tallocstats {
+    tallocstats() : allocated(0), high_water(0), fallbacks(0) {}
+
+    void
+    add(size_t bytes) {
+      allocated += bytes;
+      if(allocated > high_water) {
+        high_water = allocated;
+      }
+    }
+
+    void
+    remove(size_t bytes) {
+      assert(bytes <= allocated);
+      allocated -= bytes;
+    }
+
+    size_t allocated;
+    size_t high_water;
+    size_t fallbacks;
+  };
+
+  /**
+  tarena
+
+  Bump pointer memory resource over a single block taken from the heap when the arena is made.
+  Allocation moves a pointer up the block; deallocation only moves it back when the block given
+  back is the last one handed out, other memory being recovered by reset.  Requests that do not
+  fit in what is left of the block go to the global heap and are counted as fallbacks.
+
+  Suits the short lived temporaries of a computation: make them inside a tarenascope and their
+  memory is recovered in one step when the scope ends.  An arena is not thread safe.
+  */
+  struct tarena {
+    explicit tarena(size_t capacity)
+      : begin_(static_cast<unsigned char*>(aligned_new(capacity, 64))),
+        top_(begin_),
+        end_(begin_ + capacity) {}
+
+    tarena(const tarena&) = delete;
+    tarena& operator=(const tarena&) = delete;
+
+    ~tarena() { aligned_delete(begin_); }
+
+    /**
+    allocate
+
+    Block of the given size aligned to alignment bytes, a power of two.  deallocate must be given
+    the same size and alignment.
+    */
+    void*
+    allocate(size_t bytes, size_t alignment) {
+      uintptr_t top = reinterpret_cast<uintptr_t>(top_);
+      size_t padding = ((top + alignment - 1) & ~uintptr_t(alignment - 1)) - top;
+
+      if(bytes == 0) {
+        return nullptr;
+      }
+      stats_.add(bytes);
+      if(padding > size_t(end_ - top_) || bytes > size_t(end_ - top_) - padding) {
+        ++stats_.fallbacks;
+        return aligned_new(bytes, alignment < sizeof(void*) ? sizeof(void*) : alignment);
+      }
+      unsigned char* result = top_ + padding;
+      top_ = result + bytes;
+      return result;
+    }
+
+    void
+    deallocate(void* ptr, size_t bytes, size_t) {
+      unsigned char* block = static_cast<unsigned char*>(ptr);
+
+      if(!block) {
+        return;
+      }
+      stats_.remove(bytes);
+      if(!owns(block)) {
+        aligned_delete(block);
+      }
+      else if(block + bytes == top_) {
+        top_ = block;
+      }
+    }
+
+    /**
+    owns
+
+    Whether ptr points into the arena's block, rather than to a fallback from the heap.
+    */
+    bool
+    owns(const void* ptr) const {
+      return ptr >= begin_ && ptr < end_;
+    }
+
+    /**
+    mark
+
+    The current position of the bump pointer, to be given to reset.
+    */
+    size_t
+    mark() const { return size_t(top_ - begin_); }
+
+    /**
+    reset
+
+    Moves the bump pointer back to a mark, by default the start of the block, recovering all the
+    memory handed out since.  Nothing allocated since the mark may still be in use.
+    */
+    void
+    reset(size_t mark = 0) {
+      assert(mark <= this->mark());
+      top_ = begin_ + mark;
+    }
+
+    size_t
+    capacity() const { return size_t(end_ - begin_); }
+
+    size_t
+    available() const { return size_t(end_ - top_); }
+
+    const tallocstats&
+    stats() const { return stats_; }
+
+  private:
+    unsigned char* begin_;
+    unsigned char* top_;
+    unsigned char* end_;
+    tallocstats stats_;
+  };
+
+  /**
+  tarenascope
+
+  Resets an arena, on leaving scope, to where it was when the scope was entered.  Arrays
+  drawing on the arena must be made after the scope and so destroyed before it.
+  */
+  struct tarenascope {
+    explicit tarenascope(tarena& arena) : arena_(arena), mark_(arena.mark()) {}
+
+    tarenascope(const tarenascope&) = delete;
+    tarenascope& operator=(const tarenascope&) = delete;
+
+    ~tarenascope() { arena_.reset(mark_); }
+
+  private:
+    tarena& arena_;
+    size_t mark_;
+  };
+
+  /**
+  tpool
+
+  Size class memory resource.  Requests are rounded up to a power of two of at least a cache
+  line.  New blocks are carved, as they are needed, from the end of a larger chunk taken from the
+  heap.  Blocks given back go on a free list for their size class and are handed out again
+  without touching the heap; chunks are only released when the pool is destroyed.  Requests
+  larger than the largest class, or needing more than cache line alignment, go to the global
+  heap and are counted as fallbacks.  A pool is not thread safe.
+  */
+  struct tpool {
+    enum{ MIN_BLOCK = 64 };
+
+    explicit tpool(size_t max_block = 1 << 16, size_t chunk = 1 << 20)
+      : max_block_(MIN_BLOCK), chunk_(chunk), top_(nullptr), end_(nullptr), free_(1, nullptr) {
+      while(max_block_ < max_block) {
+        max_block_ <<= 1;
+        free_.push_back(nullptr);
+      }
+    }
+
+    tpool(const tpool&) = delete;
+    tpool& operator=(const tpool&) = delete;
+
+    ~tpool() {
+      for(size_t c = 0; c < chunks_.size(); ++c) {
+        aligned_delete(chunks_[c]);
+      }
+    }
+
+    void*
+    allocate(size_t bytes, size_t alignment) {
+      if(bytes == 0) {
+        return nullptr;
+      }
+      stats_.add(bytes);
+      if(bytes > max_block_ || alignment > MIN_BLOCK) {
+        ++stats_.fallbacks;
+        return aligned_new(bytes, alignment < sizeof(void*) ? sizeof(void*) : alignment);
+      }
+      size_t c = size_class(bytes);
+      tblock* result = free_[c];
+
+      if(!result) {
+        return carve(size_t(MIN_BLOCK) << c);
+      }
+      free_[c] = result->next;
+      return result;
+    }
+
+    void
+    deallocate(void* ptr, size_t bytes, size_t alignment) {
+      if(!ptr) {
+        return;
+      }
+      stats_.remove(bytes);
+      if(bytes > max_block_ || alignment > MIN_BLOCK) {
+        aligned_delete(ptr);
+        return;
+      }
+      size_t c = size_class(bytes);
+      tblock* block = static_cast<tblock*>(ptr);
+
+      block->next = free_[c];
+      free_[c] = block;
+    }
+
+    /**
+    block_size
+
+    Size of the blocks that requests of the given size are served from.
+    */
+    size_t
+    block_size(size_t bytes) const {
+      return size_t(MIN_BLOCK) << size_class(bytes);
+    }
+
+    size_t
+    max_block() const { return max_block_; }
+
+    const tallocstats&
+    stats() const { return stats_; }
+
+  private:
+    struct tblock { tblock* next; };
+
+    size_t
+    size_class(size_t bytes) const {
+      size_t result(0);
+
+      for(size_t size = MIN_BLOCK; size < bytes; size <<= 1) {
+        ++result;
+      }
+      return result;
+    }
+
+    void*
+    carve(size_t size) {
+      if(size > size_t(end_ - top_)) {
+        size_t chunk = chunk_ > size ? chunk_ : size;
+
+        top_ = static_cast<unsigned char*>(aligned_new(chunk, MIN_BLOCK));
+        end_ = top_ + chunk;
+        chunks_.push_back(top_);
+      }
+      void* result = top_;
+      top_ += size;
+      return result;
+    }
+
+    size_t max_block_;
+    size_t chunk_;
+    unsigned char* top_;
+    unsigned char* end_;
+    std::vector<tblock*> free_;
+    std::vector<void*> chunks_;
+    tallocstats stats_;
+  };
+
+  /**
+  tresource_allocator
+
+  Allocator drawing from a memory resource R, such as a tarena or a tpool, with blocks aligned to
+  A bytes.  The resource must outlive every array using it.  Allocators compare equal when they
+  draw on the same resource.
+  */
+  template<
+    typename T,
+    typename R,
+    size_t A = 64
+  > struct tresource_allocator {
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+    typedef R resource_type;
+
+    enum{ ALIGNMENT = A };
+
+    template<typename U>
+    struct rebind { typedef tresource_allocator<U, R, A> other; };
+
+    tresource_allocator(R& resource) : resource_(&resource) {}
+
+    template<typename U>
+    tresource_allocator(const tresource_allocator<U, R, A>& rhs) : resource_(&rhs.resource()) {}
+
+    T*
+    allocate(size_type n) {
+      static_assert((A & (A - 1)) == 0, "alignment must be a power of two");
+
+      if(n > size_type(-1) / sizeof(T)) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T*>(resource_->allocate(n * sizeof(T), A));
+    }
+
+    void
+    deallocate(T* ptr, size_type n) {
+      resource_->deallocate(ptr, n * sizeof(T), A);
+    }
+
+    R&
+    resource() const { return *resource_; }
+
+  private:
+    R* resource_;
+  };
+
+  template<
+    typename T,
+    typename U,
+    typename R,
+    size_t A
+  > bool operator==(const tresource_allocator<T, R, A>& lhs, const tresource_allocator<U, R, A>& rhs) {
+    return &lhs.resource() == &rhs.resource();
+  }
+
+  template<
+    typename T,
+    typename U,
+    typename R,
+    size_t A
+  > bool operator!=(const tresource_allocator<T, R, A>& lhs, const tresource_allocator<U, R, A>& rhs) {
+    return !(lhs == rhs);
+  }
+}
@@ -18,10 +18,18 @@
  *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 #pragma once
+#include <algorithm>
+#include <utility>
 #include "arrayiterator.h"
+#include "allocator.h"
+#include "numa.h"
 
 namespace marray {
   
+  template<
+    typename E
+  > struct texpr;
+  
   template<
     typename T,
     typename PT = T*,
@@ -93,39 +101,171 @@ namespace marray {
     iterator end_;
   };
   
+  /**
+  tarray
+  
+  One dimensional array.  The owning array takes its data from the allocator A, and gives it 
+  back to the same allocator.  Weak arrays refer to data owned elsewhere.
+  */
   template<
     typename T,
     typename PT = T*,
     bool weak = false,
     typename S = size_t,
-    typename D = ptrdiff_t
+    typename D = ptrdiff_t,
+    typename A = taligned_allocator<T>
   > struct tarray : tindexeddata<T, PT, S, D> {
     typedef typename tindexeddata<T, PT, S, D>::iterator iterator;
     typedef typename tindexeddata<T, PT, S, D>::size_type size_type;
     typedef typename tindexeddata<T, PT, S, D>::value_type value_type;
     typedef typename tindexeddata<T, PT, S, D>::reference reference;
     typedef typename tindexeddata<T, PT, S, D>::const_reference const_reference;
+    typedef A allocator_type;
 
     tarray() : tindexeddata<T, PT, S> (nullptr, nullptr) {}
     
-    tarray(const tarray& rhs) : tindexeddata<T, PT, S> (rhs.begin(), rhs.end()) {}
+    /**
+    tarray
+    
+    Owning arrays are not copied implicitly; clone() makes a deep copy.
+    */
+    tarray(const tarray& rhs) = delete;
+    
+    /**
+    tarray
+    
+    Takes over the data of rhs, leaving it empty.
+    */
+    tarray(tarray&& rhs) noexcept 
+      : tindexeddata<T, PT, S> (rhs.begin(), rhs.end()), allocator_(rhs.allocator_) {
+      rhs.reset(nullptr, nullptr);
+    }
      
     tarray(iterator data, size_type n) 
       : tindexeddata<T, PT, S> (data, n) {}
     
-    tarray(size_type n) : tindexeddata<T, PT, S> (iterator(new T[n]), n) {}
+    tarray(size_type n, const allocator_type& allocator = allocator_type()) 
+      : tindexeddata<T, PT, S> (iterator(construct_block(allocator, n)), n), 
+        allocator_(allocator) {}
+    
+    /**
+    tarray
+    
+    Array of n copies of value, with its pages placed on NUMA nodes as placement asks.  Each 
+    element is a slab for SLABS placement.
+    */
+    tarray(
+      size_type n, 
+      const tnumaplacement& placement, 
+      const T& value = T(), 
+      const allocator_type& allocator = allocator_type()
+    ) : tindexeddata<T, PT, S> (
+          iterator(placed_block(allocator, n, value, placement, n, [](size_t i) { return i * sizeof(T); })), n), 
+        allocator_(allocator) {}
     
     ~tarray() {
-      delete [] this->begin().data();
+      destroy_block(allocator_, this->begin().data(), this->dim());
+    }
+    
+    tarray&
+    operator=(const tarray& rhs) = delete;
+    
+    /**
+    operator=
+    
+    Releases the array's data and takes over the data of rhs, leaving it empty.
+    */
+    tarray&
+    operator=(tarray&& rhs) noexcept {
+      tarray moved(std::move(rhs));
+      swap(moved);
+      return *this;
+    }
+    
+    /**
+    operator=
+    
+    Computes the elements of an elementwise expression into the array, which keeps its data;
+    see expression.h.
+    */
+    template<typename E>
+    tarray&
+    operator=(const texpr<E>& expr) {
+      return assign(*this, expr);
+    }
+    
+    /**
+    swap
+    
+    Exchanges data and allocators with rhs without copying any elements.
+    */
+    void
+    swap(tarray& rhs) noexcept {
+      using std::swap;
+      iterator begin(this->begin()), end(this->end());
+      
+      this->reset(rhs.begin(), rhs.end());
+      rhs.reset(begin, end);
+      swap(allocator_, rhs.allocator_);
     }
+    
+    /**
+    clone
+    
+    Deep copy of the array, with data from the same allocator.
+    */
+    tarray
+    clone() const {
+      tarray result(this->dim(), allocator_);
+      std::copy(this->begin().data(), this->end().data(), result.begin().data());
+      return result;
+    }
+    
+    /**
+    get_allocator
+    
+    The allocator that owns the array's data.
+    */
+    const allocator_type&
+    get_allocator() const { return allocator_; }
+    
+  private:
+    allocator_type allocator_;
   };
   
+  template<
+    typename T,
+    typename PT,
+    typename S,
+    typename D,
+    typename A
+  > void
+  swap(tarray<T, PT, false, S, D, A>& lhs, tarray<T, PT, false, S, D, A>& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+  
+  /**
+  numa_slabs
+  
+  The NUMA nodes holding the array's data, as ranges of elements on the same node.
+  */
   template<
     typename T,
     typename PT,
     typename S,
     typename D
-  > struct tarray<T, PT, true, S, D> : tindexeddata<T, PT, S, D> {
+  > std::vector<tnumaslab>
+  numa_slabs(const tindexeddata<T, PT, S, D>& array) {
+    return numa_slabs(array.begin().data(), array.dim(), [](size_t i) { return i * sizeof(T); });
+  }
+  
+  template<
+    typename T,
+    typename PT,
+    typename S,
+    typename D,
+    typename A
+  > struct tarray<T, PT, true, S, D, A> : tindexeddata<T, PT, S, D> {
     typedef typename tindexeddata<T, PT, S, D>::iterator iterator;
     typedef typename tindexeddata<T, PT, S, D>::const_iterator const_iterator;
     typedef typename tindexeddata<T, PT, S, D>::size_type size_type;
@@ -137,7 +277,8 @@ namespace marray {
 
     tarray(const tarray& rhs) : tindexeddata<T, PT, S, D> (rhs.begin(), rhs.end()) {}
     
-    tarray(const tarray<T, PT, false, S>& rhs) : tindexeddata<T, PT, S, D> (iterator(rhs.begin().data()), rhs.dim()) {}
+    template<typename A2>
+    tarray(const tarray<T, PT, false, S, D, A2>& rhs) : tindexeddata<T, PT, S, D> (iterator(rhs.begin().data()), rhs.dim()) {}
 
     tarray(iterator data, size_type n) 
     : tindexeddata<T, PT, S> (data, n) {}
@@ -145,6 +286,17 @@ namespace marray {
     tarray(const_iterator data, size_type n) 
     : tindexeddata<T, PT, S> (data, n) {}
 
+    /**
+    operator=
+    
+    Computes the elements of an elementwise expression into the data the array refers to.
+    */
+    template<typename E>
+    tarray&
+    operator=(const texpr<E>& expr) {
+      return assign(*this, expr);
+    }
+
   };
   
 }
@@ -18,8 +18,12 @@
  *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 #pragma once
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
 
 namespace marray {
   using std::array;
@@ -61,7 +65,7 @@ namespace marray {
   
   template<
     typename T
-  > typename T::size_type stride(const T& ptr) { return ptr.stride(); }
+  > typename T::difference_type stride(const T& ptr) { return ptr.stride(); }
   
   /**
   strides - EXPERIMENTAL
@@ -81,7 +85,7 @@ namespace marray {
     typename T
   > typename T::difference_type strides(const T& begin, const T& end) { 
     assert(stride(end) == stride(begin)); 
-    return (end - begin) / stride(begin); 
+    return end - begin; 
   }
   
   template<
@@ -197,87 +201,171 @@ namespace marray {
     pointer_type
     data() const { return IT::data(); }
   };
-  /**
-  tstrideiterator - EXPERIMENTAL
-  
-  This is an iterator in contiguous memory that skips a (given) stride
-  when iterating through an array container.
-  */
   template<
     typename IT1,
     typename IT2
-  > bool operator==(IT1 ptr1, IT2 ptr2) { return data(ptr1) == data(ptr2); }
+  > auto operator==(const IT1& ptr1, const IT2& ptr2) -> decltype(data(ptr1) == data(ptr2)) { 
+    return data(ptr1) == data(ptr2); 
+  }
   
   template<
     typename IT1,
     typename IT2
-  > bool operator!=(IT1 ptr1, IT2 ptr2) { return data(ptr1) == data(ptr2); }
+  > auto operator!=(const IT1& ptr1, const IT2& ptr2) -> decltype(data(ptr1) != data(ptr2)) { 
+    return data(ptr1) != data(ptr2); 
+  }
+  
+  /**
+  tstrideiterator
   
+  Random access iterator through contiguous memory that moves a stride of elements, fixed at 
+  run time, with every step, as along a column or the diagonal of a multiarray.  Distances are 
+  counted in steps rather than elements, so that strides() and the standard algorithms see 
+  the traversal as a sequence; iterators compared or subtracted must share a stride.  The 
+  iterator keeps the element it started at and a count of steps from it, and forms the address
+  of an element only when it is reached, so that the end of a column or of a traversal with a 
+  negative stride never points outside the data.
+  */
   template<
     typename T,
-    typename PT,
-    typename S,
-    typename D
-  > struct tstrideiterator : titerator<T, PT, S, D> {
-    typedef typename titerator<T, PT, S, D>::difference_type difference_type;
-    typedef typename titerator<T, PT, S, D>::pointer pointer;
-    typedef typename titerator<T, PT, S, D>::size_type size_type;
+    typename PT = T*,
+    typename S = size_t,
+    typename D = ptrdiff_t
+  > struct tstrideiterator {
+    typedef typename std::remove_const<T>::type value_type;
+    typedef PT pointer_type;
+    typedef PT pointer;
+    typedef T& reference;
+    typedef S size_type;
+    typedef D difference_type;
+    typedef std::random_access_iterator_tag iterator_category;
+    
+    tstrideiterator() : base_(nullptr), steps_(0), stride_(0) {}
     
-    tstrideiterator(const tstrideiterator& rhs) : _base(rhs._base), _stride(rhs._stride){}
+    tstrideiterator(PT ptr, difference_type stride = 1) : base_(ptr), steps_(0), stride_(stride) {}
     
-    tstrideiterator(const pointer base) : _base(base), _stride(1){}
+    tstrideiterator(PT base, difference_type steps, difference_type stride) 
+      : base_(base), steps_(steps), stride_(stride) {}
     
-    tstrideiterator(const pointer base, size_type stride) : _base(base), _stride(stride){}
+    /**
+    tstrideiterator
     
-    tstrideiterator() : _base(NULL), _stride(0) {}
+    Read only iterator from a writable one with the same stride.
+    */
+    template<typename U, typename PU>
+    tstrideiterator(const tstrideiterator<U, PU, S, D>& rhs) 
+      : base_(rhs.base()), steps_(rhs.steps()), stride_(rhs.stride()) {}
     
     tstrideiterator&
-    operator++() { return _base += _stride; }
+    operator++() { ++steps_; return *this; }
     
     tstrideiterator&
-    operator--() { return _base -= _stride; }
+    operator--() { --steps_; return *this; }
     
     tstrideiterator
-    operator ++(int) { 
-      tstrideiterator result(*this); ++(*this); return result; 
-    }
+    operator++(int) { tstrideiterator result(*this); ++steps_; return result; }
     
     tstrideiterator
-    operator --(int) { 
-      tstrideiterator result(*this); --(*this); return result; 
-    }
+    operator--(int) { tstrideiterator result(*this); --steps_; return result; }
     
     tstrideiterator&
-    operator+=(difference_type i) { return _base += _stride * i; }
+    operator+=(difference_type n) { steps_ += n; return *this; }
     
     tstrideiterator&
-    operator-=(difference_type i) { return _base -= _stride * i; }
+    operator-=(difference_type n) { steps_ -= n; return *this; }
     
     tstrideiterator
-    operator + (difference_type i) const { 
-      tstrideiterator result(*this); return result += i; 
-    }
+    operator+(difference_type n) const { tstrideiterator result(*this); return result += n; }
     
     tstrideiterator
-    operator - (difference_type i) const { 
-      tstrideiterator result(*this); return result -= i; 
+    operator-(difference_type n) const { tstrideiterator result(*this); return result -= n; }
+    
+    difference_type
+    operator-(const tstrideiterator& rhs) const { 
+      assert(stride_ == rhs.stride_);
+      return (stride_ ? (base_ - rhs.base_) / stride_ : 0) + (steps_ - rhs.steps_); 
     }
     
-    size_type
-    stride() const { return _stride; }
+    bool
+    operator==(const tstrideiterator& rhs) const { return *this - rhs == 0; }
+    
+    bool
+    operator!=(const tstrideiterator& rhs) const { return !(*this == rhs); }
+    
+    bool
+    operator<(const tstrideiterator& rhs) const { return *this - rhs < 0; }
+    
+    bool
+    operator>(const tstrideiterator& rhs) const { return rhs < *this; }
+    
+    bool
+    operator<=(const tstrideiterator& rhs) const { return !(rhs < *this); }
+    
+    bool
+    operator>=(const tstrideiterator& rhs) const { return !(*this < rhs); }
+    
+    reference
+    operator*() const { return base_[steps_ * stride_]; }
     
     pointer
-    data() const { return data(_base); }
+    operator->() const { return base_ + steps_ * stride_; }
+    
+    reference
+    operator[](difference_type n) const { return base_[(steps_ + n) * stride_]; }
+    
+    difference_type
+    stride() const { return stride_; }
+    
+    /**
+    base
+    
+    The element the iterator started at, from which steps() counts.
+    */
+    PT
+    base() const { return base_; }
+    
+    difference_type
+    steps() const { return steps_; }
+    
+    /**
+    data
+    
+    Address of the element the iterator refers to, which must lie within the data.
+    */
+    PT
+    data() const { return base_ + steps_ * stride_; }
     
   private:
-    pointer _base;
-    size_type _stride;    
+    PT base_;
+    difference_type steps_;
+    difference_type stride_;
   };
   
+  template<
+    typename T,
+    typename PT,
+    typename S,
+    typename D
+  > tstrideiterator<T, PT, S, D>
+  operator+(typename tstrideiterator<T, PT, S, D>::difference_type n, const tstrideiterator<T, PT, S, D>& ptr) { 
+    return ptr + n; 
+  }
+  
   /**
-  tsubspaceiterator - EXPERIMENTAL
+  tsubspaceiterator
+  
+  Forward iterator over the elements of an N dimensional strided subspace, such as a slice, a 
+  sub-box or a permuted view, given its extent and stride along each axis.  Elements are 
+  visited in storage order, lowest address first: axes with negative strides are walked 
+  backwards, the axes are sorted by decreasing stride, and neighbouring axes that together 
+  step through memory evenly are collapsed into one, so that a dense box is walked as a 
+  single run.  Incrementing advances an odometer over the collapsed axes, which moves an 
+  offset from the first element; the address is formed only for an element, so that the end 
+  iterator of a view into a larger buffer never points outside it.
   
-  Allows correct iteration on slices taken along arbitrary axes in a multiarray.
+  run() gives the number of elements from the current one to the end of the innermost axis, 
+  each run_stride() apart; subspace_for_each walks the subspace a run at a time, with a plain
+  loop inside each run.
   */
   template<
     typename T,
@@ -285,18 +373,228 @@ namespace marray {
     typename S, 
     typename D,
     size_t N
-  > struct tsubspaceiterator : titerator<T, PT, S, D> {
-    typedef array<S, N> slice_index;
+  > struct tsubspaceiterator {
+    typedef typename std::remove_const<T>::type value_type;
+    typedef PT pointer_type;
+    typedef PT pointer;
+    typedef T& reference;
+    typedef S size_type;
+    typedef D difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+    typedef array<S, N> extent_type;
+    typedef array<D, N> stride_type;
+    
+    tsubspaceiterator() : base_(nullptr), offset_(0), rank_(1), position_(0), extents_(), strides_(), index_() {}
+    
+    /**
+    tsubspaceiterator
+    
+    Iterator at the first element of the subspace starting at base.
+    */
+    tsubspaceiterator(PT base, const extent_type& extents, const stride_type& strides) 
+      : base_(base), offset_(0), rank_(0), position_(0), extents_(), strides_(), index_() {
+      array<size_type, N> order;
+      
+      stride_type forward(strides);
+      
+      for(size_type j = 0; j < N; ++j) {
+        order[j] = j;
+        if(extents[j] == 0) {
+          rank_ = 1;
+          extents_[0] = 0;
+          strides_[0] = 1;
+          return;
+        }
+        if(forward[j] < 0) {
+          base_ += difference_type(extents[j] - 1) * forward[j];
+          forward[j] = -forward[j];
+        }
+      }
+      for(size_type j = 1; j < N; ++j) {
+        for(size_type k = j; k > 0 && forward[order[k]] > forward[order[k - 1]]; --k) {
+          std::swap(order[k], order[k - 1]);
+        }
+      }
+      for(size_type j = 0; j < N; ++j) {
+        size_type axis = order[N - 1 - j];
+        
+        if(extents[axis] == 1) {
+          continue;
+        }
+        if(rank_ > 0 && forward[axis] == strides_[rank_ - 1] * difference_type(extents_[rank_ - 1])) {
+          extents_[rank_ - 1] *= extents[axis];
+        }
+        else {
+          extents_[rank_] = extents[axis];
+          strides_[rank_] = forward[axis];
+          ++rank_;
+        }
+      }
+      if(rank_ == 0) {
+        rank_ = 1;
+        extents_[0] = 1;
+        strides_[0] = 1;
+      }
+      std::reverse(extents_.begin(), extents_.begin() + rank_);
+      std::reverse(strides_.begin(), strides_.begin() + rank_);
+    }
     
-    typedef typename titerator<T, PT, S, D>::difference_type difference_type;
-    typedef typename titerator<T, PT, S, D>::pointer pointer;
-    typedef typename titerator<T, PT, S, D>::size_type size_type;
+    /**
+    end
     
-    tsubspaceiterator() { }
-    tsubspaceiterator(const tsubspaceiterator& rhs) { }
-    //tsubspaceiterator() { }
-  private:
+    Iterator one past the last element of the subspace.
+    */
+    tsubspaceiterator
+    end() const {
+      tsubspaceiterator result(*this);
+      result += size() - position_;
+      return result;
+    }
+    
+    tsubspaceiterator&
+    operator++() {
+      size_type k = rank_ - 1;
+      
+      ++position_;
+      offset_ += strides_[k];
+      while(++index_[k] == extents_[k] && k > 0) {
+        offset_ -= difference_type(extents_[k]) * strides_[k];
+        index_[k] = 0;
+        offset_ += strides_[--k];
+      }
+      return *this;
+    }
+    
+    tsubspaceiterator
+    operator++(int) { tsubspaceiterator result(*this); ++(*this); return result; }
+    
+    /**
+    operator+=
+    
+    Moves n elements on, n not negative, carrying between axes as the odometer would.
+    */
+    tsubspaceiterator&
+    operator+=(difference_type n) {
+      assert(n >= 0);
+      position_ += n;
+      for(size_type k = rank_; k-- > 0 && n > 0;) {
+        size_type total = index_[k] + n;
+        size_type carry = k > 0 ? total / extents_[k] : 0;
+        size_type index = total - carry * extents_[k];
+        
+        offset_ += (difference_type(index) - difference_type(index_[k])) * strides_[k];
+        index_[k] = index;
+        n = carry;
+      }
+      return *this;
+    }
+    
+    tsubspaceiterator
+    operator+(difference_type n) const { tsubspaceiterator result(*this); return result += n; }
+    
+    /**
+    operator==
+    
+    Iterators over the same subspace are equal when they have visited as many elements.
+    */
+    bool
+    operator==(const tsubspaceiterator& rhs) const { return position_ == rhs.position_; }
+    
+    bool
+    operator!=(const tsubspaceiterator& rhs) const { return position_ != rhs.position_; }
+    
+    reference
+    operator*() const { return base_[offset_]; }
+    
+    pointer
+    operator->() const { return data(); }
+    
+    /**
+    run
+    
+    Number of elements left on the innermost collapsed axis, the current one included.
+    */
+    size_type
+    run() const { return extents_[rank_ - 1] - index_[rank_ - 1]; }
+    
+    difference_type
+    run_stride() const { return strides_[rank_ - 1]; }
+    
+    /**
+    rank
+    
+    Number of axes left after collapsing.
+    */
+    size_type
+    rank() const { return rank_; }
+    
+    size_type
+    size() const {
+      size_type result(1);
+      
+      for(size_type k = 0; k < rank_; ++k) {
+        result *= extents_[k];
+      }
+      return result;
+    }
+    
+    size_type
+    position() const { return position_; }
+    
+    /**
+    data
+    
+    Address of the current element, which must not be the end.
+    */
+    PT
+    data() const { return base_ + offset_; }
     
+  private:
+    PT base_;
+    difference_type offset_;
+    size_type rank_;
+    size_type position_;
+    extent_type extents_;
+    stride_type strides_;
+    extent_type index_;
   };
   
+  /**
+  subspace_for_each
+  
+  Calls f on each element from begin up to end, in the order the iterators visit them, a run 
+  at a time.  Within a run of unit stride the elements are reached by a plain pointer loop.
+  */
+  template<
+    typename T,
+    typename PT,
+    typename S, 
+    typename D,
+    size_t N,
+    typename F
+  > F
+  subspace_for_each(tsubspaceiterator<T, PT, S, D, N> begin, const tsubspaceiterator<T, PT, S, D, N>& end, F f) {
+    while(begin != end) {
+      S run = begin.run();
+      
+      if(run > end.position() - begin.position()) {
+        run = end.position() - begin.position();
+      }
+      PT ptr = begin.data();
+      D stride = begin.run_stride();
+      
+      if(stride == 1) {
+        for(PT last = ptr + run; ptr != last; ++ptr) {
+          f(*ptr);
+        }
+      }
+      else {
+        for(S i = 0; i < run; ++i) {
+          f(ptr[D(i) * stride]);
+        }
+      }
+      begin += run;
+    }
+    return f;
+  }
 }
@@ -22,6 +22,8 @@
 
 #include <initializer_list>
 #include <array>
+#include <limits>
+#include <type_traits>
 #include "array.h"
 #include <iostream>
 
@@ -33,10 +35,81 @@ namespace marray {
     typename S = size_t,
     typename D = ptrdiff_t
   > struct trectlayoutref;
-  
+
+  /**
+  is_axis_order
+
+  Whether order names each of the axes 0 to N - 1 exactly once, as the order of the axes of a
+  permuted view must; an axis named twice would make the view alias its own elements.
+  */
+  template<
+    typename S,
+    size_t N
+  > bool
+  is_axis_order(const std::array<S, N>& order) {
+    std::array<bool, N> seen;
+
+    seen.fill(false);
+    for(size_t j = 0; j < N; ++j) {
+      if(order[j] >= N || seen[order[j]]) {
+        return false;
+      }
+      seen[order[j]] = true;
+    }
+    return true;
+  }
+
+  /**
+  tunroll
+
+  Compile time unrolled offset calculation.  Sums idx[K] * layout.stride<K>() over the axes
+  K..N-1 of any layout providing a stride<K>() member, so that there is no runtime loop
+  between an index and the data position it refers to.  The index may be given as an
+  index_type or as a list of coordinates.
+  */
+  template<
+    size_t K,
+    size_t N
+  > struct tunroll {
+    template<typename L>
+    static typename L::size_type
+    offset(const L& layout, const typename L::index_type& idx) {
+      return idx[K] * layout.template stride<K>() + tunroll<K + 1, N>::offset(layout, idx);
+    }
+
+    template<typename L, typename... I>
+    static typename L::size_type
+    offset(const L& layout, typename L::size_type i, I... rest) {
+      return i * layout.template stride<K>() + tunroll<K + 1, N>::offset(layout, rest...);
+    }
+
+    template<typename L, typename R>
+    static void
+    strides(const L& layout, R& result) {
+      result[K] = layout.template stride<K>();
+      tunroll<K + 1, N>::strides(layout, result);
+    }
+  };
+
+  template<
+    size_t N
+  > struct tunroll<N, N> {
+    template<typename L>
+    static typename L::size_type
+    offset(const L&, const typename L::index_type&) { return 0; }
+
+    template<typename L>
+    static typename L::size_type
+    offset(const L&) { return 0; }
+
+    template<typename L, typename R>
+    static void
+    strides(const L&, R&) {}
+  };
+
   /**
   trectlayout
-  
+
   Encapsulates the shape of a multidimensional array.  Used to determine the position of a data point,
   given a referring index.
   */
@@ -52,6 +125,7 @@ namespace marray {
     typedef std::array<S, N> index_type;
     typedef trectlayoutref<N, N, S, D> layoutref_type;
     typedef trectlayoutref<N, N - 1, S, D> slice_layout;
+    typedef layoutref_type permuted_layout;
     
     enum{ RANK = N };
     enum{ MAX_INDEX = N - 1 };
@@ -87,14 +161,41 @@ namespace marray {
     */
     size_type 
     get_stride(const index_type& idx) const {
-      size_type result(*(idx.end() - 1));         
-      typename index_type::const_reverse_iterator ptr = idx.rbegin(), iptr = index_.rbegin();
-      
-      while(++ptr != idx.rend()) {
-      result += (*ptr) * (*iptr);
-      ++iptr;
-      }
-      return result;
+      return tunroll<0, RANK>::offset(*this, idx);
+    }
+    
+    /**
+    get_stride
+    
+    As above, but taking the index as a list of coordinates, one per axis.
+    */
+    template<typename... I>
+    size_type
+    get_stride(size_type i, I... rest) const {
+      static_assert(sizeof...(I) + 1 == RANK, "get_stride needs one coordinate per axis");
+      return tunroll<0, RANK>::offset(*this, i, rest...);
+    }
+    
+    /**
+    stride
+    
+    Distance in the contiguous array block between neighbouring points along axis K.
+    */
+    template<size_t K>
+    size_type
+    stride() const {
+      return (K < MAX_INDEX) ? index_[K + 1] : 1;
+    }
+    
+    /**
+    offset
+    
+    Data position of coordinate i along the given axis, all other coordinates being 0.
+    */
+    size_type
+    offset(size_type axis, size_type i) const {
+      assert(axis < RANK);
+      return (axis < MAX_INDEX) ? i * index_[axis + 1] : i;
     }
     
     slice_layout
@@ -114,6 +215,18 @@ namespace marray {
           index_);
     }
     
+    /**
+    permute
+    
+    Layout of the same data with the axes reordered, axis j of the result being axis order[j]
+    of this layout.
+    */
+    permuted_layout
+    permute(const index_type& order) const {
+      assert(is_axis_order(order));
+      return permuted_layout(order, index_);
+    }
+    
   private:
     /**
     calculate_index
@@ -137,6 +250,72 @@ namespace marray {
     index_type index_;
   };
   
+  /**
+  slice_stride
+  
+  Data position, relative to the origin of the layout, of the slice at i along the leading axis.
+  This is linear in i for strided layouts; other layouts overload it.
+  */
+  template<
+    typename L
+  > typename L::size_type 
+  slice_stride(const L& layout, typename L::size_type i) {
+    return i * layout.template stride<0>();
+  }
+
+  /**
+  layout_strides
+  
+  The stride along each axis of a strided layout, as an array indexed by axis.
+  */
+  template<
+    typename L
+  > std::array<typename L::difference_type, L::RANK>
+  layout_strides(const L& layout) {
+    std::array<typename L::difference_type, L::RANK> result;
+    tunroll<0, L::RANK>::strides(layout, result);
+    return result;
+  }
+
+  /**
+  row_major
+  
+  Whether a layout addresses its elements densely and in row major order from data position 0,
+  so that element n in row major order is at position n.  False unless a layout says otherwise.
+  */
+  template<
+    typename L
+  > bool
+  row_major(const L&) {
+    return false;
+  }
+  
+  /**
+  row_major_strides
+  
+  Whether the strides of a strided layout are those of a dense row major array of its shape.
+  */
+  template<
+    typename L
+  > bool
+  row_major_strides(const L& layout) {
+    std::array<typename L::difference_type, L::RANK> strides(layout_strides(layout));
+    typename L::difference_type expected(1);
+    
+    for(size_t j = 0; j < L::RANK; ++j) {
+      if(layout.dim(j) == 0) {
+        return true;
+      }
+    }
+    for(size_t j = L::RANK; j-- > 0;) {
+      if(layout.dim(j) != 1 && strides[j] != expected) {
+        return false;
+      }
+      expected *= layout.dim(j);
+    }
+    return true;
+  }
+  
   /**
   trectlayout
   
@@ -154,6 +333,7 @@ namespace marray {
     typedef std::array<S, 2> index_type;
     typedef trectlayoutref<2, 2, S, D> layoutref_type;
     typedef trectlayoutref<2, 1, S, D> slice_layout;
+    typedef layoutref_type permuted_layout;
     
     enum{ RANK = 2 };
     enum{ MAX_INDEX = 1 };
@@ -190,19 +370,46 @@ namespace marray {
     */
     size_type 
     get_stride(const index_type& idx) const {
-      size_type result(*(idx.end() - 1));           
-      typename index_type::const_iterator ptr = idx.begin(), iptr = index_.begin();
-      
-      while(++ptr != idx.end()) {
-        result += (*ptr) * (*iptr);
-        ++iptr;
-      }
-      return result;
+      return tunroll<0, RANK>::offset(*this, idx);
+    }
+    
+    /**
+    get_stride
+    
+    As above, but taking the index as a list of coordinates, one per axis.
+    */
+    template<typename... I>
+    size_type
+    get_stride(size_type i, I... rest) const {
+      static_assert(sizeof...(I) + 1 == RANK, "get_stride needs one coordinate per axis");
+      return tunroll<0, RANK>::offset(*this, i, rest...);
+    }
+    
+    /**
+    stride
+    
+    Distance in the contiguous array block between neighbouring points along axis K.
+    */
+    template<size_t K>
+    size_type
+    stride() const {
+      return (K < MAX_INDEX) ? index_[K + 1] : 1;
+    }
+    
+    /**
+    offset
+    
+    Data position of coordinate i along the given axis, all other coordinates being 0.
+    */
+    size_type
+    offset(size_type axis, size_type i) const {
+      assert(axis < RANK);
+      return (axis < MAX_INDEX) ? i * index_[axis + 1] : i;
     }
     
     slice_layout
     slice(size_type i) const {
-      typename slice_layout::mapping_index_type idx;
+      typename slice_layout::index_type idx;
       
       for(size_type j = 0;j < i; ++j) {
         idx[j] = j;
@@ -215,6 +422,18 @@ namespace marray {
       return slice_layout(idx, index_);
     }
     
+    /**
+    permute
+    
+    Layout of the same data with the axes reordered, axis j of the result being axis order[j]
+    of this layout.
+    */
+    permuted_layout
+    permute(const index_type& order) const {
+      assert(is_axis_order(order));
+      return permuted_layout(order, index_);
+    }
+    
   private:
     /**
     calculate_index
@@ -241,7 +460,9 @@ namespace marray {
   trectlayoutref
   
   Encapsulates the shape of a weak array, referring requests for shape information to a parent
-  layout.
+  layout.  Axis j of the view is axis index[j] of the parent, so that a view may take a subset
+  of the parent's axes, as a slice does, or all of them in another order, as a transposed or
+  permuted view does.
   */
   template<
     size_t M,
@@ -259,27 +480,32 @@ namespace marray {
     typedef std::array<S, TOP_RANK> mapped_index_type;
     typedef trectlayout<RANK, S, D> layout_type;
     typedef trectlayoutref<TOP_RANK, RANK - 1, S, D> slice_layout;
+    typedef trectlayoutref permuted_layout;
 
-    trectlayoutref() : index_(), mapped_index_() {}
+    trectlayoutref() : index_(), mapped_index_(), strides_(), footprint_(0) {}
     
-    trectlayoutref(const index_type& index, const std::array<S, TOP_RANK>& mapped_index) 
-      : index_(index), mapped_index_(mapped_index){}
+    trectlayoutref(const index_type& index, const mapped_index_type& mapped_index) 
+      : index_(index), 
+        mapped_index_(mapped_index), 
+        strides_(calculate_strides(index, mapped_index)), 
+        footprint_(calculate_footprint()) {}
       
     size_type
     dim(size_type i) const {
-      assert(i < mapped_index_.dim());
-      return (index_[i] < mapped_index_.max_index()) ? 
-            mapped_index_[index_[i] ] / mapped_index_[index_[i] + 1] : mapped_index_.back();
+      assert(i < RANK);
+      return (index_[i] < TOP_RANK - 1) ? 
+            mapped_index_[index_[i]] / mapped_index_[index_[i] + 1] : mapped_index_[TOP_RANK - 1];
     }
     
     /**
     footprint
     
-    Counterpart to the footprint function in trectlayoutref, but does not mean exactly the same
+    Counterpart to the footprint function in trectlayout, but does not mean exactly the same
     thing.  Rather it is the index position of the end() pointer in the underlying contiguous array.
     */
     size_type
-    footprint() const { return mapped_index_[ index_[0] ] ; }
+    footprint() const { return footprint_; }
+    
     /**
     get_stride
     
@@ -288,18 +514,46 @@ namespace marray {
     */
     size_type
     get_stride(const index_type& idx) const {
-      size_type result(0);
-      typename index_type::const_iterator ptr = idx.begin(), iptr = index_.begin();
-      
-      while(ptr != idx.end()) {
-        result += (*ptr) * (mapped_index_[*iptr]); //FIXME - need to increment some ptr here.
-      }
-      return result;
+      return tunroll<0, RANK>::offset(*this, idx);
+    }
+    
+    /**
+    get_stride
+    
+    As above, but taking the index as a list of coordinates, one per axis.
+    */
+    template<typename... I>
+    size_type
+    get_stride(size_type i, I... rest) const {
+      static_assert(sizeof...(I) + 1 == RANK, "get_stride needs one coordinate per axis");
+      return tunroll<0, RANK>::offset(*this, i, rest...);
+    }
+    
+    /**
+    stride
+    
+    Distance in the underlying contiguous block between neighbouring points along axis K.
+    */
+    template<size_t K>
+    size_type
+    stride() const {
+      return strides_[K];
+    }
+    
+    /**
+    offset
+    
+    Data position of coordinate i along the given axis, all other coordinates being 0.
+    */
+    size_type
+    offset(size_type axis, size_type i) const {
+      assert(axis < RANK);
+      return i * strides_[axis];
     }
     
     slice_layout
     slice(size_type i) const {
-      typename slice_layout::mapping_index_type idx;
+      typename slice_layout::index_type idx;
       
       for(size_type j = 0; j < i; ++j) {
         idx[j] = index_[j];
@@ -312,6 +566,23 @@ namespace marray {
       return slice_layout(idx, mapped_index_);
     }
     
+    /**
+    permute
+    
+    Layout of the same data with the axes reordered, axis j of the result being axis order[j]
+    of this layout.
+    */
+    permuted_layout
+    permute(const index_type& order) const {
+      index_type idx;
+      
+      assert(is_axis_order(order));
+      for(size_type j = 0; j < RANK; ++j) {
+        idx[j] = index_[order[j]];
+      }
+      return permuted_layout(idx, mapped_index_);
+    }
+    
     /**
     layout
     
@@ -320,16 +591,51 @@ namespace marray {
     */
     layout_type
     layout() const {
-      layout_type result;
-      /*
-      TODO - calculate the correct fixed strides given reference strides.
-      */
-      return result;
+      typename layout_type::index_type dims;
+      
+      for(size_type j = 0; j < RANK; ++j) {
+        dims[j] = dim(j);
+      }
+      return layout_type(dims);
     }
     
   private:
+    /**
+    calculate_strides
+    Look up the stride of each referred axis in the parent's index, so that get_stride does not
+    have to.
+    */
+    static index_type
+    calculate_strides(const index_type& index, const mapped_index_type& mapped_index) {
+      index_type result;
+      
+      for(size_type j = 0; j < RANK; ++j) {
+        result[j] = (index[j] < TOP_RANK - 1) ? mapped_index[index[j] + 1] : 1;
+      }
+      return result;
+    }
+    
+    /**
+    calculate_footprint
+    One past the furthest data position the view reaches.
+    */
+    size_type
+    calculate_footprint() const {
+      size_type result(1);
+      
+      for(size_type j = 0; j < RANK; ++j) {
+        if(dim(j) == 0) {
+          return 0;
+        }
+        result += (dim(j) - 1) * strides_[j];
+      }
+      return result;
+    }
+    
     index_type index_;
     mapped_index_type mapped_index_;
+    index_type strides_;
+    size_type footprint_;
   };
   
   template<
@@ -347,28 +653,31 @@ namespace marray {
     typedef array<S, TOP_RANK> mapped_index_type;
     typedef trectlayout<RANK, S, D> layout_type;
     typedef trectlayoutref<M, RANK - 1, S, D> slice_layout;
+    typedef trectlayoutref permuted_layout;
 
-    trectlayoutref() : index_(), mapped_index_() {}
+    trectlayoutref() : index_(), mapped_index_(), strides_(), footprint_(0) {}
     
     trectlayoutref(const index_type& index, const mapped_index_type& mapped_index) 
-      : index_(index), mapped_index_(mapped_index){}
-
-    
+      : index_(index), 
+        mapped_index_(mapped_index), 
+        strides_(calculate_strides(index, mapped_index)), 
+        footprint_(calculate_footprint()) {}
+      
     size_type
     dim(size_type i) const {
-      assert(i < mapped_index_.size());
-      return (index_[i] < mapped_index_.size() - 1) ? 
-            mapped_index_[ index_[i] ] / mapped_index_[ index_[i] + 1 ] : mapped_index_.back();
+      assert(i < RANK);
+      return (index_[i] < TOP_RANK - 1) ? 
+            mapped_index_[index_[i]] / mapped_index_[index_[i] + 1] : mapped_index_[TOP_RANK - 1];
     }
-
+    
     /**
     footprint
     
-    Counterpart to the footprint function in trectlayoutref, but does not mean exactly the same
+    Counterpart to the footprint function in trectlayout, but does not mean exactly the same
     thing.  Rather it is the index position of the end() pointer in the underlying contiguous array.
     */
     size_type
-    footprint() const { return mapped_index_[ index_[0] ] ; }
+    footprint() const { return footprint_; }
     
     /**
     get_stride
@@ -378,13 +687,41 @@ namespace marray {
     */
     size_type
     get_stride(const index_type& idx) const {
-      size_type result(0);
-      typename index_type::const_iterator ptr = idx.begin(), iptr = index_.begin();
-      
-      while(ptr != idx.end()) {
-        result += (*ptr) * (mapped_index_[*iptr]);
-      }
-      return result;
+      return tunroll<0, RANK>::offset(*this, idx);
+    }
+    
+    /**
+    get_stride
+    
+    As above, but taking the index as a list of coordinates, one per axis.
+    */
+    template<typename... I>
+    size_type
+    get_stride(size_type i, I... rest) const {
+      static_assert(sizeof...(I) + 1 == RANK, "get_stride needs one coordinate per axis");
+      return tunroll<0, RANK>::offset(*this, i, rest...);
+    }
+    
+    /**
+    stride
+    
+    Distance in the underlying contiguous block between neighbouring points along axis K.
+    */
+    template<size_t K>
+    size_type
+    stride() const {
+      return strides_[K];
+    }
+    
+    /**
+    offset
+    
+    Data position of coordinate i along the given axis, all other coordinates being 0.
+    */
+    size_type
+    offset(size_type axis, size_type i) const {
+      assert(axis < RANK);
+      return i * strides_[axis];
     }
     
     slice_layout
@@ -392,16 +729,33 @@ namespace marray {
       typename slice_layout::index_type idx;
       
       for(size_type j = 0; j < i; ++j) {
-        idx[j] = j;
+        idx[j] = index_[j];
       }
       
-      for(size_type j = i + 1;j < RANK; ++j) {
-        idx[j-1] = j;
+      for(size_type j = i + 1; j < RANK; ++j) {
+        idx[j - 1] = index_[j];
       }
       
       return slice_layout(idx, mapped_index_);
     }
     
+    /**
+    permute
+    
+    Layout of the same data with the axes reordered, axis j of the result being axis order[j]
+    of this layout.
+    */
+    permuted_layout
+    permute(const index_type& order) const {
+      index_type idx;
+      
+      assert(is_axis_order(order));
+      for(size_type j = 0; j < RANK; ++j) {
+        idx[j] = index_[order[j]];
+      }
+      return permuted_layout(idx, mapped_index_);
+    }
+    
     /**
     layout
     
@@ -410,15 +764,940 @@ namespace marray {
     */
     layout_type
     layout() const {
-      layout_type result;
-      /*
-      TODO - calculate the correct fixed strides given reference strides.
-      */
-      return result;
+      typename layout_type::index_type dims;
+      
+      for(size_type j = 0; j < RANK; ++j) {
+        dims[j] = dim(j);
+      }
+      return layout_type(dims);
     }
     
   private:
+    /**
+    calculate_strides
+    Look up the stride of each referred axis in the parent's index, so that get_stride does not
+    have to.
+    */
+    static index_type
+    calculate_strides(const index_type& index, const mapped_index_type& mapped_index) {
+      index_type result;
+      
+      for(size_type j = 0; j < RANK; ++j) {
+        result[j] = (index[j] < TOP_RANK - 1) ? mapped_index[index[j] + 1] : 1;
+      }
+      return result;
+    }
+    
+    /**
+    calculate_footprint
+    One past the furthest data position the view reaches.
+    */
+    size_type
+    calculate_footprint() const {
+      size_type result(1);
+      
+      for(size_type j = 0; j < RANK; ++j) {
+        if(dim(j) == 0) {
+          return 0;
+        }
+        result += (dim(j) - 1) * strides_[j];
+      }
+      return result;
+    }
+    
     index_type index_;
     mapped_index_type mapped_index_;
+    index_type strides_;
+    size_type footprint_;
+  };
+  
+  /**
+  dynamic_extent
+  
+  Marks an axis of a textents whose dimension is only known at run time.
+  */
+  const size_t dynamic_extent = static_cast<size_t>(-1);
+  
+  /**
+  textents
+  
+  Compile time description of the dimensions of a hypercube.  Each extent is either a
+  fixed dimension or dynamic_extent, in which case the dimension is supplied at run time.
+  */
+  template<
+    size_t... E
+  > struct textents;
+  
+  template<
+  > struct textents<> {
+    enum{ RANK = 0 };
+    enum{ RANK_DYNAMIC = 0 };
+    
+    static constexpr size_t
+    static_extent(size_t) { return 0; }
+    
+    static constexpr size_t
+    dynamic_index(size_t) { return 0; }
+  };
+  
+  template<
+    size_t E0,
+    size_t... E
+  > struct textents<E0, E...> {
+    typedef textents<E...> tail_type;
+    
+    enum{ RANK = 1 + sizeof...(E) };
+    enum{ RANK_DYNAMIC = (E0 == dynamic_extent ? 1 : 0) + tail_type::RANK_DYNAMIC };
+    
+    /**
+    static_extent
+    
+    The fixed dimension along axis i, or dynamic_extent.
+    */
+    static constexpr size_t
+    static_extent(size_t i) { return i == 0 ? E0 : tail_type::static_extent(i - 1); }
+    
+    /**
+    dynamic_index
+    
+    Position of axis i amongst the dynamic axes, ie the number of dynamic axes before it.
+    */
+    static constexpr size_t
+    dynamic_index(size_t i) { 
+      return i == 0 ? 0 : (E0 == dynamic_extent ? 1 : 0) + tail_type::dynamic_index(i - 1); 
+    }
   };
+  
+  /**
+  tproduct
+  
+  Compile time unrolled product of layout.extent<K>() over the axes K..N-1.
+  */
+  template<
+    size_t K,
+    size_t N
+  > struct tproduct {
+    template<typename L>
+    static typename L::size_type
+    of(const L& layout) {
+      return layout.template extent<K>() * tproduct<K + 1, N>::of(layout);
+    }
+  };
+  
+  template<
+    size_t N
+  > struct tproduct<N, N> {
+    template<typename L>
+    static typename L::size_type
+    of(const L&) { return 1; }
+  };
+  
+  /**
+  tdynamicextents
+  
+  Storage for the run time dimensions of a tstaticlayout.  Empty when there are none.
+  */
+  template<
+    typename S,
+    size_t N
+  > struct tdynamicextents {
+  protected:
+    tdynamicextents() : extents_() {}
+    
+    S
+    dynamic(size_t i) const { return extents_[i]; }
+    
+    void
+    dynamic(size_t i, S extent) { extents_[i] = extent; }
+    
+  private:
+    std::array<S, N> extents_;
+  };
+  
+  template<
+    typename S
+  > struct tdynamicextents<S, 0> {
+  protected:
+    S
+    dynamic(size_t) const { return 0; }
+    
+    void
+    dynamic(size_t, S) {}
+  };
+  
+  /**
+  tstaticlayout
+  
+  Row major layout whose dimensions are wholly or partly fixed at compile time by a textents.
+  Fixed dimensions are never stored, so dim, footprint and get_stride reduce to constants
+  when all of them are fixed, and the layout is then an empty class.
+  */
+  template<
+    typename E,
+    typename S = size_t,
+    typename D = ptrdiff_t
+  > struct tstaticlayout : tdynamicextents<S, E::RANK_DYNAMIC> {
+    
+    typedef S size_type;
+    typedef D difference_type;
+    typedef E extents_type;
+    typedef std::array<S, E::RANK> index_type;
+    typedef tstaticlayout<typename E::tail_type, S, D> slice_layout;
+    
+    enum{ RANK = E::RANK };
+    enum{ MAX_INDEX = E::RANK - 1 };
+    enum{ RANK_DYNAMIC = E::RANK_DYNAMIC };
+    
+    tstaticlayout() {}
+    
+    /**
+    tstaticlayout
+    
+    Takes the dimensions along every axis.  Those fixed by the extents must agree.
+    */
+    tstaticlayout(const index_type& dimensions) {
+      for(size_type j = 0; j < RANK; ++j) {
+        if(E::static_extent(j) == dynamic_extent) {
+          this->dynamic(E::dynamic_index(j), dimensions[j]);
+        }
+        else {
+          assert(E::static_extent(j) == dimensions[j]);
+        }
+      }
+    }
+    
+    size_type
+    dim(size_type i) const {
+      assert(i < RANK);
+      return (E::static_extent(i) != dynamic_extent) ? 
+            E::static_extent(i) : this->dynamic(E::dynamic_index(i));
+    }
+    
+    /**
+    extent
+    
+    As dim, for an axis known at compile time.
+    */
+    template<size_t K>
+    size_type
+    extent() const {
+      return (E::static_extent(K) != dynamic_extent) ?
+            E::static_extent(K) : this->dynamic(E::dynamic_index(K));
+    }
+    
+    /**
+    footprint
+    
+    Number of elements in the array.
+    */
+    size_type
+    footprint() const {
+      return tproduct<0, RANK>::of(*this);
+    }
+    
+    /**
+    get_stride
+    
+    Calculate the data position implied by idx in the contiguous array block.  This is a 'stride'
+    into the data from the data origin.
+    */
+    size_type 
+    get_stride(const index_type& idx) const {
+      return tunroll<0, RANK>::offset(*this, idx);
+    }
+    
+    /**
+    get_stride
+    
+    As above, but taking the index as a list of coordinates, one per axis.
+    */
+    template<typename... I>
+    size_type
+    get_stride(size_type i, I... rest) const {
+      static_assert(sizeof...(I) + 1 == RANK, "get_stride needs one coordinate per axis");
+      return tunroll<0, RANK>::offset(*this, i, rest...);
+    }
+    
+    /**
+    stride
+    
+    Distance in the contiguous array block between neighbouring points along axis K.
+    */
+    template<size_t K>
+    size_type
+    stride() const {
+      return tproduct<K + 1, RANK>::of(*this);
+    }
+    
+    /**
+    offset
+    
+    Data position of coordinate i along the given axis, all other coordinates being 0.
+    */
+    size_type
+    offset(size_type axis, size_type i) const {
+      assert(axis < RANK);
+      for(size_type j = axis + 1; j < RANK; ++j) {
+        i *= dim(j);
+      }
+      return i;
+    }
+    
+    /**
+    slice
+    
+    Layout with the leading axis fixed.  Only the leading axis can be sliced, as that is the
+    only slice which is itself a packed static layout.
+    */
+    slice_layout
+    slice(size_type i) const {
+      assert(i == 0);
+      typename slice_layout::index_type idx;
+      
+      for(size_type j = 1; j < RANK; ++j) {
+        idx[j - 1] = dim(j);
+      }
+      return slice_layout(idx);
+    }
+  };
+  
+  /**
+  tpermutedlayout
+  
+  Layout whose axes are laid out in storage in an arbitrary order.  The order lists the axes from
+  the slowest varying in storage to the fastest, so that {0, 1, ..., N - 1} is the row major
+  layout of trectlayout and {N - 1, ..., 1, 0} is the column major layout of Fortran.  Indexing 
+  is always by the logical axes, whatever the storage order.
+  */
+  template<
+    size_t N,
+    typename S = size_t,
+    typename D = ptrdiff_t
+  > struct tpermutedlayout {
+    
+    typedef S size_type;
+    typedef D difference_type;
+    typedef std::array<S, N> index_type;
+    typedef tpermutedlayout<N - 1, S, D> slice_layout;
+    typedef tpermutedlayout permuted_layout;
+    
+    enum{ RANK = N };
+    enum{ MAX_INDEX = N - 1 };
+    
+    tpermutedlayout() : dims_(), strides_() {}
+    
+    tpermutedlayout(const index_type& dimensions, const index_type& order) 
+      : dims_(dimensions), strides_(calculate_strides(dimensions, order)) {}
+    
+    /**
+    column_major
+    
+    The layout with the first axis fastest varying in storage.
+    */
+    static tpermutedlayout
+    column_major(const index_type& dimensions) {
+      index_type order;
+      
+      for(size_type j = 0; j < RANK; ++j) {
+        order[j] = MAX_INDEX - j;
+      }
+      return tpermutedlayout(dimensions, order);
+    }
+    
+    size_type
+    dim(size_type i) const {
+      assert(i < RANK);
+      return dims_[i];
+    }
+    
+    /**
+    footprint
+    
+    Extent of the underlying contiguous block that the layout addresses.  For a complete 
+    layout this is the number of elements in the array; for a slice it is the index position 
+    of the end() pointer, as with trectlayoutref.
+    */
+    size_type
+    footprint() const {
+      size_type result(1);
+      
+      for(size_type j = 0; j < RANK; ++j) {
+        if(dims_[j] == 0) {
+          return 0;
+        }
+        result += (dims_[j] - 1) * strides_[j];
+      }
+      return result;
+    }
+    
+    /**
+    get_stride
+    
+    Calculate the data position implied by idx in the contiguous array block.  This is a 'stride'
+    into the data from the data origin.
+    */
+    size_type 
+    get_stride(const index_type& idx) const {
+      return tunroll<0, RANK>::offset(*this, idx);
+    }
+    
+    /**
+    get_stride
+    
+    As above, but taking the index as a list of coordinates, one per axis.
+    */
+    template<typename... I>
+    size_type
+    get_stride(size_type i, I... rest) const {
+      static_assert(sizeof...(I) + 1 == RANK, "get_stride needs one coordinate per axis");
+      return tunroll<0, RANK>::offset(*this, i, rest...);
+    }
+    
+    /**
+    stride
+    
+    Distance in the contiguous array block between neighbouring points along axis K.
+    */
+    template<size_t K>
+    size_type
+    stride() const {
+      return strides_[K];
+    }
+    
+    /**
+    offset
+    
+    Data position of coordinate i along the given axis, all other coordinates being 0.
+    */
+    size_type
+    offset(size_type axis, size_type i) const {
+      assert(axis < RANK);
+      return i * strides_[axis];
+    }
+    
+    /**
+    slice
+    
+    Layout with axis i fixed.  The remaining axes keep their strides.
+    */
+    slice_layout
+    slice(size_type i) const {
+      slice_layout result;
+      
+      for(size_type j = 0; j < i; ++j) {
+        result.dims_[j] = dims_[j];
+        result.strides_[j] = strides_[j];
+      }
+      
+      for(size_type j = i + 1; j < RANK; ++j) {
+        result.dims_[j - 1] = dims_[j];
+        result.strides_[j - 1] = strides_[j];
+      }
+      return result;
+    }
+    
+    /**
+    permute
+    
+    Layout of the same data with the axes reordered, axis j of the result being axis order[j]
+    of this layout.
+    */
+    permuted_layout
+    permute(const index_type& order) const {
+      permuted_layout result;
+      
+      assert(is_axis_order(order));
+      for(size_type j = 0; j < RANK; ++j) {
+        result.dims_[j] = dims_[order[j]];
+        result.strides_[j] = strides_[order[j]];
+      }
+      return result;
+    }
+    
+  private:
+    template<size_t, typename, typename> friend struct tpermutedlayout;
+    
+    /**
+    calculate_strides
+    Calculate the stride of each axis from the dimensions, taking the axes in storage order.
+    */
+    static index_type
+    calculate_strides(const index_type& dimensions, const index_type& order) {
+      index_type result;
+      size_type stride(1);
+      
+      assert(is_axis_order(order));
+      for(size_type j = RANK; j-- > 0;) {
+        result[order[j]] = stride;
+        stride *= dimensions[order[j]];
+      }
+      return result;
+    }
+    
+    index_type dims_;
+    index_type strides_;
+  };
+  
+  /**
+  tpaddedlayout
+  
+  Row major layout whose innermost rows are padded out to a multiple of a given alignment, so 
+  that every row starts on an aligned boundary when the data block itself is aligned.  The 
+  alignment is counted in elements, eg 64 / sizeof(double) for rows of doubles on 64 byte cache 
+  lines.  dim reports the logical shape and footprint the padded size of the block.
+  */
+  template<
+    size_t N,
+    typename S = size_t,
+    typename D = ptrdiff_t
+  > struct tpaddedlayout {
+    
+    typedef S size_type;
+    typedef D difference_type;
+    typedef std::array<S, N> index_type;
+    typedef tpaddedlayout<N - 1, S, D> slice_layout;
+    
+    enum{ RANK = N };
+    enum{ MAX_INDEX = N - 1 };
+    
+    tpaddedlayout() : dims_(), strides_(), row_() {}
+    
+    tpaddedlayout(const index_type& dimensions, size_type alignment) 
+      : dims_(dimensions), 
+        strides_(), 
+        row_((dimensions[MAX_INDEX] + alignment - 1) / alignment * alignment) {
+      assert(alignment > 0);
+      size_type stride(1);
+      
+      for(size_type j = RANK; j-- > 0;) {
+        strides_[j] = stride;
+        stride *= (j == MAX_INDEX) ? row_ : dims_[j];
+      }
+    }
+    
+    size_type
+    dim(size_type i) const {
+      assert(i < RANK);
+      return dims_[i];
+    }
+    
+    /**
+    row
+    
+    Padded length of the innermost rows, ie the leading dimension.
+    */
+    size_type
+    row() const { return row_; }
+    
+    /**
+    footprint
+    
+    Number of elements in the array, including padding.
+    */
+    size_type
+    footprint() const {
+      return (RANK > 1) ? dims_[0] * strides_[0] : row_;
+    }
+    
+    /**
+    get_stride
+    
+    Calculate the data position implied by idx in the contiguous array block.  This is a 'stride'
+    into the data from the data origin.
+    */
+    size_type 
+    get_stride(const index_type& idx) const {
+      return tunroll<0, RANK>::offset(*this, idx);
+    }
+    
+    /**
+    get_stride
+    
+    As above, but taking the index as a list of coordinates, one per axis.
+    */
+    template<typename... I>
+    size_type
+    get_stride(size_type i, I... rest) const {
+      static_assert(sizeof...(I) + 1 == RANK, "get_stride needs one coordinate per axis");
+      return tunroll<0, RANK>::offset(*this, i, rest...);
+    }
+    
+    /**
+    stride
+    
+    Distance in the contiguous array block between neighbouring points along axis K.
+    */
+    template<size_t K>
+    size_type
+    stride() const {
+      return strides_[K];
+    }
+    
+    /**
+    offset
+    
+    Data position of coordinate i along the given axis, all other coordinates being 0.
+    */
+    size_type
+    offset(size_type axis, size_type i) const {
+      assert(axis < RANK);
+      return i * strides_[axis];
+    }
+    
+    /**
+    slice
+    
+    Layout with the leading axis fixed.  Only the leading axis can be sliced, as that is the
+    only slice which keeps the padded rows.
+    */
+    slice_layout
+    slice(size_type i) const {
+      assert(i == 0);
+      slice_layout result;
+      
+      for(size_type j = 1; j < RANK; ++j) {
+        result.dims_[j - 1] = dims_[j];
+        result.strides_[j - 1] = strides_[j];
+      }
+      result.row_ = row_;
+      return result;
+    }
+    
+  private:
+    template<size_t, typename, typename> friend struct tpaddedlayout;
+    
+    index_type dims_;
+    index_type strides_;
+    size_type row_;
+  };
+  
+  /**
+  trange
+  
+  The positions begin, begin + step, begin + 2 * step, ... along one axis, stopping short of 
+  end, that a sub-box view takes.  A negative step walks the axis backwards from begin, so that 
+  range(9, -1, -1) is an axis of ten reversed.  The default end runs to the end of the axis; 
+  all is the whole axis.
+  */
+  struct trange {
+    typedef ptrdiff_t difference_type;
+    
+    trange() : begin(0), end(std::numeric_limits<difference_type>::max()), step(1) {}
+    
+    /**
+    trange
+    
+    Explicit, so that a coordinate is never taken for the range from it to the end of an axis.
+    */
+    explicit trange(
+      difference_type begin, 
+      difference_type end = std::numeric_limits<difference_type>::max(), 
+      difference_type step = 1
+    ) : begin(begin), end(end), step(step) {}
+    
+    /**
+    count
+    
+    Number of positions the range takes along an axis of the given dimension.
+    */
+    size_t
+    count(size_t dim) const {
+      assert(step != 0);
+      difference_type result(0);
+      
+      if(step > 0) {
+        difference_type last = end < difference_type(dim) ? end : difference_type(dim);
+        result = begin < last ? (last - begin + step - 1) / step : 0;
+      }
+      else {
+        result = begin > end ? (begin - end - step - 1) / -step : 0;
+      }
+      assert(result == 0 || (begin >= 0 && begin < difference_type(dim) && end >= -1));
+      return size_t(result);
+    }
+    
+    difference_type begin;
+    difference_type end;
+    difference_type step;
+  };
+  
+  inline trange
+  range(trange::difference_type begin, trange::difference_type end, trange::difference_type step = 1) {
+    return trange(begin, end, step);
+  }
+  
+  static const trange all;
+  
+  /**
+  tranges
+  
+  Whether each of the types R is trange, as the arguments giving a sub-box must be.
+  */
+  template<
+    typename... R
+  > struct tranges : std::true_type {};
+  
+  template<
+    typename R,
+    typename... Rest
+  > struct tranges<R, Rest...> 
+    : std::integral_constant<bool, std::is_same<R, trange>::value && tranges<Rest...>::value> {};
+  
+  /**
+  tboxlayout
+  
+  Layout of a sub-box view, with its own extent and signed stride along each axis, as taken 
+  from a strided parent layout by one trange per axis.  The data block of the view starts at 
+  its lowest addressed element, origin() elements before element (0, ..., 0) when some strides 
+  are negative, so that every data position is still counted forwards from the block start.
+  */
+  template<
+    size_t N,
+    typename S = size_t,
+    typename D = ptrdiff_t
+  > struct tboxlayout {
+    
+    typedef S size_type;
+    typedef D difference_type;
+    typedef std::array<S, N> index_type;
+    typedef std::array<D, N> stride_type;
+    typedef tboxlayout<N - 1, S, D> slice_layout;
+    typedef tboxlayout permuted_layout;
+    
+    enum{ RANK = N };
+    enum{ MAX_INDEX = N - 1 };
+    
+    tboxlayout() : dims_(), strides_(), origin_(0) {}
+    
+    tboxlayout(const index_type& dimensions, const stride_type& strides) 
+      : dims_(dimensions), strides_(strides), origin_(calculate_origin(dimensions, strides)) {}
+    
+    size_type
+    dim(size_type i) const {
+      assert(i < RANK);
+      return dims_[i];
+    }
+    
+    /**
+    footprint
+    
+    Extent of the underlying contiguous block that the layout addresses, from the lowest 
+    addressed element to one past the highest.
+    */
+    size_type
+    footprint() const {
+      size_type result(origin_ + 1);
+      
+      for(size_type j = 0; j < RANK; ++j) {
+        if(dims_[j] == 0) {
+          return 0;
+        }
+        if(strides_[j] > 0) {
+          result += (dims_[j] - 1) * strides_[j];
+        }
+      }
+      return result;
+    }
+    
+    /**
+    get_stride
+    
+    Calculate the data position implied by idx in the contiguous array block.  This is a 'stride'
+    into the data from the data origin.
+    */
+    size_type 
+    get_stride(const index_type& idx) const {
+      return origin_ + tunroll<0, RANK>::offset(*this, idx);
+    }
+    
+    /**
+    get_stride
+    
+    As above, but taking the index as a list of coordinates, one per axis.
+    */
+    template<typename... I>
+    size_type
+    get_stride(size_type i, I... rest) const {
+      static_assert(sizeof...(I) + 1 == RANK, "get_stride needs one coordinate per axis");
+      return origin_ + tunroll<0, RANK>::offset(*this, i, rest...);
+    }
+    
+    /**
+    stride
+    
+    Signed distance in the contiguous array block between neighbouring points along axis K.
+    */
+    template<size_t K>
+    difference_type
+    stride() const {
+      return strides_[K];
+    }
+    
+    /**
+    offset
+    
+    Data position at which the slice at coordinate i along the given axis starts.  Where the 
+    other axes have negative strides this lies before the position of coordinate i itself.
+    */
+    size_type
+    offset(size_type axis, size_type i) const {
+      assert(axis < RANK);
+      return axis_origin(axis) + i * strides_[axis];
+    }
+    
+    /**
+    origin
+    
+    Data position of element (0, ..., 0).
+    */
+    size_type
+    origin() const { return origin_; }
+    
+    /**
+    contiguous
+    
+    Whether the box fills its data block without gaps in row major order, so that it may be 
+    walked as one flat run from the block start.
+    */
+    bool
+    contiguous() const {
+      return row_major_strides(*this);
+    }
+    
+    /**
+    slice
+    
+    Layout with axis i fixed.  The remaining axes keep their strides.
+    */
+    slice_layout
+    slice(size_type i) const {
+      typename slice_layout::index_type dims;
+      typename slice_layout::stride_type strides;
+      
+      for(size_type j = 0; j < i; ++j) {
+        dims[j] = dims_[j];
+        strides[j] = strides_[j];
+      }
+      
+      for(size_type j = i + 1; j < RANK; ++j) {
+        dims[j - 1] = dims_[j];
+        strides[j - 1] = strides_[j];
+      }
+      return slice_layout(dims, strides);
+    }
+    
+    /**
+    permute
+    
+    Layout of the same data with the axes reordered, axis j of the result being axis order[j]
+    of this layout.
+    */
+    permuted_layout
+    permute(const index_type& order) const {
+      index_type dims;
+      stride_type strides;
+      
+      assert(is_axis_order(order));
+      for(size_type j = 0; j < RANK; ++j) {
+        dims[j] = dims_[order[j]];
+        strides[j] = strides_[order[j]];
+      }
+      return permuted_layout(dims, strides);
+    }
+    
+  private:
+    size_type
+    axis_origin(size_type axis) const {
+      return (strides_[axis] < 0 && dims_[axis] > 0) ? (dims_[axis] - 1) * -strides_[axis] : 0;
+    }
+    
+    /**
+    calculate_origin
+    Calculate how far element (0, ..., 0) lies from the lowest addressed element.
+    */
+    static size_type
+    calculate_origin(const index_type& dimensions, const stride_type& strides) {
+      size_type result(0);
+      
+      for(size_type j = 0; j < RANK; ++j) {
+        if(strides[j] < 0 && dimensions[j] > 0) {
+          result += (dimensions[j] - 1) * -strides[j];
+        }
+      }
+      return result;
+    }
+    
+    index_type dims_;
+    stride_type strides_;
+    size_type origin_;
+  };
+  
+  /**
+  slice_stride
+  
+  Sub-box slices start at their own lowest addressed element.
+  */
+  template<
+    size_t N,
+    typename S,
+    typename D
+  > S
+  slice_stride(const tboxlayout<N, S, D>& layout, typename tboxlayout<N, S, D>::size_type i) {
+    return layout.offset(0, i);
+  }
+  
+  template<
+    size_t N,
+    typename S,
+    typename D
+  > bool
+  row_major(const trectlayout<N, S, D>&) {
+    return true;
+  }
+  
+  template<
+    typename E,
+    typename S,
+    typename D
+  > bool
+  row_major(const tstaticlayout<E, S, D>& layout) {
+    return row_major_strides(layout);
+  }
+  
+  template<
+    size_t M,
+    size_t N,
+    typename S,
+    typename D
+  > bool
+  row_major(const trectlayoutref<M, N, S, D>& layout) {
+    return row_major_strides(layout);
+  }
+  
+  template<
+    size_t N,
+    typename S,
+    typename D
+  > bool
+  row_major(const tpermutedlayout<N, S, D>& layout) {
+    return row_major_strides(layout);
+  }
+  
+  template<
+    size_t N,
+    typename S,
+    typename D
+  > bool
+  row_major(const tpaddedlayout<N, S, D>& layout) {
+    return row_major_strides(layout);
+  }
+  
+  template<
+    size_t N,
+    typename S,
+    typename D
+  > bool
+  row_major(const tboxlayout<N, S, D>& layout) {
+    return layout.contiguous();
+  }
 }
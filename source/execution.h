@@ -0,0 +1,869 @@
+/*
+ *    execution.h
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#pragma once
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "multiarray.h"
+#include "parallel.h"
+#include "reduction.h"
+#include "simd.h"
+
+namespace marray {
+
+  /**
+  tparallel
+
+  Asks an operation to run on the threads of a pool.  The data is split into as many parts as
+  the pool has threads, or, where deterministic is set, into PARALLEL_PARTS parts whatever the
+  number of threads, so that reductions add up their elements in the same order on any pool.
+  */
+  enum{ PARALLEL_PARTS = 64 };
+
+  struct tparallel {
+    explicit tparallel(tthreadpool& pool = default_pool(), bool deterministic = false)
+      : pool(&pool), deterministic(deterministic) {}
+
+    size_t
+    parts() const { return deterministic ? size_t(PARALLEL_PARTS) : pool->threads(); }
+
+    tthreadpool* pool;
+    bool deterministic;
+  };
+
+  /**
+  parallel_map
+
+  simd_map over n elements, split between the threads of the policy's pool as by block_range
+  on the pages of to, the same partition first touch construction places the pages of an
+  array by.
+  */
+  template<
+    typename O,
+    size_t N,
+    typename T
+  > void
+  parallel_map(const tparallel& policy, T* to, const T* const (&from)[N], size_t n) {
+    const size_t parts = policy.pool->threads();
+
+    policy.pool->run(parts, [&](size_t part) {
+      std::pair<size_t, size_t> range = block_range(n, parts, part, page_elements<T>(), page_skew(to));
+      const T* operands[N];
+
+      for(size_t k = 0; k < N; ++k) {
+        operands[k] = from[k] + range.first;
+      }
+      simd_map<O>(to + range.first, operands, range.second - range.first);
+    });
+  }
+
+  /*
+  The elementwise operations of simd.h over the data ranges of arrays, on many threads.  As
+  there, every operand must be dense_data.
+  */
+  template<
+    typename X,
+    typename A,
+    typename B
+  > void
+  elementwise_add(const tparallel& policy, X& to, const A& a, const B& b) {
+    assert(dense_data(to) && dense_data(a) && dense_data(b));
+    assert(data_size(a) == data_size(to) && data_size(b) == data_size(to));
+    const typename X::value_type* from[2] = { a.begin().data(), b.begin().data() };
+    parallel_map<tadd>(policy, to.begin().data(), from, data_size(to));
+  }
+
+  template<
+    typename X,
+    typename A,
+    typename B
+  > void
+  elementwise_mul(const tparallel& policy, X& to, const A& a, const B& b) {
+    assert(dense_data(to) && dense_data(a) && dense_data(b));
+    assert(data_size(a) == data_size(to) && data_size(b) == data_size(to));
+    const typename X::value_type* from[2] = { a.begin().data(), b.begin().data() };
+    parallel_map<tmul>(policy, to.begin().data(), from, data_size(to));
+  }
+
+  template<
+    typename X,
+    typename A,
+    typename B,
+    typename C
+  > void
+  elementwise_fma(const tparallel& policy, X& to, const A& a, const B& b, const C& c) {
+    assert(dense_data(to) && dense_data(a) && dense_data(b) && dense_data(c));
+    assert(data_size(a) == data_size(to) && data_size(b) == data_size(to) && data_size(c) == data_size(to));
+    const typename X::value_type* from[3] = { a.begin().data(), b.begin().data(), c.begin().data() };
+    parallel_map<tfma>(policy, to.begin().data(), from, data_size(to));
+  }
+
+  template<
+    typename X,
+    typename A,
+    typename B
+  > void
+  elementwise_min(const tparallel& policy, X& to, const A& a, const B& b) {
+    assert(dense_data(to) && dense_data(a) && dense_data(b));
+    assert(data_size(a) == data_size(to) && data_size(b) == data_size(to));
+    const typename X::value_type* from[2] = { a.begin().data(), b.begin().data() };
+    parallel_map<tmin>(policy, to.begin().data(), from, data_size(to));
+  }
+
+  template<
+    typename X,
+    typename A,
+    typename B
+  > void
+  elementwise_max(const tparallel& policy, X& to, const A& a, const B& b) {
+    assert(dense_data(to) && dense_data(a) && dense_data(b));
+    assert(data_size(a) == data_size(to) && data_size(b) == data_size(to));
+    const typename X::value_type* from[2] = { a.begin().data(), b.begin().data() };
+    parallel_map<tmax>(policy, to.begin().data(), from, data_size(to));
+  }
+
+  template<
+    typename X,
+    typename A
+  > void
+  elementwise_abs(const tparallel& policy, X& to, const A& a) {
+    assert(dense_data(to) && dense_data(a));
+    assert(data_size(a) == data_size(to));
+    const typename X::value_type* from[1] = { a.begin().data() };
+    parallel_map<tabs>(policy, to.begin().data(), from, data_size(to));
+  }
+
+  template<
+    typename X,
+    typename A,
+    typename B,
+    typename C,
+    typename E
+  > void
+  elementwise_select_less(const tparallel& policy, X& to, const A& a, const B& b, const C& x, const E& y) {
+    assert(dense_data(to) && dense_data(a) && dense_data(b) && dense_data(x) && dense_data(y));
+    assert(data_size(a) == data_size(to) && data_size(b) == data_size(to) && data_size(x) == data_size(to) && data_size(y) == data_size(to));
+    const typename X::value_type* from[4] = { a.begin().data(), b.begin().data(), x.begin().data(), y.begin().data() };
+    parallel_map<tselect_less>(policy, to.begin().data(), from, data_size(to));
+  }
+
+  template<
+    typename X
+  > void
+  elementwise_fill(const tparallel& policy, X& to, const typename X::value_type& value) {
+    assert(dense_data(to));
+    typedef typename X::value_type T;
+    T* data = to.begin().data();
+    const size_t n = data_size(to);
+    const size_t parts = policy.pool->threads();
+
+    policy.pool->run(parts, [&](size_t part) {
+      std::pair<size_t, size_t> range = block_range(n, parts, part, page_elements<T>(), page_skew(data));
+      simd_fill(data + range.first, value, range.second - range.first);
+    });
+  }
+
+  /**
+  split_axis
+
+  The axis to split an array of the given shape along into parts: the outermost whose extent
+  is at least parts, or, where every extent is lower, the one of greatest extent, so that an
+  array with few positions along its leading axis is cut into tiles across the next.
+  */
+  template<
+    typename S,
+    size_t N
+  > size_t
+  split_axis(const std::array<S, N>& dims, size_t parts) {
+    size_t result(0);
+
+    for(size_t j = 0; j < N; ++j) {
+      if(dims[j] >= parts) {
+        return j;
+      }
+      if(dims[j] > dims[result]) {
+        result = j;
+      }
+    }
+    return result;
+  }
+
+  /**
+  blocked_copy
+
+  blocked_copy on many threads, each copying the elements in a range along split_axis.
+  */
+  template<
+    typename A1,
+    typename A2
+  > void
+  blocked_copy(const tparallel& policy, const A1& from, A2& to) {
+    enum{ N = A1::RANK };
+    std::array<size_t, N> dims;
+
+    for(size_t j = 0; j < N; ++j) {
+      dims[j] = from.dim(j);
+    }
+    const size_t parts = policy.pool->threads();
+    const size_t axis = split_axis(dims, parts);
+
+    policy.pool->run(parts, [&](size_t part) {
+      std::pair<size_t, size_t> range = block_range(dims[axis], parts, part);
+      blocked_copy(from, to, axis, range.first, range.second);
+    });
+  }
+
+  /**
+  parallel_reduce
+
+  Reduction of a multiarray with a strided layout over the given axes, by reduce(part, axes)
+  on sub-boxes split along split_axis.  Where that axis is kept each part reduces into its own
+  slab of the result; where it is reduced, the results of the parts are merged, in the order
+  of the parts, by combine(result, part).  The result has the type reduce gives.
+  */
+  template<
+    size_t M,
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A,
+    typename F,
+    typename C
+  > auto
+  parallel_reduce(
+    const tparallel& policy,
+    const tmultiarray<T, N, PT, S, D, W, L, A>& array,
+    const std::array<size_t, M>& axes,
+    F reduce,
+    C combine
+  ) -> decltype(reduce(array, axes)) {
+    typedef typename std::remove_const<T>::type value_type;
+    typedef decltype(reduce(array, axes)) result_type;
+    std::array<S, N> dims(shape(array));
+    const size_t parts = policy.parts();
+    const size_t axis = split_axis(dims, parts);
+    const size_t count = parts < dims[axis] ? parts : dims[axis];
+    size_t kept_axis(axis);
+    bool reduced(false);
+
+    for(size_t m = 0; m < M; ++m) {
+      reduced = reduced || axes[m] == axis;
+      kept_axis -= axes[m] < axis ? 1 : 0;
+    }
+    if(count < 2) {
+      return reduce(array, axes);
+    }
+
+    std::array<trange, N> ranges;
+
+    if(!reduced) {
+      result_type result((treduction<value_type, N, M>(array, axes).result_layout()));
+
+      policy.pool->run(count, [&](size_t part) {
+        std::pair<size_t, size_t> range = block_range(dims[axis], count, part);
+        std::array<trange, N> box(ranges);
+
+        box[axis] = trange(range.first, range.second);
+        result_type piece(reduce(subbox(array, box), axes));
+
+        std::array<trange, N - M> slab;
+        slab[kept_axis] = trange(range.first, range.second);
+        auto to = subbox(result, slab);
+        blocked_copy(piece, to);
+      });
+      return result;
+    }
+
+    std::vector<result_type> pieces(count);
+
+    policy.pool->run(count, [&](size_t part) {
+      std::pair<size_t, size_t> range = block_range(dims[axis], count, part);
+      std::array<trange, N> box(ranges);
+
+      box[axis] = trange(range.first, range.second);
+      pieces[part] = reduce(subbox(array, box), axes);
+    });
+    for(size_t part = 1; part < count; ++part) {
+      combine(pieces[0], pieces[part]);
+    }
+    return std::move(pieces[0]);
+  }
+
+  /*
+  Reductions of a part and merges of the results of two parts, for parallel_reduce.  Sums
+  add the elements up in V.  Under SUM_KAHAN the sums of the parts are merged with a
+  compensation too, carried from one merge to the next, so that the error of the whole does
+  not grow with the number of parts.
+  */
+  template<
+    typename V
+  > struct tsumpart {
+    explicit tsumpart(summation_type summation) : summation(summation) {}
+
+    template<typename X, size_t M>
+    tmultiarray<V, X::RANK - M>
+    operator()(const X& array, const std::array<size_t, M>& axes) const { return marray::sum_as<V>(array, axes, summation); }
+
+    template<typename X>
+    void
+    operator()(X& result, const X& part) const {
+      if(summation != SUM_KAHAN) {
+        elementwise_add(result, result, part);
+        return;
+      }
+      V* total = result.begin().data();
+      const V* p = part.begin().data();
+
+      compensation.resize(data_size(result), V());
+      for(size_t j = 0; j < compensation.size(); ++j) {
+        V y = p[j] - compensation[j];
+        V t = total[j] + y;
+
+        compensation[j] = (t - total[j]) - y;
+        total[j] = t;
+      }
+    }
+
+    summation_type summation;
+    mutable std::vector<V> compensation;
+  };
+
+  struct tminpart {
+    template<typename X, size_t M>
+    tmultiarray<typename std::remove_const<typename X::value_type>::type, X::RANK - M>
+    operator()(const X& array, const std::array<size_t, M>& axes) const { return marray::min(array, axes); }
+
+    template<typename X>
+    void
+    operator()(X& result, const X& part) const { elementwise_min(result, result, part); }
+  };
+
+  struct tmaxpart {
+    template<typename X, size_t M>
+    tmultiarray<typename std::remove_const<typename X::value_type>::type, X::RANK - M>
+    operator()(const X& array, const std::array<size_t, M>& axes) const { return marray::max(array, axes); }
+
+    template<typename X>
+    void
+    operator()(X& result, const X& part) const { elementwise_max(result, result, part); }
+  };
+
+  /**
+  sum
+
+  sum on many threads.  Where the split axis is reduced the parts are summed apart and their
+  sums added in order, compensated under SUM_KAHAN, so the result matches the serial sum only
+  to rounding; with a deterministic policy it is the same on any pool.
+  */
+  template<
+    size_t M,
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename std::remove_const<T>::type, N - M>
+  sum(
+    const tparallel& policy,
+    const tmultiarray<T, N, PT, S, D, W, L, A>& array,
+    const std::array<size_t, M>& axes,
+    summation_type summation = SUM_PAIRWISE
+  ) {
+    typedef tsumpart<typename std::remove_const<T>::type> part;
+    return parallel_reduce(policy, array, axes, part(summation), part(summation));
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename std::remove_const<T>::type, N - 1>
+  sum(const tparallel& policy, const tmultiarray<T, N, PT, S, D, W, L, A>& array, size_t axis, summation_type summation = SUM_PAIRWISE) {
+    std::array<size_t, 1> axes = {{ axis }};
+    return sum(policy, array, axes, summation);
+  }
+
+  /**
+  mean
+
+  mean on many threads, summed as the parallel sum is but in the type of the mean.
+  */
+  template<
+    size_t M,
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename tmeantype<typename std::remove_const<T>::type>::type, N - M>
+  mean(
+    const tparallel& policy,
+    const tmultiarray<T, N, PT, S, D, W, L, A>& array,
+    const std::array<size_t, M>& axes,
+    summation_type summation = SUM_PAIRWISE
+  ) {
+    typedef typename tmeantype<typename std::remove_const<T>::type>::type mean_type;
+    typedef typename std::remove_const<T>::type value_type;
+    tmultiarray<mean_type, N - M> result(
+      parallel_reduce(policy, array, axes, tsumpart<mean_type>(summation), tsumpart<mean_type>(summation)));
+
+    divide_by_count(result, treduction<value_type, N, M>(array, axes).size());
+    return result;
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename tmeantype<typename std::remove_const<T>::type>::type, N - 1>
+  mean(const tparallel& policy, const tmultiarray<T, N, PT, S, D, W, L, A>& array, size_t axis, summation_type summation = SUM_PAIRWISE) {
+    std::array<size_t, 1> axes = {{ axis }};
+    return mean(policy, array, axes, summation);
+  }
+
+  template<
+    size_t M,
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename std::remove_const<T>::type, N - M>
+  min(const tparallel& policy, const tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<size_t, M>& axes) {
+    return parallel_reduce(policy, array, axes, tminpart(), tminpart());
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename std::remove_const<T>::type, N - 1>
+  min(const tparallel& policy, const tmultiarray<T, N, PT, S, D, W, L, A>& array, size_t axis) {
+    std::array<size_t, 1> axes = {{ axis }};
+    return min(policy, array, axes);
+  }
+
+  template<
+    size_t M,
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename std::remove_const<T>::type, N - M>
+  max(const tparallel& policy, const tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<size_t, M>& axes) {
+    return parallel_reduce(policy, array, axes, tmaxpart(), tmaxpart());
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename std::remove_const<T>::type, N - 1>
+  max(const tparallel& policy, const tmultiarray<T, N, PT, S, D, W, L, A>& array, size_t axis) {
+    std::array<size_t, 1> axes = {{ axis }};
+    return max(policy, array, axes);
+  }
+
+  /**
+  tindexbox
+
+  The index box [lower, upper) of an N-d index space, as handed out by parallel_for.
+  */
+  template<
+    size_t N
+  > struct tindexbox {
+    std::array<size_t, N> lower;
+    std::array<size_t, N> upper;
+
+    size_t
+    size() const {
+      size_t result(1);
+
+      for(size_t j = 0; j < N; ++j) {
+        result *= upper[j] - lower[j];
+      }
+      return result;
+    }
+
+    std::array<trange, N>
+    ranges() const {
+      std::array<trange, N> result;
+
+      for(size_t j = 0; j < N; ++j) {
+        result[j] = trange(lower[j], upper[j]);
+      }
+      return result;
+    }
+  };
+
+  /**
+  tboxqueue
+
+  The boxes one thread of a parallel_for has split off and not yet run.  Its owner pushes and
+  pops at the back, working depth first, while idle threads steal from the front, where the
+  largest boxes are.
+  */
+  template<
+    size_t N
+  > struct tboxqueue {
+    void
+    push(const tindexbox<N>& box) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      boxes_.push_back(box);
+    }
+
+    bool
+    pop(tindexbox<N>& box) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if(boxes_.empty()) {
+        return false;
+      }
+      box = boxes_.back();
+      boxes_.pop_back();
+      return true;
+    }
+
+    bool
+    steal(tindexbox<N>& box) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if(boxes_.empty()) {
+        return false;
+      }
+      box = boxes_.front();
+      boxes_.pop_front();
+      return true;
+    }
+
+  private:
+    std::deque<tindexbox<N> > boxes_;
+    std::mutex mutex_;
+  };
+
+  /**
+  tstealingfor
+
+  The threads of a parallel_for.  Each halves its box along its longest axis other than keep
+  until the box has no more than grain elements or that axis a single position, queues the
+  upper halves and calls body on what is left; a thread whose queue is empty steals from the
+  others, and one that finds nothing to steal sleeps until a box is queued or the work is done.
+  */
+  enum{ PARALLEL_GRAIN = 4096 };
+
+  template<
+    size_t N,
+    typename F
+  > struct tstealingfor {
+    tstealingfor(const tindexbox<N>& space, size_t keep, size_t grain, size_t threads, F& body)
+      : queues_(threads), remaining_(space.size()), queued_(0), idle_(0), keep_(keep), grain_(grain), body_(body) {
+      queue(0, space);
+    }
+
+    void
+    operator()(size_t part) {
+      tindexbox<N> box;
+
+      for(;;) {
+        if(!take(part, box)) {
+          if(!wait()) {
+            return;
+          }
+          continue;
+        }
+        for(size_t axis = split(box); box.size() > grain_ && box.upper[axis] - box.lower[axis] > 1; axis = split(box)) {
+          tindexbox<N> upper(box);
+
+          upper.lower[axis] = box.upper[axis] = box.lower[axis] + (box.upper[axis] - box.lower[axis]) / 2;
+          queue(part, upper);
+        }
+        body_(static_cast<const tindexbox<N>&>(box));
+
+        const size_t size = box.size();
+        if(remaining_.fetch_sub(size) == size) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          ready_.notify_all();
+        }
+      }
+    }
+
+  private:
+    size_t
+    split(const tindexbox<N>& box) const {
+      size_t result(keep_ == 0 && N > 1 ? 1 : 0);
+
+      for(size_t j = 0; j < N; ++j) {
+        if(j != keep_ && box.upper[j] - box.lower[j] > box.upper[result] - box.lower[result]) {
+          result = j;
+        }
+      }
+      return result;
+    }
+
+    /*
+    queued_ is raised before a box is pushed and lowered after one is taken, so it is never
+    less than the number of boxes queued; a sleeping thread is woken whenever it rises.
+    */
+    void
+    queue(size_t part, const tindexbox<N>& box) {
+      ++queued_;
+      queues_[part].push(box);
+      if(idle_ > 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.notify_one();
+      }
+    }
+
+    bool
+    take(size_t part, tindexbox<N>& box) {
+      bool result(queues_[part].pop(box));
+
+      for(size_t k = 1; !result && k < queues_.size(); ++k) {
+        result = queues_[(part + k) % queues_.size()].steal(box);
+      }
+      if(result) {
+        --queued_;
+      }
+      return result;
+    }
+
+    /*
+    Sleeps until a box may be queued or the work is done, returning false once it is done.
+    */
+    bool
+    wait() {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      ++idle_;
+      ready_.wait(lock, [this] { return queued_ > 0 || remaining_ == 0; });
+      --idle_;
+      return remaining_ > 0;
+    }
+
+    std::vector<tboxqueue<N> > queues_;
+    std::atomic<size_t> remaining_;
+    std::atomic<size_t> queued_;
+    std::atomic<size_t> idle_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    size_t keep_;
+    size_t grain_;
+    F& body_;
+  };
+
+  /**
+  parallel_for
+
+  Calls body(box) on the threads of the policy's pool for index boxes that together cover the
+  index space of the dimensions once each.  The space is split recursively, longest axis
+  first, never along axis keep (unless it is the only one), and the pieces balanced between
+  threads by work stealing, so that bodies whose cost varies from element to element still
+  keep every thread busy.  body must not throw.
+  */
+  template<
+    typename S,
+    size_t N,
+    typename F
+  > void
+  parallel_for(const tparallel& policy, const std::array<S, N>& dims, size_t keep, F body, size_t grain = PARALLEL_GRAIN) {
+    tindexbox<N> space;
+
+    for(size_t j = 0; j < N; ++j) {
+      space.lower[j] = 0;
+      space.upper[j] = dims[j];
+    }
+    if(space.size() == 0) {
+      return;
+    }
+
+    const size_t threads = policy.pool->threads();
+    tstealingfor<N, F> loop(space, keep, grain, threads, body);
+    policy.pool->run(threads, std::ref(loop));
+  }
+
+  /**
+  parallel_for
+
+  parallel_for over the index space of a layout, keeping its innermost axis whole.
+  */
+  template<
+    size_t N,
+    typename S,
+    typename D,
+    typename F
+  > void
+  parallel_for(const tparallel& policy, const trectlayout<N, S, D>& layout, F body, size_t grain = PARALLEL_GRAIN) {
+    std::array<S, N> dims;
+
+    for(size_t j = 0; j < N; ++j) {
+      dims[j] = layout.dim(j);
+    }
+    parallel_for(policy, dims, N - 1, body, grain);
+  }
+
+  template<
+    size_t N,
+    typename S,
+    typename D,
+    typename F
+  > void
+  parallel_for(const trectlayout<N, S, D>& layout, F body) {
+    parallel_for(tparallel(), layout, body);
+  }
+
+  /**
+  parallel_for_boxes
+
+  parallel_for over the elements of a multiarray X, const or not, with a strided layout,
+  calling body(view, box) with the sub-box view of it that subbox gives for each index box.
+  The axis of least stride is kept whole, so that every piece is made of contiguous runs
+  whatever the order of the axes.
+  */
+  template<
+    typename X,
+    typename F
+  > void
+  parallel_for_boxes(const tparallel& policy, X& array, F& body, size_t grain) {
+    enum{ N = X::RANK };
+    auto strides = layout_strides(array.layout());
+    size_t keep(N - 1);
+
+    for(size_t j = 0; j < N; ++j) {
+      if(std::abs(strides[j]) < std::abs(strides[keep])) {
+        keep = j;
+      }
+    }
+    parallel_for(policy, shape(array), keep, [&array, &body](const tindexbox<N>& box) {
+      auto view = subbox(array, box.ranges());
+      body(view, box);
+    }, grain);
+  }
+
+  /**
+  parallel_for
+
+  parallel_for over the elements of a multiarray, as parallel_for_boxes.  The views of a
+  const multiarray give only read access.
+  */
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A,
+    typename F
+  > void
+  parallel_for(const tparallel& policy, tmultiarray<T, N, PT, S, D, W, L, A>& array, F body, size_t grain = PARALLEL_GRAIN) {
+    parallel_for_boxes(policy, array, body, grain);
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A,
+    typename F
+  > void
+  parallel_for(const tparallel& policy, const tmultiarray<T, N, PT, S, D, W, L, A>& array, F body, size_t grain = PARALLEL_GRAIN) {
+    parallel_for_boxes(policy, array, body, grain);
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A,
+    typename F
+  > void
+  parallel_for(tmultiarray<T, N, PT, S, D, W, L, A>& array, F body) {
+    parallel_for(tparallel(), array, body);
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A,
+    typename F
+  > void
+  parallel_for(const tmultiarray<T, N, PT, S, D, W, L, A>& array, F body) {
+    parallel_for(tparallel(), array, body);
+  }
+}
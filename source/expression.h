@@ -0,0 +1,659 @@
+/*
+ *    expression.h
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include "multiarray.h"
+#include "simd.h"
+
+namespace marray {
+
+  /**
+  texpr
+
+  Base of the nodes of a lazy elementwise expression over arrays, multiarrays and views.  The
+  arithmetic operators build a tree of nodes without touching any element; assigning the tree
+  to an array, or evaluate, then computes each element of the result in a single pass over
+  the data, with no intermediate buffers.
+
+  Leaves keep the data pointer and the layout of the array they read, not the array itself,
+  so an expression may be built from temporary views, such as a(range(0, 2), all) or a[1],
+  and kept; the arrays that own the data must outlive it.  Every array in an expression must
+  have the shape of the result; broadcast views combine arrays of different shapes.  An
+  expression may read the array it is assigned to only at the element being written.
+
+  Each node E provides RANK, value_type, dim(j), flat(), which says whether element n of the
+  result is element n of each array's data, flat_at(n) and at(idx).
+  */
+  template<
+    typename E
+  > struct texpr {
+    const E&
+    self() const { return static_cast<const E&>(*this); }
+  };
+
+  /**
+  tarrayexpr
+
+  Leaf of an expression reading a multiarray or view, holding a copy of its layout.  Flat when
+  the layout is row major and dense.
+  */
+  template<
+    typename M
+  > struct tarrayexpr : texpr<tarrayexpr<M> > {
+    typedef typename M::value_type value_type;
+    typedef typename M::size_type size_type;
+    typedef typename M::index_type index_type;
+    typedef typename M::layout_type layout_type;
+
+    enum{ RANK = M::RANK };
+
+    explicit tarrayexpr(const M& array)
+      : layout_(array.layout()), data_(array.begin().data()), flat_(row_major(array.layout())) {}
+
+    size_type
+    dim(size_type j) const { return layout_.dim(j); }
+
+    bool
+    flat() const { return flat_; }
+
+    value_type
+    flat_at(size_type n) const { return data_[n]; }
+
+    value_type
+    at(const index_type& idx) const { return data_[layout_.get_stride(idx)]; }
+
+    /**
+    element
+
+    The element at idx, for writing.
+    */
+    value_type&
+    element(const index_type& idx) const { return data_[layout_.get_stride(idx)]; }
+
+    value_type*
+    data() const { return data_; }
+
+  private:
+    layout_type layout_;
+    value_type* data_;
+    bool flat_;
+  };
+
+  /**
+  tvectorexpr
+
+  Leaf of an expression reading a tarray, taken as a rank 1 multiarray.
+  */
+  template<
+    typename V
+  > struct tvectorexpr : texpr<tvectorexpr<V> > {
+    typedef typename V::value_type value_type;
+    typedef typename V::size_type size_type;
+    typedef std::array<size_type, 1> index_type;
+
+    enum{ RANK = 1 };
+
+    explicit tvectorexpr(const V& array) : data_(array.begin().data()), dim_(array.dim()) {}
+
+    size_type
+    dim(size_type) const { return dim_; }
+
+    bool
+    flat() const { return true; }
+
+    value_type
+    flat_at(size_type n) const { return data_[n]; }
+
+    value_type
+    at(const index_type& idx) const { return data_[idx[0]]; }
+
+    value_type&
+    element(const index_type& idx) const { return data_[idx[0]]; }
+
+    value_type*
+    data() const { return data_; }
+
+  private:
+    value_type* data_;
+    size_type dim_;
+  };
+
+  /**
+  tscalarexpr
+
+  Leaf of an expression standing for the same value at every element.
+  */
+  template<
+    typename T
+  > struct tscalarexpr : texpr<tscalarexpr<T> > {
+    typedef T value_type;
+    typedef size_t size_type;
+
+    enum{ RANK = 0 };
+
+    explicit tscalarexpr(const T& value) : value_(value) {}
+
+    size_type
+    dim(size_type) const { return 0; }
+
+    bool
+    flat() const { return true; }
+
+    value_type
+    flat_at(size_type) const { return value_; }
+
+    template<typename I>
+    value_type
+    at(const I&) const { return value_; }
+
+  private:
+    T value_;
+  };
+
+  /**
+  tbinaryexpr
+
+  Node applying the operation O to the elements of two expressions at the same position.
+  */
+  template<
+    typename O,
+    typename L,
+    typename R
+  > struct tbinaryexpr : texpr<tbinaryexpr<O, L, R> > {
+    typedef typename std::common_type<typename L::value_type, typename R::value_type>::type value_type;
+    typedef size_t size_type;
+
+    enum{ RANK = int(L::RANK) > int(R::RANK) ? int(L::RANK) : int(R::RANK) };
+
+    static_assert(int(L::RANK) == 0 || int(R::RANK) == 0 || int(L::RANK) == int(R::RANK),
+      "elementwise operations need operands of the same rank");
+
+    tbinaryexpr(const L& lhs, const R& rhs) : lhs_(lhs), rhs_(rhs) {
+      for(size_type j = 0; int(L::RANK) > 0 && int(R::RANK) > 0 && j < RANK; ++j) {
+        assert(lhs.dim(j) == rhs.dim(j));
+      }
+    }
+
+    size_type
+    dim(size_type j) const { return int(L::RANK) > 0 ? lhs_.dim(j) : rhs_.dim(j); }
+
+    bool
+    flat() const { return lhs_.flat() && rhs_.flat(); }
+
+    value_type
+    flat_at(size_type n) const { return O::apply(lhs_.flat_at(n), rhs_.flat_at(n)); }
+
+    template<typename I>
+    value_type
+    at(const I& idx) const { return O::apply(lhs_.at(idx), rhs_.at(idx)); }
+
+    const L&
+    lhs() const { return lhs_; }
+
+    const R&
+    rhs() const { return rhs_; }
+
+  private:
+    L lhs_;
+    R rhs_;
+  };
+
+  /**
+  tunaryexpr
+
+  Node applying the operation O to the elements of an expression.
+  */
+  template<
+    typename O,
+    typename E
+  > struct tunaryexpr : texpr<tunaryexpr<O, E> > {
+    typedef typename E::value_type value_type;
+    typedef size_t size_type;
+
+    enum{ RANK = E::RANK };
+
+    explicit tunaryexpr(const E& expr) : expr_(expr) {}
+
+    size_type
+    dim(size_type j) const { return expr_.dim(j); }
+
+    bool
+    flat() const { return expr_.flat(); }
+
+    value_type
+    flat_at(size_type n) const { return O::apply(expr_.flat_at(n)); }
+
+    template<typename I>
+    value_type
+    at(const I& idx) const { return O::apply(expr_.at(idx)); }
+
+  private:
+    E expr_;
+  };
+
+  struct tplus {
+    template<typename T, typename U>
+    static auto apply(const T& lhs, const U& rhs) -> decltype(lhs + rhs) { return lhs + rhs; }
+  };
+
+  struct tminus {
+    template<typename T, typename U>
+    static auto apply(const T& lhs, const U& rhs) -> decltype(lhs - rhs) { return lhs - rhs; }
+  };
+
+  struct tmultiplies {
+    template<typename T, typename U>
+    static auto apply(const T& lhs, const U& rhs) -> decltype(lhs * rhs) { return lhs * rhs; }
+  };
+
+  struct tdivides {
+    template<typename T, typename U>
+    static auto apply(const T& lhs, const U& rhs) -> decltype(lhs / rhs) { return lhs / rhs; }
+  };
+
+  /**
+  tminimum
+
+  The lesser of two elements, the second where they do not compare, as tmin of simd.h.
+  */
+  struct tminimum {
+    template<typename T, typename U>
+    static typename std::common_type<T, U>::type
+    apply(const T& lhs, const U& rhs) { return lhs < rhs ? lhs : rhs; }
+  };
+
+  /**
+  tmaximum
+
+  The greater of two elements, the second where they do not compare, as tmax of simd.h.
+  */
+  struct tmaximum {
+    template<typename T, typename U>
+    static typename std::common_type<T, U>::type
+    apply(const T& lhs, const U& rhs) { return lhs > rhs ? lhs : rhs; }
+  };
+
+  struct tnegate {
+    template<typename T>
+    static T apply(const T& value) { return -value; }
+  };
+
+  /**
+  toperand
+
+  The expression node standing for an operand of an elementwise operator: the operand itself
+  for an expression, a leaf for an array, multiarray or view, and a scalar leaf for an
+  arithmetic value.  is_array says whether the operand is more than a scalar, and value
+  whether it can be an operand at all.
+  */
+  template<
+    typename X,
+    typename = void
+  > struct toperand {
+    enum{ value = false, is_array = false };
+  };
+
+  template<
+    typename X
+  > struct toperand<X, typename std::enable_if<std::is_base_of<texpr<X>, X>::value>::type> {
+    enum{ value = true, is_array = true };
+    typedef X type;
+
+    static const X&
+    make(const X& expr) { return expr; }
+  };
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > struct toperand<tmultiarray<T, N, PT, S, D, W, L, A> > {
+    enum{ value = true, is_array = true };
+    typedef tarrayexpr<tmultiarray<T, N, PT, S, D, W, L, A> > type;
+
+    static type
+    make(const tmultiarray<T, N, PT, S, D, W, L, A>& array) { return type(array); }
+  };
+
+  template<
+    typename T,
+    typename PT,
+    bool W,
+    typename S,
+    typename D,
+    typename A
+  > struct toperand<tarray<T, PT, W, S, D, A> > {
+    enum{ value = true, is_array = true };
+    typedef tvectorexpr<tarray<T, PT, W, S, D, A> > type;
+
+    static type
+    make(const tarray<T, PT, W, S, D, A>& array) { return type(array); }
+  };
+
+  template<
+    typename X
+  > struct toperand<X, typename std::enable_if<std::is_arithmetic<X>::value>::type> {
+    enum{ value = true, is_array = false };
+    typedef tscalarexpr<X> type;
+
+    static type
+    make(const X& value) { return type(value); }
+  };
+
+  /**
+  tbinaryresult
+
+  The node an elementwise operator O makes of operands X and Y, where at least one of them is
+  an array or an expression.
+  */
+  template<
+    typename O,
+    typename X,
+    typename Y,
+    bool = toperand<X>::value && toperand<Y>::value && (toperand<X>::is_array || toperand<Y>::is_array)
+  > struct tbinaryresult {};
+
+  template<
+    typename O,
+    typename X,
+    typename Y
+  > struct tbinaryresult<O, X, Y, true> {
+    typedef tbinaryexpr<O, typename toperand<X>::type, typename toperand<Y>::type> type;
+  };
+
+  /**
+  tunaryresult
+
+  The node an elementwise operator O makes of an array or expression X.
+  */
+  template<
+    typename O,
+    typename X,
+    bool = toperand<X>::is_array
+  > struct tunaryresult {};
+
+  template<
+    typename O,
+    typename X
+  > struct tunaryresult<O, X, true> {
+    typedef tunaryexpr<O, typename toperand<X>::type> type;
+  };
+
+  template<
+    typename X,
+    typename Y
+  > typename tbinaryresult<tplus, X, Y>::type
+  operator+(const X& lhs, const Y& rhs) {
+    return typename tbinaryresult<tplus, X, Y>::type(toperand<X>::make(lhs), toperand<Y>::make(rhs));
+  }
+
+  template<
+    typename X,
+    typename Y
+  > typename tbinaryresult<tminus, X, Y>::type
+  operator-(const X& lhs, const Y& rhs) {
+    return typename tbinaryresult<tminus, X, Y>::type(toperand<X>::make(lhs), toperand<Y>::make(rhs));
+  }
+
+  template<
+    typename X,
+    typename Y
+  > typename tbinaryresult<tmultiplies, X, Y>::type
+  operator*(const X& lhs, const Y& rhs) {
+    return typename tbinaryresult<tmultiplies, X, Y>::type(toperand<X>::make(lhs), toperand<Y>::make(rhs));
+  }
+
+  template<
+    typename X,
+    typename Y
+  > typename tbinaryresult<tdivides, X, Y>::type
+  operator/(const X& lhs, const Y& rhs) {
+    return typename tbinaryresult<tdivides, X, Y>::type(toperand<X>::make(lhs), toperand<Y>::make(rhs));
+  }
+
+  template<
+    typename X
+  > typename tunaryresult<tnegate, X>::type
+  operator-(const X& operand) {
+    return typename tunaryresult<tnegate, X>::type(toperand<X>::make(operand));
+  }
+
+  /**
+  minimum
+
+  Elementwise lesser of two operands, at least one of them an array or an expression.
+  */
+  template<
+    typename X,
+    typename Y
+  > typename tbinaryresult<tminimum, X, Y>::type
+  minimum(const X& lhs, const Y& rhs) {
+    return typename tbinaryresult<tminimum, X, Y>::type(toperand<X>::make(lhs), toperand<Y>::make(rhs));
+  }
+
+  /**
+  maximum
+
+  Elementwise greater of two operands, at least one of them an array or an expression.
+  */
+  template<
+    typename X,
+    typename Y
+  > typename tbinaryresult<tmaximum, X, Y>::type
+  maximum(const X& lhs, const Y& rhs) {
+    return typename tbinaryresult<tmaximum, X, Y>::type(toperand<X>::make(lhs), toperand<Y>::make(rhs));
+  }
+
+  /**
+  tleaf
+
+  Whether an expression node reads the data of an array.
+  */
+  template<
+    typename E
+  > struct tleaf : std::false_type {};
+
+  template<
+    typename M
+  > struct tleaf<tarrayexpr<M> > : std::true_type {};
+
+  template<
+    typename V
+  > struct tleaf<tvectorexpr<V> > : std::true_type {};
+
+  /**
+  tkernelleaf
+
+  Whether an expression node reads the data of an array of elements of type T, or of const T,
+  which a vector kernel writing T may take as an operand.
+  */
+  template<
+    typename E,
+    typename T
+  > struct tkernelleaf : std::integral_constant<bool,
+    tleaf<E>::value && std::is_same<typename std::remove_const<typename E::value_type>::type, T>::value> {};
+
+  /**
+  tkernelop
+
+  The operation of simd.h computing the elementwise operator O, void where there is none.
+  */
+  template<
+    typename O
+  > struct tkernelop {
+    typedef void type;
+  };
+
+  template<> struct tkernelop<tplus> {
+    typedef tadd type;
+  };
+
+  template<> struct tkernelop<tmultiplies> {
+    typedef tmul type;
+  };
+
+  template<> struct tkernelop<tminimum> {
+    typedef tmin type;
+  };
+
+  template<> struct tkernelop<tmaximum> {
+    typedef tmax type;
+  };
+
+  /**
+  flat_kernel
+
+  Computes the n elements of a flat expression into to with a vector kernel, where the
+  expression is an operation simd.h has on two arrays of the destination's type.  Returns
+  whether it did.
+  */
+  template<
+    typename T,
+    typename E
+  > bool
+  flat_kernel(T*, const E&, size_t) {
+    return false;
+  }
+
+  template<
+    typename T,
+    typename O,
+    typename L,
+    typename R
+  > typename std::enable_if<
+    tkernelleaf<L, T>::value && tkernelleaf<R, T>::value && !std::is_void<typename tkernelop<O>::type>::value,
+    bool>::type
+  flat_kernel(T* to, const tbinaryexpr<O, L, R>& expr, size_t n) {
+    const T* from[2] = { expr.lhs().data(), expr.rhs().data() };
+
+    simd_map<typename tkernelop<O>::type>(to, from, n);
+    return true;
+  }
+
+  /**
+  flat_kernel
+
+  Computes a * b + c, for three arrays of the destination's type, with the fused multiply add
+  kernel, which rounds once.
+  */
+  template<
+    typename T,
+    typename L,
+    typename R,
+    typename C
+  > typename std::enable_if<
+    tkernelleaf<L, T>::value && tkernelleaf<R, T>::value && tkernelleaf<C, T>::value,
+    bool>::type
+  flat_kernel(T* to, const tbinaryexpr<tplus, tbinaryexpr<tmultiplies, L, R>, C>& expr, size_t n) {
+    const T* from[3] = { expr.lhs().lhs().data(), expr.lhs().rhs().data(), expr.rhs().data() };
+
+    simd_map<tfma>(to, from, n);
+    return true;
+  }
+
+  /**
+  assign
+
+  Computes each element of an expression into the array, multiarray or view to, which must
+  have the expression's shape, in one pass.  Where the destination and every array read are
+  flat, the pass is a single loop over the data, or a vector kernel for the sum, product,
+  minimum or maximum of two arrays or the product of two arrays plus a third; otherwise it
+  steps through the positions in row major order.
+  */
+  template<
+    typename X,
+    typename E
+  > X&
+  assign(X& to, const texpr<E>& from) {
+    typedef typename toperand<X>::type leaf;
+    typedef typename leaf::index_type index_type;
+    typedef typename leaf::value_type value_type;
+    enum{ N = leaf::RANK };
+    static_assert(int(N) == int(E::RANK), "assignment needs an expression of the same rank");
+
+    const E& expr(from.self());
+    leaf dest(toperand<X>::make(to));
+    size_t size(1);
+
+    for(size_t j = 0; j < N; ++j) {
+      assert(dest.dim(j) == expr.dim(j));
+      size *= dest.dim(j);
+    }
+    if(size == 0) {
+      return to;
+    }
+
+    if(dest.flat() && expr.flat()) {
+      value_type* data = dest.data();
+
+      if(flat_kernel(data, expr, size)) {
+        return to;
+      }
+      for(size_t n = 0; n < size; ++n) {
+        data[n] = expr.flat_at(n);
+      }
+      return to;
+    }
+
+    index_type idx = {};
+
+    for(;;) {
+      for(idx[N - 1] = 0; idx[N - 1] < dest.dim(N - 1); ++idx[N - 1]) {
+        dest.element(idx) = expr.at(idx);
+      }
+
+      size_t k = N - 1;
+      while(k > 0 && ++idx[k - 1] == dest.dim(k - 1)) {
+        idx[--k] = 0;
+      }
+      if(k == 0) {
+        return to;
+      }
+    }
+  }
+
+  /**
+  evaluate
+
+  Dense, row major, owning multiarray holding the value of an expression.
+  */
+  template<
+    typename E
+  > tmultiarray<typename E::value_type, E::RANK>
+  evaluate(const texpr<E>& from) {
+    typedef tmultiarray<typename E::value_type, E::RANK> result_type;
+    typename trectlayout<E::RANK>::index_type dims;
+
+    for(size_t j = 0; j < E::RANK; ++j) {
+      dims[j] = from.self().dim(j);
+    }
+    result_type result((trectlayout<E::RANK>(dims)));
+    assign(result, from);
+    return result;
+  }
+}
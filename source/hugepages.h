@@ -0,0 +1,196 @@
+/*
+ *    hugepages.h
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include "allocator.h"
+#include "arena.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace marray {
+
+  /**
+  thugepagestats
+
+  Counters kept by thugepages.  Besides the byte counts, hugetlb and transparent count the
+  blocks backed by explicit and by transparent huge pages, and fallbacks the blocks left on
+  normal pages, whether because they were small or because huge pages could not be had.  The
+  counts say which path each block took; transparent huge pages are advice, which the kernel
+  may still not act on.
+  */
+  struct thugepagestats : tallocstats {
+    thugepagestats() : hugetlb(0), transparent(0) {}
+
+    size_t hugetlb;
+    size_t transparent;
+  };
+
+  /**
+  thugepages
+
+  Memory resource backing large blocks with 2 MiB huge pages, so that random access into them
+  needs fewer TLB entries.  In EXPLICIT mode blocks are mapped from the hugetlbfs pool, which
+  the administrator must have reserved; in TRANSPARENT mode, and when the pool is exhausted,
+  they are mapped 2 MiB aligned and advised with MADV_HUGEPAGE for the kernel to back with
+  transparent huge pages.  Where the advice is refused the mapping stays on normal pages.
+  Blocks smaller than min_bytes, and every block on systems without mmap, come from the heap.
+  Every block is aligned to at least a cache line.
+
+  Use with tresource_allocator.  A thugepages is not thread safe.
+  */
+  struct thugepages {
+    enum mode_type { TRANSPARENT, EXPLICIT };
+    enum{ HUGE_PAGE_BYTES = 2 << 20 };
+
+    explicit thugepages(mode_type mode = TRANSPARENT, size_t min_bytes = HUGE_PAGE_BYTES / 2)
+      : mode_(mode), min_bytes_(min_bytes) {}
+
+    thugepages(const thugepages&) = delete;
+    thugepages& operator=(const thugepages&) = delete;
+
+    void*
+    allocate(size_t bytes, size_t alignment) {
+      void* result(nullptr);
+
+      if(bytes == 0) {
+        return nullptr;
+      }
+      if(!mapped(bytes, alignment)) {
+        result = aligned_new(bytes, alignment < 64 ? 64 : alignment);
+        ++stats_.fallbacks;
+      }
+      else if(mode_ == EXPLICIT && (result = map_hugetlb(bytes))) {
+        ++stats_.hugetlb;
+      }
+      else {
+        bool advised(false);
+
+        result = map_aligned(bytes, advised);
+        if(advised) {
+          ++stats_.transparent;
+        }
+        else {
+          ++stats_.fallbacks;
+        }
+      }
+      stats_.add(bytes);
+      return result;
+    }
+
+    void
+    deallocate(void* ptr, size_t bytes, size_t alignment) {
+      if(!ptr) {
+        return;
+      }
+      stats_.remove(bytes);
+      if(mapped(bytes, alignment)) {
+        unmap(ptr, bytes);
+      }
+      else {
+        aligned_delete(ptr);
+      }
+    }
+
+    mode_type
+    mode() const { return mode_; }
+
+    const thugepagestats&
+    stats() const { return stats_; }
+
+  private:
+    static size_t
+    mapped_bytes(size_t bytes) {
+      return (bytes + HUGE_PAGE_BYTES - 1) & ~size_t(HUGE_PAGE_BYTES - 1);
+    }
+
+    static void*
+    map_hugetlb(size_t bytes) {
+#if defined(__linux__) && defined(MAP_HUGETLB)
+      void* result = mmap(nullptr, mapped_bytes(bytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      return result == MAP_FAILED ? nullptr : result;
+#else
+      return nullptr;
+#endif
+    }
+
+    /**
+    mapped
+
+    Whether blocks of this size are mapped directly, rather than taken from the heap.
+    */
+    bool
+    mapped(size_t bytes, size_t alignment) const {
+#ifdef __linux__
+      return bytes >= min_bytes_ && alignment <= HUGE_PAGE_BYTES;
+#else
+      return false;
+#endif
+    }
+
+    /**
+    map_aligned
+
+    Maps a 2 MiB aligned block, by mapping a huge page more than needed and trimming either
+    end, and advises the kernel to back it with transparent huge pages.  The block stays on
+    normal pages if the advice is refused.
+    */
+    static void*
+    map_aligned(size_t bytes, bool& advised) {
+#ifdef __linux__
+      size_t length = mapped_bytes(bytes);
+      void* block = mmap(nullptr, length + HUGE_PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+      if(block == MAP_FAILED) {
+        throw std::bad_alloc();
+      }
+      uintptr_t begin = reinterpret_cast<uintptr_t>(block);
+      uintptr_t aligned = (begin + HUGE_PAGE_BYTES - 1) & ~uintptr_t(HUGE_PAGE_BYTES - 1);
+
+      if(aligned > begin) {
+        munmap(block, aligned - begin);
+      }
+      if(begin + HUGE_PAGE_BYTES > aligned) {
+        munmap(reinterpret_cast<void*>(aligned + length), begin + HUGE_PAGE_BYTES - aligned);
+      }
+#ifdef MADV_HUGEPAGE
+      advised = madvise(reinterpret_cast<void*>(aligned), length, MADV_HUGEPAGE) == 0;
+#endif
+      return reinterpret_cast<void*>(aligned);
+#else
+      return nullptr;
+#endif
+    }
+
+    static void
+    unmap(void* ptr, size_t bytes) {
+#ifdef __linux__
+      munmap(ptr, mapped_bytes(bytes));
+#endif
+    }
+
+    mode_type mode_;
+    size_t min_bytes_;
+    thugepagestats stats_;
+  };
+}
@@ -0,0 +1,262 @@
+/*
+ *  mortonlayout.h
+ *
+ *  Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "multiarray.h"
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+namespace marray {
+
+  /**
+  tmortontable
+
+  Spreads the bits of a byte out to every M-th bit.  Used to interleave coordinates a byte at a
+  time where the pdep instruction is not available.
+  */
+  template<
+    size_t M
+  > struct tmortontable {
+    uint64_t spread[256];
+
+    static const tmortontable&
+    get() {
+      static const tmortontable table;
+      return table;
+    }
+
+  private:
+    tmortontable() {
+      for(size_t v = 0; v < 256; ++v) {
+        spread[v] = 0;
+
+        for(size_t b = 0; b < 8; ++b) {
+          spread[v] |= uint64_t((v >> b) & 1) << (M * b);
+        }
+      }
+    }
+  };
+
+  /**
+  tmortonpattern
+
+  The 64 bit mask with every M-th bit set, starting at bit 0.
+  */
+  template<
+    size_t M,
+    size_t B = 0
+  > struct tmortonpattern {
+    static const uint64_t value = (uint64_t(1) << B) | tmortonpattern<M, (B + M < 64 ? B + M : 64)>::value;
+  };
+
+  template<
+    size_t M
+  > struct tmortonpattern<M, 64> {
+    static const uint64_t value = 0;
+  };
+
+  /**
+  tmortonlayout
+
+  Morton (Z order) layout.  The bits of the coordinates are interleaved, axis N - 1 taking the
+  lowest bit, so that points close together along any axis are close together in storage.
+  Each axis is padded out to a power of two, so the layout suits grids of similar extent along
+  each axis, and an axis may have at most 64 / M bits.  The interleaving uses pdep when compiled
+  for BMI2, and a byte table otherwise.
+
+  M is the rank of the whole array and fixes the interleaving; slices keep it and have N < M.
+  */
+  template<
+    size_t N,
+    typename S = size_t,
+    typename D = ptrdiff_t,
+    size_t M = N
+  > struct tmortonlayout {
+
+    typedef S size_type;
+    typedef D difference_type;
+    typedef std::array<S, N> index_type;
+    typedef tmortonlayout<N - 1, S, D, M> slice_layout;
+
+    enum{ TOP_RANK = M };
+    enum{ RANK = N };
+    enum{ MAX_INDEX = N - 1 };
+
+    tmortonlayout() : dims_(), shifts_(), footprint_(0) {}
+
+    tmortonlayout(const index_type& dimensions) : dims_(dimensions), shifts_(), footprint_(0) {
+      static_assert(N == M, "only the whole array layout is built from dimensions");
+
+      for(size_type j = 0; j < RANK; ++j) {
+        shifts_[j] = MAX_INDEX - j;
+      }
+      footprint_ = calculate_footprint();
+    }
+
+    size_type
+    dim(size_type i) const {
+      assert(i < RANK);
+      return dims_[i];
+    }
+
+    /**
+    footprint
+
+    Number of elements in the array, including the padding to a power of two along each axis.
+    For a slice it is the index position of the end() pointer in the underlying contiguous array.
+    */
+    size_type
+    footprint() const {
+      return footprint_;
+    }
+
+    /**
+    offset
+
+    The bits of the data position contributed by coordinate i along the given axis.  The data
+    position of an index is the sum of these over the axes.
+    */
+    size_type
+    offset(size_type axis, size_type i) const {
+#ifdef __BMI2__
+      return static_cast<size_type>(_pdep_u64(i, tmortonpattern<M>::value << shifts_[axis]));
+#else
+      const tmortontable<M>& table(tmortontable<M>::get());
+      uint64_t result(0);
+
+      for(size_type b = 0; i != 0; i >>= 8, b += 8 * M) {
+        result |= table.spread[i & 0xff] << b;
+      }
+      return static_cast<size_type>(result << shifts_[axis]);
+#endif
+    }
+
+    /**
+    get_stride
+
+    Calculate the data position implied by idx in the contiguous array block.  This is a 'stride'
+    into the data from the data origin.
+    */
+    size_type
+    get_stride(const index_type& idx) const {
+      size_type result(0);
+
+      for(size_type j = 0; j < RANK; ++j) {
+        result |= offset(j, idx[j]);
+      }
+      return result;
+    }
+
+    /**
+    get_stride
+
+    As above, but taking the index as a list of coordinates, one per axis.
+    */
+    template<typename... I>
+    size_type
+    get_stride(size_type i, I... rest) const {
+      static_assert(sizeof...(I) + 1 == RANK, "get_stride needs one coordinate per axis");
+      index_type idx = {{ i, static_cast<size_type>(rest)... }};
+      return get_stride(idx);
+    }
+
+    /**
+    slice
+
+    Layout with axis i fixed.  The remaining axes keep their place in the interleaving, the
+    fixed coordinate being accounted for by slice_stride.
+    */
+    slice_layout
+    slice(size_type i) const {
+      slice_layout result;
+      size_type k(0);
+
+      for(size_type j = 0; j < RANK; ++j) {
+        if(j != i) {
+          result.dims_[k] = dims_[j];
+          result.shifts_[k] = shifts_[j];
+          ++k;
+        }
+      }
+      result.footprint_ = result.calculate_footprint();
+      return result;
+    }
+
+  private:
+    template<size_t, typename, typename, size_t> friend struct tmortonlayout;
+
+    size_type
+    calculate_footprint() const {
+      size_type result(1);
+
+      for(size_type j = 0; j < RANK; ++j) {
+        if(dims_[j] == 0) {
+          return 0;
+        }
+        result += offset(j, dims_[j] - 1);
+      }
+      return result;
+    }
+
+    index_type dims_;
+    index_type shifts_;
+    size_type footprint_;
+  };
+
+  /**
+  slice_stride
+
+  Morton layouts are not linear in the leading coordinate.
+  */
+  template<
+    size_t N,
+    typename S,
+    typename D,
+    size_t M
+  > S
+  slice_stride(const tmortonlayout<N, S, D, M>& layout, S i) {
+    return layout.offset(0, i);
+  }
+
+  /**
+  trowslice
+
+  Rows of a Morton layout are scattered, and are given as rank 1 multiarrays.
+  */
+  template<
+    typename T,
+    typename PT,
+    typename S,
+    typename D,
+    size_t M
+  > struct trowslice<T, PT, S, D, tmortonlayout<2, S, D, M> > {
+    typedef tmultiarray<T, 1, PT, S, D, true, tmortonlayout<1, S, D, M> > type;
+
+    static type
+    row(typename type::iterator begin, const tmortonlayout<2, S, D, M>& layout) {
+      return type(begin, layout.slice(0));
+    }
+  };
+}
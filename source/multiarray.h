@@ -21,9 +21,13 @@
  
 #pragma once
 #include <array>
+#include <algorithm>
+#include <utility>
+#include <type_traits>
 #include "arrayiterator.h"
 #include "arraylayouts.h"
 #include "array.h"
+#include "parallel.h"
 #include <vector>
 
 namespace marray {
@@ -36,7 +40,154 @@ namespace marray {
         typename S = size_t,
         typename D = ptrdiff_t,
         bool W = false,
-        typename L = trectlayout<N, S, D>
+        typename L = trectlayout<N, S, D>,
+        typename A = taligned_allocator<T>
+   > struct tmultiarray;
+    
+    template<
+        typename T, 
+        size_t M,
+        typename PT,
+        typename S,
+        typename D
+   > struct treshaped;
+    
+    template<
+        size_t M,
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        bool W,
+        typename L,
+        typename A
+   > treshaped<T, M, PT, S, D>
+    reshape(const tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<S, M>& extents);
+    
+    /**
+    tconstpointer
+    
+    The pointer type through which views of a const multiarray refer to its data: PT with its 
+    elements made const, so that such views give only read access.
+    */
+    template<
+        typename PT
+   > struct tconstpointer;
+    
+    template<
+        typename T
+   > struct tconstpointer<T*> {
+        typedef const T* type;
+    };
+    
+    /**
+    tmutablepointer
+    
+    The inverse of tconstpointer: PT with the const taken off its elements, through which an 
+    owning copy of a read-only view refers to its data.
+    */
+    template<
+        typename PT
+   > struct tmutablepointer;
+    
+    template<
+        typename T
+   > struct tmutablepointer<T*> {
+        typedef typename std::remove_const<T>::type* type;
+    };
+    
+    /**
+    trowslice
+    
+    The slice type of a rank 2 multiarray with layout L, and how to make a view of one row.  Rows 
+    are contiguous in most layouts and are given as weak tarrays.
+    */
+    template<
+        typename T, 
+        typename PT,
+        typename S,
+        typename D,
+        typename L
+   > struct trowslice {
+        typedef tarray<T, PT, true, S, D> type;
+        
+        static type
+        row(typename type::iterator begin, const L& layout) {
+            return type(begin, layout.dim(1));
+        }
+    };
+    
+    /**
+    trowslice
+    
+    Rows of a permuted layout are not in general contiguous, and are given as strided rank 1
+    multiarrays.
+    */
+    template<
+        typename T, 
+        typename PT,
+        typename S,
+        typename D
+   > struct trowslice<T, PT, S, D, tpermutedlayout<2, S, D> > {
+        typedef tmultiarray<T, 1, PT, S, D, true, tpermutedlayout<1, S, D> > type;
+        
+        static type
+        row(typename type::iterator begin, const tpermutedlayout<2, S, D>& layout) {
+            return type(begin, layout.slice(0));
+        }
+    };
+    
+    /**
+    trowslice
+    
+    Rows of a view on remapped axes are contiguous only when the view's last axis is the 
+    parent's last, and are given as strided rank 1 multiarrays.
+    */
+    template<
+        typename T, 
+        typename PT,
+        typename S,
+        typename D,
+        size_t M
+   > struct trowslice<T, PT, S, D, trectlayoutref<M, 2, S, D> > {
+        typedef tmultiarray<T, 1, PT, S, D, true, trectlayoutref<M, 1, S, D> > type;
+        
+        static type
+        row(typename type::iterator begin, const trectlayoutref<M, 2, S, D>& layout) {
+            return type(begin, layout.slice(0));
+        }
+    };
+    
+    /**
+    trowslice
+    
+    Rows of a sub-box view step through the data as the box does, and are given as rank 1 
+    sub-box multiarrays.
+    */
+    template<
+        typename T, 
+        typename PT,
+        typename S,
+        typename D
+   > struct trowslice<T, PT, S, D, tboxlayout<2, S, D> > {
+        typedef tmultiarray<T, 1, PT, S, D, true, tboxlayout<1, S, D> > type;
+        
+        static type
+        row(typename type::iterator begin, const tboxlayout<2, S, D>& layout) {
+            return type(begin, layout.slice(0));
+        }
+    };
+    
+    template<
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        bool W,
+        typename L,
+        typename A
    > struct tmultiarray: tindexeddata<T, PT, S, D> {
         
         typedef array<S, N> index_type;
@@ -47,25 +198,26 @@ namespace marray {
         typedef typename base_array::const_reference const_reference;
         friend  struct tmultiarray<T, N - 1, PT, S, D, true, typename L::slice_layout>;
         typedef tmultiarray<T, N - 1, PT, S, D, true, typename L::slice_layout> slice_type;
+        typedef slice_type axis_slice_type;
         typedef typename base_array::iterator iterator;
+        typedef tmultiarray<T, N, PT, S, D, true, tboxlayout<N, S, D> > box_type;
+        typedef typename tconstpointer<PT>::type const_pointer_type;
+        typedef tmultiarray<const T, N, const_pointer_type, S, D, true, tboxlayout<N, S, D> > const_box_type;
+        typedef tmultiarray<const T, N - 1, const_pointer_type, S, D, true, typename L::slice_layout> const_axis_slice_type;
+        typedef const_axis_slice_type const_slice_type;
         
         enum{ RANK = N };
         
         tmultiarray() {}
         
         tmultiarray(const tmultiarray& rhs) 
-            : base_array(rhs), layout_(rhs.layout_), slice_ref_() {}
+            : base_array(rhs), layout_(rhs.layout_) {}
         
         tmultiarray(
             iterator begin, 
             const layout_type& layout 
-        ) : base_array(begin, layout.footprint()), layout_(layout), slice_ref_(){}
+        ) : base_array(begin, layout.footprint()), layout_(layout) {}
         
-        ~tmultiarray(
-        ) {
-            delete base_array::begin().data();
-        }
-
         const_reference
         operator()(const index_type& idx) const {
             return base_array::operator[](layout_.get_stride(idx));
@@ -76,19 +228,165 @@ namespace marray {
             return base_array::operator[](layout_.get_stride(idx));
         }
         
-        const slice_type&
+        /**
+        operator()
+        
+        element access by coordinates, one per axis, without building an index_type.
+        */
+        template<typename... I>
+        const_reference
+        operator()(size_type i, I... rest) const {
+            return base_array::operator[](layout_.get_stride(i, rest...));
+        }
+        
+        template<typename... I>
+        reference
+        operator()(size_type i, I... rest) {
+            return base_array::operator[](layout_.get_stride(i, rest...));
+        }
+        
+        /**
+        operator()
+        
+        Sub-box view sharing the data, taking along each axis the positions its range gives, 
+        eg a(range(10, 200), all, range(0, 64, 2)).  Every argument must be a trange; 
+        the view of a const multiarray gives only read access.
+        */
+        template<typename... R>
+        box_type
+        operator()(const trange& range, R... rest) {
+            static_assert(sizeof...(R) + 1 == RANK, "a sub-box needs a range for every axis");
+            static_assert(tranges<R...>::value, "a sub-box takes a trange, not a coordinate, along every axis");
+            std::array<trange, RANK> ranges = {{ range, rest... }};
+            return subbox(*this, ranges);
+        }
+        
+        template<typename... R>
+        const_box_type
+        operator()(const trange& range, R... rest) const {
+            static_assert(sizeof...(R) + 1 == RANK, "a sub-box needs a range for every axis");
+            static_assert(tranges<R...>::value, "a sub-box takes a trange, not a coordinate, along every axis");
+            std::array<trange, RANK> ranges = {{ range, rest... }};
+            return subbox(*this, ranges);
+        }
+        
+        /**
+        operator[]
+        
+        View of the i'th slice along axis 0, made afresh on each call.  Views are returned by 
+        value, so slices taken at once, in one expression or on many threads, never alias one 
+        another.  The const version's view is over const elements, and gives only read access.
+        */
+        const_slice_type
         operator[](size_type i) const {
-            assert(i <dim(i));
-            this->slice_ref_.reset(this->begin() + i * layout_.slice(0).footprint(), layout_.slice(0));
-            return slice_ref_;
+            assert(i < dim(0));
+            return const_slice_type(
+                typename const_slice_type::iterator(this->begin().data()) + slice_stride(layout_, i), layout_.slice(0));
         }
         
-        slice_type&
+        slice_type
         operator[](size_type i) {
-            assert(i <dim(i));
-
-            this->slice_ref_.reset(this->begin() + i * layout_.slice(0).footprint(), layout_.slice(0));
-            return slice_ref_;
+            assert(i < dim(0));
+            return slice_type(this->begin() + slice_stride(layout_, i), layout_.slice(0));
+        }
+        
+        /**
+        slice
+        
+        View of rank one less, sharing the data, with the given axis fixed at position.  Any 
+        axis may be fixed where the layout can slice along it.  The view of a const multiarray
+        gives only read access.
+        */
+        axis_slice_type
+        slice(size_type axis, size_type position) {
+            assert(axis < RANK && position < dim(axis));
+            return axis_slice_type(this->begin() + layout_.offset(axis, position), layout_.slice(axis));
+        }
+        
+        const_axis_slice_type
+        slice(size_type axis, size_type position) const {
+            assert(axis < RANK && position < dim(axis));
+            return const_axis_slice_type(
+                typename const_axis_slice_type::iterator(this->begin().data()) + layout_.offset(axis, position), 
+                layout_.slice(axis));
+        }
+        
+        /**
+        permute
+        
+        View of the same data with the axes reordered, axis j of the view being axis order[j]
+        of this multiarray; order must name each axis once.  Available for layouts that can 
+        describe the reordering.  The view of a const multiarray gives only read access.
+        */
+        template<typename LL = L>
+        tmultiarray<T, N, PT, S, D, true, typename LL::permuted_layout>
+        permute(const index_type& order) {
+            return tmultiarray<T, N, PT, S, D, true, typename LL::permuted_layout>(
+                iterator(this->begin().data()), layout_.permute(order));
+        }
+        
+        template<typename LL = L>
+        tmultiarray<const T, N, const_pointer_type, S, D, true, typename LL::permuted_layout>
+        permute(const index_type& order) const {
+            typedef tmultiarray<const T, N, const_pointer_type, S, D, true, typename LL::permuted_layout> view_type;
+            return view_type(typename view_type::iterator(this->begin().data()), layout_.permute(order));
+        }
+        
+        /**
+        transpose
+        
+        View of the same data with the order of the axes reversed, read only where the 
+        multiarray is const.
+        */
+        template<typename LL = L>
+        tmultiarray<T, N, PT, S, D, true, typename LL::permuted_layout>
+        transpose() {
+            return permute<LL>(reversed_order());
+        }
+        
+        template<typename LL = L>
+        tmultiarray<const T, N, const_pointer_type, S, D, true, typename LL::permuted_layout>
+        transpose() const {
+            return permute<LL>(reversed_order());
+        }
+        
+        /**
+        operator=
+        
+        Computes the elements of an elementwise expression into the data the view refers to; 
+        see expression.h.
+        */
+        template<typename E>
+        tmultiarray&
+        operator=(const texpr<E>& expr) {
+            return assign(*this, expr);
+        }
+        
+        /**
+        reshape
+        
+        The same elements, taken in row major order, with the given extents.  The result is a 
+        view on this multiarray's data where its strides allow, and otherwise on a copy.
+        */
+        template<size_t M>
+        treshaped<T, M, PT, S, D>
+        reshape(const std::array<S, M>& extents) const {
+            return marray::reshape(*this, extents);
+        }
+        
+        /**
+        flatten
+        
+        The elements as a single axis, in row major order, without copying where possible.
+        */
+        treshaped<T, 1, PT, S, D>
+        flatten() const {
+            std::array<S, 1> extents = {{ 1 }};
+            
+            for(size_type j = 0; j < RANK; ++j) {
+                extents[0] *= dim(j);
+            }
+            return marray::reshape(*this, extents);
         }
         
         /**
@@ -125,13 +423,27 @@ namespace marray {
         sets up a new beginning for the multiarray.
         */
         void reset(iterator begin) {
-            this->reset(begin, begin + layout_.footprint());
+            base_array::reset(begin, begin + layout_.footprint());
         }
         
         protected:
         
+        /**
+        reversed_order
+        
+        The order of the axes that transposes them.
+        */
+        static index_type
+        reversed_order() {
+            index_type result;
+            
+            for(size_type j = 0; j < RANK; ++j) {
+                result[j] = RANK - 1 - j;
+            }
+            return result;
+        }
+        
         layout_type layout_;
-        mutable slice_type slice_ref_;
     };
     
     template<
@@ -140,8 +452,9 @@ namespace marray {
         typename S,
         typename D,
         bool W,
-        typename L
-   > struct tmultiarray<T, 2, PT, S, D, W, L> : tindexeddata<T, PT, S, D> {
+        typename L,
+        typename A
+   > struct tmultiarray<T, 2, PT, S, D, W, L, A> : tindexeddata<T, PT, S, D> {
         
         typedef array<S, 2> index_type;
         typedef L layout_type;
@@ -149,43 +462,214 @@ namespace marray {
         typedef typename base_array::size_type size_type;
         typedef typename base_array::reference reference;
         typedef typename base_array::const_reference const_reference;
-        typedef tarray<T, PT, true, S, D> slice_type;
+        typedef trowslice<T, PT, S, D, L> row_slice;
+        typedef typename row_slice::type slice_type;
+        typedef tmultiarray<T, 1, PT, S, D, true, typename L::slice_layout> axis_slice_type;
         typedef typename base_array::iterator iterator;
+        typedef tstrideiterator<T, PT, S, D> stride_iterator;
+        typedef tmultiarray<T, 2, PT, S, D, true, tboxlayout<2, S, D> > box_type;
+        typedef typename tconstpointer<PT>::type const_pointer_type;
+        typedef tmultiarray<const T, 2, const_pointer_type, S, D, true, tboxlayout<2, S, D> > const_box_type;
+        typedef tmultiarray<const T, 1, const_pointer_type, S, D, true, typename L::slice_layout> const_axis_slice_type;
+        typedef trowslice<const T, const_pointer_type, S, D, L> const_row_slice;
+        typedef typename const_row_slice::type const_slice_type;
         
         enum{ RANK = 2 };
         
         tmultiarray() {}
         
         tmultiarray(const tmultiarray& rhs) 
-            : base_array(rhs), layout_(rhs.layout_), slice_ref_() {}
+            : base_array(rhs), layout_(rhs.layout_) {}
         
         tmultiarray(
             typename base_array::iterator begin, 
             const layout_type& layout 
-       ) : base_array(begin, layout.footprint()), layout_(layout), slice_ref_() {}
+       ) : base_array(begin, layout.footprint()), layout_(layout) {}
         
         const_reference
         operator()(const index_type& idx) const {
-            return this->operator[](layout_.get_stride(idx));
+            return base_array::operator[](layout_.get_stride(idx));
         }
         
         reference
         operator()(const index_type& idx) {
-            return this->operator[](layout_.get_stride(idx));
+            return base_array::operator[](layout_.get_stride(idx));
+        }
+        
+        /**
+        operator()
+        
+        element access by coordinates, one per axis, without building an index_type.
+        */
+        template<typename... I>
+        const_reference
+        operator()(size_type i, I... rest) const {
+            return base_array::operator[](layout_.get_stride(i, rest...));
+        }
+        
+        template<typename... I>
+        reference
+        operator()(size_type i, I... rest) {
+            return base_array::operator[](layout_.get_stride(i, rest...));
+        }
+        
+        /**
+        operator()
+        
+        Sub-box view sharing the data, taking along each axis the positions its range gives, 
+        eg a(range(10, 200), all, range(0, 64, 2)).  Every argument must be a trange; 
+        the view of a const multiarray gives only read access.
+        */
+        template<typename... R>
+        box_type
+        operator()(const trange& range, R... rest) {
+            static_assert(sizeof...(R) + 1 == RANK, "a sub-box needs a range for every axis");
+            static_assert(tranges<R...>::value, "a sub-box takes a trange, not a coordinate, along every axis");
+            std::array<trange, RANK> ranges = {{ range, rest... }};
+            return subbox(*this, ranges);
         }
         
-        const slice_type&
+        template<typename... R>
+        const_box_type
+        operator()(const trange& range, R... rest) const {
+            static_assert(sizeof...(R) + 1 == RANK, "a sub-box needs a range for every axis");
+            static_assert(tranges<R...>::value, "a sub-box takes a trange, not a coordinate, along every axis");
+            std::array<trange, RANK> ranges = {{ range, rest... }};
+            return subbox(*this, ranges);
+        }
+        
+        /**
+        operator[]
+        
+        View of the i'th row, made afresh on each call as for the general rank, and read only 
+        where the multiarray is const.
+        */
+        const_slice_type
         operator[](size_type i) const {
-            assert(i <dim(i));
-            slice_ref_.reset(this->begin() + i * layout_.slice(0).footprint(), this->begin() + i * layout_.slice(0).footprint() + layout_.dim(1));
-            return slice_ref_;
+            assert(i < dim(0));
+            return const_row_slice::row(
+                typename const_slice_type::iterator(this->begin().data()) + slice_stride(layout_, i), layout_);
         }
         
-        slice_type&
+        slice_type
         operator[](size_type i) {
-            assert(i <dim(i));
-            this->slice_ref_.reset(this->begin() + i * layout_.slice(0).footprint(), this->begin() + i * layout_.slice(0).footprint() + layout_.dim(1));
-            return slice_ref_;
+            assert(i < dim(0));
+            return row_slice::row(this->begin() + slice_stride(layout_, i), layout_);
+        }
+        
+        /**
+        diagonal_begin
+        
+        Iterator stepping along the leading diagonal, elements (i, i), for layouts with a 
+        constant stride along each axis.
+        */
+        stride_iterator
+        diagonal_begin() const {
+            return stride_iterator(
+                this->begin().data() + layout_.get_stride(0, 0), 
+                layout_.template stride<0>() + layout_.template stride<1>());
+        }
+        
+        stride_iterator
+        diagonal_end() const { return diagonal_begin() + (dim(0) < dim(1) ? dim(0) : dim(1)); }
+        
+        /**
+        slice
+        
+        View of rank one less, sharing the data, with the given axis fixed at position.  Any 
+        axis may be fixed where the layout can slice along it.  The view of a const multiarray
+        gives only read access.
+        */
+        axis_slice_type
+        slice(size_type axis, size_type position) {
+            assert(axis < RANK && position < dim(axis));
+            return axis_slice_type(this->begin() + layout_.offset(axis, position), layout_.slice(axis));
+        }
+        
+        const_axis_slice_type
+        slice(size_type axis, size_type position) const {
+            assert(axis < RANK && position < dim(axis));
+            return const_axis_slice_type(
+                typename const_axis_slice_type::iterator(this->begin().data()) + layout_.offset(axis, position), 
+                layout_.slice(axis));
+        }
+        
+        /**
+        permute
+        
+        View of the same data with the axes reordered, axis j of the view being axis order[j]
+        of this multiarray; order must name each axis once.  Available for layouts that can 
+        describe the reordering.  The view of a const multiarray gives only read access.
+        */
+        template<typename LL = L>
+        tmultiarray<T, 2, PT, S, D, true, typename LL::permuted_layout>
+        permute(const index_type& order) {
+            return tmultiarray<T, 2, PT, S, D, true, typename LL::permuted_layout>(
+                iterator(this->begin().data()), layout_.permute(order));
+        }
+        
+        template<typename LL = L>
+        tmultiarray<const T, 2, const_pointer_type, S, D, true, typename LL::permuted_layout>
+        permute(const index_type& order) const {
+            typedef tmultiarray<const T, 2, const_pointer_type, S, D, true, typename LL::permuted_layout> view_type;
+            return view_type(typename view_type::iterator(this->begin().data()), layout_.permute(order));
+        }
+        
+        /**
+        transpose
+        
+        View of the same data with the order of the axes reversed, read only where the 
+        multiarray is const.
+        */
+        template<typename LL = L>
+        tmultiarray<T, 2, PT, S, D, true, typename LL::permuted_layout>
+        transpose() {
+            return permute<LL>(reversed_order());
+        }
+        
+        template<typename LL = L>
+        tmultiarray<const T, 2, const_pointer_type, S, D, true, typename LL::permuted_layout>
+        transpose() const {
+            return permute<LL>(reversed_order());
+        }
+        
+        /**
+        operator=
+        
+        Computes the elements of an elementwise expression into the data the view refers to; 
+        see expression.h.
+        */
+        template<typename E>
+        tmultiarray&
+        operator=(const texpr<E>& expr) {
+            return assign(*this, expr);
+        }
+        
+        /**
+        reshape
+        
+        The same elements, taken in row major order, with the given extents.  The result is a 
+        view on this multiarray's data where its strides allow, and otherwise on a copy.
+        */
+        template<size_t M>
+        treshaped<T, M, PT, S, D>
+        reshape(const std::array<S, M>& extents) const {
+            return marray::reshape(*this, extents);
+        }
+        
+        /**
+        flatten
+        
+        The elements as a single axis, in row major order, without copying where possible.
+        */
+        treshaped<T, 1, PT, S, D>
+        flatten() const {
+            std::array<S, 1> extents = {{ 1 }};
+            
+            for(size_type j = 0; j < RANK; ++j) {
+                extents[0] *= dim(j);
+            }
+            return marray::reshape(*this, extents);
         }
         
         /**
@@ -227,60 +711,416 @@ namespace marray {
         }
     protected:
         
+        /**
+        reversed_order
+        
+        The order of the axes that transposes them.
+        */
+        static index_type
+        reversed_order() {
+            index_type result;
+            
+            for(size_type j = 0; j < RANK; ++j) {
+                result[j] = RANK - 1 - j;
+            }
+            return result;
+        }
+        
         layout_type layout_;
-        mutable slice_type slice_ref_;
     };
         
     template<
         typename T, 
-        size_t N,
         typename PT,
         typename S,
         typename D,
-        typename L
-   > struct tmultiarray<T, N, PT, S, D, false, L>  : tmultiarray<T, N, PT, S, D, true, L> {
-        typedef tmultiarray<T, N, PT, S, D, true, L> base_array;
-        typedef typename base_array::index_type index_type;
-        typedef typename tmultiarray<T, N, PT, S, D, true, L>::size_type size_type;
-        typedef typename tmultiarray<T, N, PT, S, D, true, L>::reference reference;
-        typedef tmultiarray<T, N - 1, PT, S, D, true, L> slice_type;
-        typedef typename base_array::iterator iterator;
+        typename L,
+        typename A
+   > struct tmultiarray<T, 1, PT, S, D, true, L, A> : tindexeddata<T, PT, S, D> {
+        
+        typedef array<S, 1> index_type;
         typedef L layout_type;
+        typedef tindexeddata<T, PT, S, D> base_array;
+        typedef typename base_array::size_type size_type;
+        typedef typename base_array::reference reference;
+        typedef typename base_array::const_reference const_reference;
+        typedef typename base_array::iterator iterator;
+        typedef T slice_type;
+        typedef tstrideiterator<T, PT, S, D> stride_iterator;
+        typedef tmultiarray<T, 1, PT, S, D, true, tboxlayout<1, S, D> > box_type;
+        typedef typename tconstpointer<PT>::type const_pointer_type;
+        typedef tmultiarray<const T, 1, const_pointer_type, S, D, true, tboxlayout<1, S, D> > const_box_type;
+        
+        enum{ RANK = 1 };
         
-        tmultiarray(const tmultiarray& rhs) {}
+        tmultiarray() {}
         
-        tmultiarray(const tmultiarray<T, N, PT, S, D, true, L>& rhs) {}
+        tmultiarray(const tmultiarray& rhs) 
+            : base_array(rhs), layout_(rhs.layout_) {}
         
-        tmultiarray(const typename base_array::layout_type& layout) 
-            : base_array(new T[layout.footprint()], layout) {}        
-            
-        /**
-        dim
+        tmultiarray(
+            iterator begin, 
+            const layout_type& layout 
+        ) : base_array(begin, layout.footprint()), layout_(layout) {}
         
-        returns the dimension along the i axis.
-        */
-        size_t
-        dim(size_t i) const { return this->layout_.dim(i); }
+        const_reference
+        operator()(const index_type& idx) const {
+            return base_array::operator[](layout_.get_stride(idx));
+        }
+        
+        reference
+        operator()(const index_type& idx) {
+            return base_array::operator[](layout_.get_stride(idx));
+        }
         
         /**
-        reset
+        operator()
         
-        sets up a new beginning and layout for the multiarray.
+        Sub-box view sharing the data, taking along each axis the positions its range gives, 
+        eg a(range(0, 64, 2)).  Every argument must be a trange; 
+        the view of a const multiarray gives only read access.
         */
-        void
-        reset(iterator begin, const layout_type& layout) {
-            //_layout = layout;
-            //reset(begin);
+        template<typename... R>
+        box_type
+        operator()(const trange& range, R... rest) {
+            static_assert(sizeof...(R) + 1 == RANK, "a sub-box needs a range for every axis");
+            static_assert(tranges<R...>::value, "a sub-box takes a trange, not a coordinate, along every axis");
+            std::array<trange, RANK> ranges = {{ range, rest... }};
+            return subbox(*this, ranges);
+        }
+        
+        template<typename... R>
+        const_box_type
+        operator()(const trange& range, R... rest) const {
+            static_assert(sizeof...(R) + 1 == RANK, "a sub-box needs a range for every axis");
+            static_assert(tranges<R...>::value, "a sub-box takes a trange, not a coordinate, along every axis");
+            std::array<trange, RANK> ranges = {{ range, rest... }};
+            return subbox(*this, ranges);
         }
         
         /**
-        reset
+        operator[]
         
-        sets up a new beginning for the multiarray.
+        element access along the single axis, which need not be contiguous.
         */
-        void reset(iterator begin) {
-            //this->reset(begin, begin + layout_.footprint());
+        const_reference
+        operator[](size_type i) const {
+            assert(i < dim(0));
+            return base_array::operator[](layout_.get_stride(i));
         }
+        
+        reference
+        operator[](size_type i) {
+            assert(i < dim(0));
+            return base_array::operator[](layout_.get_stride(i));
+        }
+        
+        /**
+        stride_begin
+        
+        Iterator stepping along the axis, for layouts with a constant stride along it.
+        */
+        stride_iterator
+        stride_begin() const {
+            return stride_iterator(this->begin().data() + layout_.get_stride(0), layout_.template stride<0>());
+        }
+        
+        stride_iterator
+        stride_end() const { return stride_begin() + dim(0); }
+        
+        /**
+        operator=
+        
+        Computes the elements of an elementwise expression into the data the view refers to; 
+        see expression.h.
+        */
+        template<typename E>
+        tmultiarray&
+        operator=(const texpr<E>& expr) {
+            return assign(*this, expr);
+        }
+        
+        /**
+        reshape
+        
+        The same elements, taken in row major order, with the given extents.  The result is a 
+        view on this multiarray's data where its strides allow, and otherwise on a copy.
+        */
+        template<size_t M>
+        treshaped<T, M, PT, S, D>
+        reshape(const std::array<S, M>& extents) const {
+            return marray::reshape(*this, extents);
+        }
+        
+        /**
+        flatten
+        
+        The elements as a single axis, in row major order, without copying where possible.
+        */
+        treshaped<T, 1, PT, S, D>
+        flatten() const {
+            std::array<S, 1> extents = {{ 1 }};
+            
+            for(size_type j = 0; j < RANK; ++j) {
+                extents[0] *= dim(j);
+            }
+            return marray::reshape(*this, extents);
+        }
+        
+        /**
+        dim
+        
+        returns the dimension along the i axis.
+        */
+        size_t
+        dim(size_t i) const { return layout_.dim(i); }
+            
+        /**
+        layout
+
+        permits interrogation of the array's dimensional structure.
+        */
+        const layout_type&
+        layout() const {
+            return layout_;
+        }
+
+        /**
+        reset
+        
+        sets up a new beginning and layout for the multiarray.
+        */
+        void
+        reset(iterator begin, const layout_type& layout) {
+            layout_ = layout;
+            reset(begin);
+        }
+        
+        /**
+        reset
+        
+        sets up a new beginning for the multiarray.
+        */
+        void reset(iterator begin) {
+            base_array::reset(begin, begin + layout_.footprint());
+        }
+    protected:
+        
+        layout_type layout_;
+    };
+        
+    template<
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        typename L,
+        typename A
+   > struct tmultiarray<T, N, PT, S, D, false, L, A>  : tmultiarray<T, N, PT, S, D, true, L> {
+        typedef tmultiarray<T, N, PT, S, D, true, L> base_array;
+        typedef typename base_array::index_type index_type;
+        typedef typename tmultiarray<T, N, PT, S, D, true, L>::size_type size_type;
+        typedef typename tmultiarray<T, N, PT, S, D, true, L>::reference reference;
+        typedef typename base_array::slice_type slice_type;
+        typedef typename base_array::iterator iterator;
+        typedef L layout_type;
+        typedef A allocator_type;
+        
+        /**
+        tmultiarray
+        
+        Empty multiarray owning no data, as a moved from multiarray is left.
+        */
+        explicit tmultiarray(const allocator_type& allocator = allocator_type()) : allocator_(allocator) {}
+        
+        /**
+        tmultiarray
+        
+        Owning multiarrays are not copied implicitly; clone() makes a deep copy.
+        */
+        tmultiarray(const tmultiarray& rhs) = delete;
+        
+        /**
+        tmultiarray
+        
+        Takes over the data and layout of rhs, leaving it empty.
+        */
+        tmultiarray(tmultiarray&& rhs) noexcept 
+            : base_array(rhs), allocator_(rhs.allocator_) {
+            rhs.release();
+        }
+        
+        /**
+        tmultiarray
+        
+        Deep copy of the data a weak multiarray refers to.
+        */
+        explicit tmultiarray(
+            const tmultiarray<T, N, PT, S, D, true, L>& rhs,
+            const allocator_type& allocator = allocator_type()
+        ) : base_array(construct_block(allocator, rhs.layout().footprint()), rhs.layout()), allocator_(allocator) {
+            std::copy(rhs.begin().data(), rhs.end().data(), this->begin().data());
+        }
+        
+        tmultiarray(
+            const typename base_array::layout_type& layout, 
+            const allocator_type& allocator = allocator_type()
+        ) : base_array(construct_block(allocator, layout.footprint()), layout), allocator_(allocator) {}        
+        
+        /**
+        tmultiarray
+        
+        Owning multiarray with its data left uninitialized, so that no page is touched until 
+        the data is first written.
+        */
+        tmultiarray(
+            const typename base_array::layout_type& layout, 
+            tuninitialized,
+            const allocator_type& allocator = allocator_type()
+        ) : base_array(allocate_block(allocator, layout.footprint()), layout), allocator_(allocator) {}
+        
+        /**
+        tmultiarray
+        
+        Owning multiarray with every element a copy of value.
+        */
+        tmultiarray(
+            const typename base_array::layout_type& layout, 
+            const T& value,
+            const allocator_type& allocator = allocator_type()
+        ) : base_array(construct_block(allocator, layout.footprint(), value), layout), allocator_(allocator) {}
+        
+        /**
+        tmultiarray
+        
+        Owning multiarray with every element a copy of value, written by touch.threads threads 
+        each taking the block of the data that parallel loops will later give it.
+        */
+        tmultiarray(
+            const typename base_array::layout_type& layout, 
+            const tfirsttouch& touch,
+            const T& value = T(),
+            const allocator_type& allocator = allocator_type()
+        ) : base_array(first_touch_block(allocator, layout.footprint(), value, touch.threads), layout), allocator_(allocator) {}
+        
+        /**
+        tmultiarray
+        
+        Owning multiarray with every element a copy of value, and its pages placed on NUMA 
+        nodes as placement asks.  Slabs are cut along axis 0, which should be the slowest 
+        varying axis of the layout.
+        */
+        tmultiarray(
+            const typename base_array::layout_type& layout, 
+            const tnumaplacement& placement,
+            const T& value = T(),
+            const allocator_type& allocator = allocator_type()
+        ) : base_array(
+                placed_block(
+                    allocator, 
+                    layout.footprint(), 
+                    value, 
+                    placement, 
+                    layout.dim(0), 
+                    [&layout](size_t i) { return slice_stride(layout, i) * sizeof(T); }), 
+                layout), 
+            allocator_(allocator) {}
+        
+        ~tmultiarray(
+        ) {
+            destroy_block(allocator_, this->begin().data(), this->layout_.footprint());
+        }
+        
+        tmultiarray&
+        operator=(const tmultiarray& rhs) = delete;
+        
+        /**
+        operator=
+        
+        Releases the multiarray's data and takes over the data and layout of rhs, leaving it 
+        empty.
+        */
+        tmultiarray&
+        operator=(tmultiarray&& rhs) noexcept {
+            tmultiarray moved(std::move(rhs));
+            swap(moved);
+            return *this;
+        }
+        
+        /**
+        operator=
+        
+        Computes the elements of an elementwise expression into the multiarray, which keeps its
+        shape and data; see expression.h.
+        */
+        template<typename E>
+        tmultiarray&
+        operator=(const texpr<E>& expr) {
+            return assign(*this, expr);
+        }
+        
+        /**
+        swap
+        
+        Exchanges data, layouts and allocators with rhs without copying any elements.
+        */
+        void
+        swap(tmultiarray& rhs) noexcept {
+            using std::swap;
+            iterator begin(this->begin());
+            layout_type layout(this->layout_);
+            
+            base_array::reset(rhs.begin(), rhs.layout_);
+            rhs.base_array::reset(begin, layout);
+            swap(allocator_, rhs.allocator_);
+        }
+        
+        /**
+        clone
+        
+        Deep copy of the multiarray, with the same layout and data from the same allocator.
+        */
+        tmultiarray
+        clone() const {
+            return tmultiarray(*this, allocator_);
+        }
+        
+        /**
+        get_allocator
+        
+        The allocator that owns the multiarray's data.
+        */
+        const allocator_type&
+        get_allocator() const { return allocator_; }
+            
+        /**
+        dim
+        
+        returns the dimension along the i axis.
+        */
+        size_t
+        dim(size_t i) const { return this->layout_.dim(i); }
+        
+        /**
+        reset
+        
+        An owning multiarray keeps the data it allocated, and cannot be pointed elsewhere; 
+        reshape gives views of its data in other shapes.
+        */
+        void
+        reset(iterator begin, const layout_type& layout) = delete;
+        
+        void 
+        reset(iterator begin) = delete;
+        
+    private:
+        void
+        release() {
+            base_array::reset(iterator(nullptr), layout_type());
+        }
+        
+        allocator_type allocator_;
     };
     
     template<
@@ -288,23 +1128,185 @@ namespace marray {
         typename PT,
         typename S,
         typename D,
-        typename L
-   > struct tmultiarray<T, 2, PT, S, D, false, L> : tmultiarray<T, 2, PT, S, D, true, L> {
+        typename L,
+        typename A
+   > struct tmultiarray<T, 2, PT, S, D, false, L, A> : tmultiarray<T, 2, PT, S, D, true, L> {
         typedef tmultiarray<T, 2, PT, S, D, true, L> base_array;
         typedef typename base_array::index_type index_type;
         typedef typename tmultiarray<T, 2, PT, S, D, true, L>::size_type size_type;
         typedef typename tmultiarray<T, 2, PT, S, D, true, L>::reference reference;
-        typedef tarray<T, PT, true, S, D> slice_type;
+        typedef typename base_array::slice_type slice_type;
         typedef typename base_array::iterator iterator;
         typedef L layout_type;
+        typedef A allocator_type;
 
         
-        tmultiarray(const tmultiarray& rhs) {}
+        /**
+        tmultiarray
+        
+        Empty multiarray owning no data, as a moved from multiarray is left.
+        */
+        explicit tmultiarray(const allocator_type& allocator = allocator_type()) : allocator_(allocator) {}
+        
+        /**
+        tmultiarray
+        
+        Owning multiarrays are not copied implicitly; clone() makes a deep copy.
+        */
+        tmultiarray(const tmultiarray& rhs) = delete;
+        
+        /**
+        tmultiarray
+        
+        Takes over the data and layout of rhs, leaving it empty.
+        */
+        tmultiarray(tmultiarray&& rhs) noexcept 
+            : base_array(rhs), allocator_(rhs.allocator_) {
+            rhs.release();
+        }
+        
+        /**
+        tmultiarray
+        
+        Deep copy of the data a weak multiarray refers to.
+        */
+        explicit tmultiarray(
+            const tmultiarray<T, 2, PT, S, D, true, L>& rhs,
+            const allocator_type& allocator = allocator_type()
+        ) : base_array(construct_block(allocator, rhs.layout().footprint()), rhs.layout()), allocator_(allocator) {
+            std::copy(rhs.begin().data(), rhs.end().data(), this->begin().data());
+        }
+        
+        tmultiarray(
+            const typename base_array::layout_type& layout, 
+            const allocator_type& allocator = allocator_type()
+        ) : base_array(construct_block(allocator, layout.footprint()), layout), allocator_(allocator) {}        
+        
+        /**
+        tmultiarray
+        
+        Owning multiarray with its data left uninitialized, so that no page is touched until 
+        the data is first written.
+        */
+        tmultiarray(
+            const typename base_array::layout_type& layout, 
+            tuninitialized,
+            const allocator_type& allocator = allocator_type()
+        ) : base_array(allocate_block(allocator, layout.footprint()), layout), allocator_(allocator) {}
+        
+        /**
+        tmultiarray
+        
+        Owning multiarray with every element a copy of value.
+        */
+        tmultiarray(
+            const typename base_array::layout_type& layout, 
+            const T& value,
+            const allocator_type& allocator = allocator_type()
+        ) : base_array(construct_block(allocator, layout.footprint(), value), layout), allocator_(allocator) {}
+        
+        /**
+        tmultiarray
+        
+        Owning multiarray with every element a copy of value, written by touch.threads threads 
+        each taking the block of the data that parallel loops will later give it.
+        */
+        tmultiarray(
+            const typename base_array::layout_type& layout, 
+            const tfirsttouch& touch,
+            const T& value = T(),
+            const allocator_type& allocator = allocator_type()
+        ) : base_array(first_touch_block(allocator, layout.footprint(), value, touch.threads), layout), allocator_(allocator) {}
+        
+        /**
+        tmultiarray
+        
+        Owning multiarray with every element a copy of value, and its pages placed on NUMA 
+        nodes as placement asks.  Slabs are cut along axis 0, which should be the slowest 
+        varying axis of the layout.
+        */
+        tmultiarray(
+            const typename base_array::layout_type& layout, 
+            const tnumaplacement& placement,
+            const T& value = T(),
+            const allocator_type& allocator = allocator_type()
+        ) : base_array(
+                placed_block(
+                    allocator, 
+                    layout.footprint(), 
+                    value, 
+                    placement, 
+                    layout.dim(0), 
+                    [&layout](size_t i) { return slice_stride(layout, i) * sizeof(T); }), 
+                layout), 
+            allocator_(allocator) {}
+        
+        ~tmultiarray(
+        ) {
+            destroy_block(allocator_, this->begin().data(), this->layout_.footprint());
+        }
+        
+        tmultiarray&
+        operator=(const tmultiarray& rhs) = delete;
+        
+        /**
+        operator=
+        
+        Releases the multiarray's data and takes over the data and layout of rhs, leaving it 
+        empty.
+        */
+        tmultiarray&
+        operator=(tmultiarray&& rhs) noexcept {
+            tmultiarray moved(std::move(rhs));
+            swap(moved);
+            return *this;
+        }
+        
+        /**
+        operator=
         
-        tmultiarray(const tmultiarray<T, 2, PT, S, D, true, L>& rhs) {}
+        Computes the elements of an elementwise expression into the multiarray, which keeps its
+        shape and data; see expression.h.
+        */
+        template<typename E>
+        tmultiarray&
+        operator=(const texpr<E>& expr) {
+            return assign(*this, expr);
+        }
+        
+        /**
+        swap
         
-        tmultiarray(const typename base_array::layout_type& layout) 
-            : base_array(new T[layout.footprint()], layout) {}        
+        Exchanges data, layouts and allocators with rhs without copying any elements.
+        */
+        void
+        swap(tmultiarray& rhs) noexcept {
+            using std::swap;
+            iterator begin(this->begin());
+            layout_type layout(this->layout_);
+            
+            base_array::reset(rhs.begin(), rhs.layout_);
+            rhs.base_array::reset(begin, layout);
+            swap(allocator_, rhs.allocator_);
+        }
+        
+        /**
+        clone
+        
+        Deep copy of the multiarray, with the same layout and data from the same allocator.
+        */
+        tmultiarray
+        clone() const {
+            return tmultiarray(*this, allocator_);
+        }
+        
+        /**
+        get_allocator
+        
+        The allocator that owns the multiarray's data.
+        */
+        const allocator_type&
+        get_allocator() const { return allocator_; }
             
         /**
         dim
@@ -317,23 +1319,566 @@ namespace marray {
         /**
         reset
         
-        sets up a new beginning and layout for the multiarray.
+        An owning multiarray keeps the data it allocated, and cannot be pointed elsewhere; 
+        reshape gives views of its data in other shapes.
         */
         void
-        reset(iterator begin, const layout_type& layout) {
-            //_layout = layout;
-            //reset(begin);
+        reset(iterator begin, const layout_type& layout) = delete;
+        
+        void 
+        reset(iterator begin) = delete;
+        
+    private:
+        void
+        release() {
+            base_array::reset(iterator(nullptr), layout_type());
+        }
+        
+        allocator_type allocator_;
+    };
+    
+    /**
+    numa_slabs
+    
+    The NUMA nodes holding the multiarray's data, as ranges along axis 0 whose first page lives
+    on the same node, so that work on each range can be run on its node.
+    */
+    template<
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        bool W,
+        typename L,
+        typename A
+   > std::vector<tnumaslab>
+    numa_slabs(const tmultiarray<T, N, PT, S, D, W, L, A>& array) {
+        const L& layout(array.layout());
+        return numa_slabs(array.begin().data(), array.dim(0), [&layout](size_t i) { return slice_stride(layout, i) * sizeof(T); });
+    }
+    
+    /**
+    box_view
+    
+    The view V, a multiarray with a tboxlayout, of the sub-box of array that takes along axis j 
+    the positions ranges[j] gives.  Its strides are the array's scaled by the range steps; its 
+    layout's contiguous() says whether it may be walked as one flat run.
+    */
+    template<
+        typename V,
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        bool W,
+        typename L,
+        typename A
+   > V
+    box_view(const tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<trange, N>& ranges) {
+        typedef tboxlayout<N, S, D> box_layout;
+        typename L::index_type first;
+        typename box_layout::index_type dims;
+        typename box_layout::stride_type strides(layout_strides(array.layout()));
+        
+        for(size_t j = 0; j < N; ++j) {
+            dims[j] = ranges[j].count(array.dim(j));
+            first[j] = dims[j] > 0 ? ranges[j].begin : 0;
+            strides[j] *= ranges[j].step;
+        }
+        box_layout layout(dims, strides);
+        
+        return V(typename V::iterator(array.begin().data()) + (array.layout().get_stride(first) - layout.origin()), layout);
+    }
+    
+    /**
+    subbox
+    
+    Sub-box view of a multiarray with a strided layout, sharing its data, that takes along 
+    axis j the positions ranges[j] gives, as box_view makes it.  The view of a const 
+    multiarray is over const elements, and gives only read access.
+    */
+    template<
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        bool W,
+        typename L,
+        typename A
+   > tmultiarray<T, N, PT, S, D, true, tboxlayout<N, S, D> >
+    subbox(tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<trange, N>& ranges) {
+        return box_view<tmultiarray<T, N, PT, S, D, true, tboxlayout<N, S, D> > >(array, ranges);
+    }
+    
+    template<
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        bool W,
+        typename L,
+        typename A
+   > tmultiarray<const T, N, typename tconstpointer<PT>::type, S, D, true, tboxlayout<N, S, D> >
+    subbox(const tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<trange, N>& ranges) {
+        return box_view<tmultiarray<const T, N, typename tconstpointer<PT>::type, S, D, true, tboxlayout<N, S, D> > >(
+            array, ranges);
+    }
+    
+    /**
+    shape
+    
+    The dimensions of a multiarray, one per axis.
+    */
+    template<
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        bool W,
+        typename L,
+        typename A
+   > std::array<S, N>
+    shape(const tmultiarray<T, N, PT, S, D, W, L, A>& array) {
+        std::array<S, N> result;
+        
+        for(size_t j = 0; j < N; ++j) {
+            result[j] = array.dim(j);
+        }
+        return result;
+    }
+    
+    /**
+    broadcast_shape
+    
+    The shape that two shapes broadcast to under NumPy's rules.  The shapes are aligned on 
+    their trailing axes, and the shorter is taken to have dimension 1 along the leading axes 
+    it lacks; along each axis the dimensions must then agree or one of them be 1, the result 
+    taking the other.
+    */
+    template<
+        typename S,
+        size_t N1,
+        size_t N2
+   > std::array<S, (N1 > N2 ? N1 : N2)>
+    broadcast_shape(const std::array<S, N1>& lhs, const std::array<S, N2>& rhs) {
+        enum{ M = N1 > N2 ? N1 : N2 };
+        std::array<S, M> result;
+        
+        for(size_t j = 0; j < M; ++j) {
+            S left = j < M - N1 ? 1 : lhs[j - (M - N1)];
+            S right = j < M - N2 ? 1 : rhs[j - (M - N2)];
+            
+            assert(left == right || left == 1 || right == 1);
+            result[j] = left == 1 ? right : left;
+        }
+        return result;
+    }
+    
+    /**
+    broadcast
+    
+    View of a multiarray with a strided layout as one of rank M and the given shape, under 
+    NumPy's rules: the array's axes are matched with the trailing axes of shape, each having 
+    the same dimension there or dimension 1.  The view repeats the data along the leading axes 
+    the array lacks and along its axes of dimension 1 by giving them stride 0, so that arrays 
+    of different shapes can be combined elementwise without copying either.  The view is over 
+    const elements: its positions alias one another, so it gives only read access.
+    */
+    template<
+        size_t M,
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        bool W,
+        typename L,
+        typename A
+   > tmultiarray<const T, M, typename tconstpointer<PT>::type, S, D, true, tboxlayout<M, S, D> >
+    broadcast(const tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<S, M>& shape) {
+        static_assert(M >= N, "broadcasting cannot lower the rank");
+        typedef tboxlayout<M, S, D> box_layout;
+        typedef tmultiarray<const T, M, typename tconstpointer<PT>::type, S, D, true, box_layout> view_type;
+        typedef typename view_type::iterator iterator;
+        typename L::index_type origin = {};
+        std::array<D, N> from(layout_strides(array.layout()));
+        typename box_layout::stride_type strides = {};
+        
+        for(size_t j = 0; j < N; ++j) {
+            assert(array.dim(j) == shape[M - N + j] || array.dim(j) == 1);
+            strides[M - N + j] = array.dim(j) == 1 ? 0 : from[j];
+        }
+        box_layout layout(shape, strides);
+        
+        return view_type(
+            iterator(array.begin().data()) + (array.layout().get_stride(origin) - layout.origin()), layout);
+    }
+    
+    /**
+    broadcast
+    
+    View of the elements of a tarray, taken as a rank 1 multiarray, broadcast to the given 
+    shape as above.
+    */
+    template<
+        size_t M,
+        typename T, 
+        typename PT,
+        bool W,
+        typename S,
+        typename D,
+        typename A
+   > tmultiarray<const T, M, typename tconstpointer<PT>::type, S, D, true, tboxlayout<M, S, D> >
+    broadcast(const tarray<T, PT, W, S, D, A>& array, const std::array<S, M>& shape) {
+        typedef typename tindexeddata<T, PT, S, D>::iterator iterator;
+        typename trectlayout<1, S, D>::index_type dims = {{ array.dim() }};
+        
+        return broadcast(
+            tmultiarray<T, 1, PT, S, D, true, trectlayout<1, S, D> >(
+                iterator(array.begin().data()), trectlayout<1, S, D>(dims)), 
+            shape);
+    }
+    
+    /**
+    reshape_strides
+    
+    Strides for viewing elements with the given dimensions and strides, in row major order, 
+    with new extents of the same total size.  Axes are matched in groups of equal total 
+    extent; each group of old axes must step through memory evenly for the new axes to split 
+    it.  Returns false where the strides do not allow a view.
+    */
+    template<
+        typename S,
+        typename D,
+        size_t N,
+        size_t M
+   > bool
+    reshape_strides(
+        const std::array<S, N>& dims, 
+        const std::array<D, N>& strides, 
+        const std::array<S, M>& extents, 
+        std::array<D, M>& result
+    ) {
+        std::array<S, N> old_dims;
+        std::array<D, N> old_strides;
+        size_t n(0), size(1), new_size(1);
+        
+        for(size_t j = 0; j < N; ++j) {
+            size *= dims[j];
+            if(dims[j] != 1) {
+                old_dims[n] = dims[j];
+                old_strides[n] = strides[j];
+                ++n;
+            }
+        }
+        for(size_t j = 0; j < M; ++j) {
+            new_size *= extents[j];
         }
+        assert(size == new_size);
+        result.fill(0);
+        if(size == 0) {
+            return true;
+        }
+        
+        size_t oi(0), ni(0);
+        
+        while(oi < n) {
+            while(extents[ni] == 1) {
+                ++ni;
+            }
+            size_t oj(oi + 1), nj(ni + 1);
+            S old_extent(old_dims[oi]), new_extent(extents[ni]);
+            
+            while(old_extent != new_extent) {
+                if(old_extent < new_extent) {
+                    old_extent *= old_dims[oj++];
+                }
+                else {
+                    new_extent *= extents[nj++];
+                }
+            }
+            for(size_t k = oi; k + 1 < oj; ++k) {
+                if(old_strides[k] != old_strides[k + 1] * D(old_dims[k + 1])) {
+                    return false;
+                }
+            }
+            result[nj - 1] = old_strides[oj - 1];
+            for(size_t k = nj - 1; k > ni; --k) {
+                result[k - 1] = result[k] * D(extents[k]);
+            }
+            oi = oj;
+            ni = nj;
+        }
+        return true;
+    }
+    
+    /**
+    treshaped
+    
+    The result of reshaping a multiarray: view, with the new shape, and whether the data had 
+    to be copied to make it.  The view is on the original data where its strides allowed, and 
+    otherwise on a dense copy held here, which lives, and moves, with the treshaped.
+    */
+    template<
+        typename T, 
+        size_t M,
+        typename PT,
+        typename S,
+        typename D
+   > struct treshaped {
+        typedef tmultiarray<T, M, PT, S, D, true, tboxlayout<M, S, D> > view_type;
+        typedef tmultiarray<T, M, PT, S, D, false, trectlayout<M, S, D> > copy_type;
+        
+        explicit treshaped(const view_type& view) : view(view), copy_(), copied_(false) {}
+        
+        explicit treshaped(copy_type&& copy) 
+            : view(
+                typename view_type::iterator(copy.begin().data()), 
+                tboxlayout<M, S, D>(shape(copy), layout_strides(copy.layout()))),
+              copy_(std::move(copy)), 
+              copied_(true) {}
         
         /**
-        reset
+        copied
         
-        sets up a new beginning for the multiarray.
+        Whether the view is on a copy of the data rather than on the data itself.
         */
-        void reset(iterator begin) {
-            //this->reset(begin, begin + layout_.footprint());
+        bool
+        copied() const { return copied_; }
+        
+        view_type view;
+        
+    private:
+        copy_type copy_;
+        bool copied_;
+    };
+    
+    /**
+    reshape
+    
+    The elements of a multiarray with a strided layout, taken in row major order, with new 
+    extents of the same total size.  The result is a view on the array's data when the 
+    strides allow it, as they always do for dense row major arrays, and a view on a dense 
+    copy otherwise; treshaped::copied says which.
+    */
+    template<
+        size_t M,
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        bool W,
+        typename L,
+        typename A
+   > treshaped<T, M, PT, S, D>
+    reshape(const tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<S, M>& extents) {
+        typedef tboxlayout<M, S, D> box_layout;
+        typedef typename treshaped<T, M, PT, S, D>::view_type view_type;
+        typedef typename treshaped<T, M, PT, S, D>::copy_type copy_type;
+        typename L::index_type idx = {};
+        typename box_layout::stride_type strides;
+        
+        if(reshape_strides(shape(array), layout_strides(array.layout()), extents, strides)) {
+            box_layout layout(extents, strides);
+            
+            return treshaped<T, M, PT, S, D>(view_type(
+                typename view_type::iterator(array.begin().data()) + (array.layout().get_stride(idx) - layout.origin()), 
+                layout));
+        }
+        
+        copy_type copy((trectlayout<M, S, D>(extents)));
+        T* data = copy.begin().data();
+        
+        for(size_t n = copy.layout().footprint(); n-- > 0; ++data) {
+            *data = array(idx);
+            
+            size_t k = N;
+            while(k > 0 && ++idx[k - 1] == array.dim(k - 1) && k > 1) {
+                idx[--k] = 0;
+            }
+        }
+        return treshaped<T, M, PT, S, D>(std::move(copy));
+    }
+    
+    /**
+    subspace_begin
+    
+    Iterator over the elements of a multiarray with a strided layout, in storage order.  Dense 
+    runs of axes are walked as one, so the elements of a contiguous box go by in a single run.
+    */
+    template<
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        bool W,
+        typename L,
+        typename A
+   > tsubspaceiterator<T, PT, S, D, N>
+    subspace_begin(const tmultiarray<T, N, PT, S, D, W, L, A>& array) {
+        typename L::index_type origin = {};
+        
+        return tsubspaceiterator<T, PT, S, D, N>(
+            array.begin().data() + array.layout().get_stride(origin), shape(array), layout_strides(array.layout()));
+    }
+    
+    template<
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        bool W,
+        typename L,
+        typename A
+   > tsubspaceiterator<T, PT, S, D, N>
+    subspace_end(const tmultiarray<T, N, PT, S, D, W, L, A>& array) {
+        return subspace_begin(array).end();
+    }
+    
+    template<
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        typename L,
+        typename A
+   > void
+    swap(tmultiarray<T, N, PT, S, D, false, L, A>& lhs, tmultiarray<T, N, PT, S, D, false, L, A>& rhs) noexcept {
+        lhs.swap(rhs);
+    }
+    
+    /**
+    blocked_copy
+    
+    Copies the elements of from into to, which must have the same dimensions, whatever their
+    layouts.  The last two axes are copied in square blocks of COPY_BLOCK, so that when one 
+    side is transposed relative to the other the cache lines of both are reused before they 
+    are evicted.
+    */
+    enum{ COPY_BLOCK = 32 };
+    
+    template<
+        typename A1,
+        typename A2
+   > void
+    blocked_copy(const A1& from, A2& to) {
+        blocked_copy(from, to, 0, 0, from.dim(0));
+    }
+    
+    /**
+    blocked_copy
+    
+    Copies the elements of from whose index along axis is in [begin, end) into to, as above.
+    Copies of disjoint ranges may run at once.
+    */
+    template<
+        typename A1,
+        typename A2
+   > void
+    blocked_copy(const A1& from, A2& to, size_t axis, size_t begin, size_t end) {
+        enum{ N = A1::RANK };
+        static_assert(int(N) == int(A2::RANK), "copies need arrays of the same rank");
+        typedef typename A1::size_type size_type;
+        
+        const size_type inner = N > 1 ? N - 2 : 0;
+        typename A1::index_type lower = {}, upper, idx;
+        
+        for(size_type j = 0; j < N; ++j) {
+            assert(from.dim(j) == to.dim(j));
+            upper[j] = from.dim(j);
+        }
+        assert(axis < N && begin <= end && end <= from.dim(axis));
+        lower[axis] = begin;
+        upper[axis] = end;
+        for(size_type j = 0; j < N; ++j) {
+            if(lower[j] == upper[j]) {
+                return;
+            }
         }
+        
+        const size_type rows_begin = N > 1 ? lower[inner] : 0;
+        const size_type rows_end = N > 1 ? upper[inner] : 1;
+        idx = lower;
+        
+        for(;;) {
+            for(size_type ib = rows_begin; ib < rows_end; ib += COPY_BLOCK) {
+                for(size_type jb = lower[N - 1]; jb < upper[N - 1]; jb += COPY_BLOCK) {
+                    const size_type iend = ib + COPY_BLOCK < rows_end ? ib + COPY_BLOCK : rows_end;
+                    const size_type jend = jb + COPY_BLOCK < upper[N - 1] ? jb + COPY_BLOCK : upper[N - 1];
+                    
+                    for(size_type i = ib; i < iend; ++i) {
+                        idx[inner] = i;
+                        for(size_type j = jb; j < jend; ++j) {
+                            idx[N - 1] = j;
+                            to(idx) = from(idx);
+                        }
+                    }
+                }
+            }
+            
+            size_type k = inner;
+            while(k > 0 && ++idx[k - 1] == upper[k - 1]) {
+                --k;
+                idx[k] = lower[k];
+            }
+            if(k == 0) {
+                return;
+            }
+        }
+    }
+    
+    /**
+    tmaterialized
+    
+    The dense, row major, owning multiarray materialize copies a multiarray of elements T into, 
+    with the const taken off its elements.
+    */
+    template<
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D
+   > struct tmaterialized {
+        typedef tmultiarray<
+            typename std::remove_const<T>::type, N, typename tmutablepointer<PT>::type, S, D, false, trectlayout<N, S, D> 
+        > type;
     };
-
     
+    /**
+    materialize
+    
+    Dense, row major, owning copy of a multiarray of any layout, such as a transposed view or a 
+    read-only broadcast, whose elements may be written.
+    */
+    template<
+        typename T, 
+        size_t N,
+        typename PT,
+        typename S,
+        typename D,
+        bool W,
+        typename L,
+        typename A
+   > typename tmaterialized<T, N, PT, S, D>::type
+    materialize(const tmultiarray<T, N, PT, S, D, W, L, A>& array) {
+        typedef typename tmaterialized<T, N, PT, S, D>::type result_type;
+        typename trectlayout<N, S, D>::index_type dims;
+        
+        for(size_t j = 0; j < N; ++j) {
+            dims[j] = array.dim(j);
+        }
+        result_type result((trectlayout<N, S, D>(dims)));
+        blocked_copy(array, result);
+        return result;
+    }
 }
@@ -0,0 +1,277 @@
+/*
+ *    numa.h
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "parallel.h"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace marray {
+
+  /**
+  tnumasys
+
+  The kernel's memory policy calls, made directly so as not to depend on libnuma.  Each returns
+  false where the kernel or platform does not support it.  Node masks cover up to MAX_NODES
+  nodes.
+  */
+  struct tnumasys {
+    enum{ MAX_NODES = 1024 };
+    enum{ MASK_WORDS = MAX_NODES / (8 * sizeof(unsigned long)) };
+    enum{ BIND = 2, INTERLEAVE = 3 };
+    enum{ MEMS_ALLOWED = 4, MOVE = 2 };
+
+    typedef unsigned long mask_type[MASK_WORDS];
+
+    static bool
+    mbind(void* ptr, size_t bytes, int mode, const unsigned long* mask) {
+#if defined(__linux__) && defined(SYS_mbind)
+      return syscall(SYS_mbind, ptr, bytes, mode, mask, mask ? MAX_NODES + 1 : 0, MOVE) == 0;
+#else
+      return false;
+#endif
+    }
+
+    static bool
+    allowed_nodes(unsigned long* mask) {
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+      return syscall(SYS_get_mempolicy, nullptr, mask, MAX_NODES + 1, nullptr, MEMS_ALLOWED) == 0;
+#else
+      return false;
+#endif
+    }
+
+    static bool
+    page_nodes(size_t count, const void** pages, int* nodes) {
+#if defined(__linux__) && defined(SYS_move_pages)
+      return syscall(SYS_move_pages, 0, count, pages, nullptr, nodes, 0) == 0;
+#else
+      return false;
+#endif
+    }
+  };
+
+  /**
+  numa_nodes
+
+  The nodes this process may place memory on.  Where the memory policy calls are not available
+  this is node 0 alone.
+  */
+  inline std::vector<int>
+  numa_nodes() {
+    std::vector<int> result;
+    tnumasys::mask_type mask = {};
+
+    if(tnumasys::allowed_nodes(mask)) {
+      for(int node = 0; node < tnumasys::MAX_NODES; ++node) {
+        if(mask[node / (8 * sizeof(unsigned long))] >> (node % (8 * sizeof(unsigned long))) & 1) {
+          result.push_back(node);
+        }
+      }
+    }
+    if(result.empty()) {
+      result.push_back(0);
+    }
+    return result;
+  }
+
+  /**
+  numa_available
+
+  Whether memory can be placed on particular nodes at all.
+  */
+  inline bool
+  numa_available() {
+    tnumasys::mask_type mask = {};
+    return tnumasys::allowed_nodes(mask);
+  }
+
+  /**
+  tnumaplacement
+
+  Where an owning array's pages should live.  INTERLEAVE spreads the pages round robin over the
+  nodes; SLABS cuts axis 0 into as many contiguous slabs as there are nodes, split as by
+  block_range, and binds each slab to one node.  An empty node list means every allowed node.
+
+  The policy applies to whole pages, and only to pages lying wholly within the array, so arrays
+  placed this way are best given an allocator aligned to a page, such as
+  taligned_allocator<T, PAGE_BYTES>; otherwise the pages at either end, shared with whatever
+  else lives there, are left where the default policy puts them.
+  */
+  struct tnumaplacement {
+    enum policy_type { DEFAULT, INTERLEAVE, SLABS };
+
+    explicit tnumaplacement(policy_type policy = DEFAULT, const std::vector<int>& nodes = std::vector<int>())
+      : policy(policy), nodes(nodes) {}
+
+    policy_type policy;
+    std::vector<int> nodes;
+  };
+
+  /**
+  tnumaslab
+
+  A range [begin, end) along axis 0 of an array whose data lives on node, -1 where it is not
+  known or not yet touched.
+  */
+  struct tnumaslab {
+    size_t begin;
+    size_t end;
+    int node;
+  };
+
+  /**
+  numa_place
+
+  Applies placement to the pages lying wholly within the bytes of data, which hold rows slabs
+  along axis 0, row r starting row_offset(r) bytes in.  Pages not yet touched are placed when
+  first touched; pages already touched are moved where the kernel allows.  Returns false where
+  the placement could not be made, the data then staying where the default policy puts it.
+  */
+  template<
+    typename F
+  > bool
+  numa_place(void* data, size_t bytes, const tnumaplacement& placement, size_t rows, F row_offset) {
+    if(placement.policy == tnumaplacement::DEFAULT || bytes == 0 || rows == 0) {
+      return true;
+    }
+    std::vector<int> nodes(placement.nodes.empty() ? numa_nodes() : placement.nodes);
+    for(size_t k = 0; k < nodes.size(); ++k) {
+      assert(nodes[k] >= 0 && nodes[k] < tnumasys::MAX_NODES);
+    }
+
+    uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + PAGE_BYTES - 1) & ~uintptr_t(PAGE_BYTES - 1);
+    uintptr_t end = (reinterpret_cast<uintptr_t>(data) + bytes) & ~uintptr_t(PAGE_BYTES - 1);
+    tnumasys::mask_type mask = {};
+
+    if(begin >= end) {
+      return true;
+    }
+    if(placement.policy == tnumaplacement::INTERLEAVE) {
+      for(size_t k = 0; k < nodes.size(); ++k) {
+        mask[nodes[k] / (8 * sizeof(unsigned long))] |= 1UL << (nodes[k] % (8 * sizeof(unsigned long)));
+      }
+      return tnumasys::mbind(reinterpret_cast<void*>(begin), end - begin, tnumasys::INTERLEAVE, mask);
+    }
+
+    bool result(true);
+
+    for(size_t k = 0; k < nodes.size(); ++k) {
+      std::pair<size_t, size_t> slab = block_range(rows, nodes.size(), k);
+      uintptr_t slab_begin = (k == 0) ? begin
+        : (reinterpret_cast<uintptr_t>(data) + row_offset(slab.first)) & ~uintptr_t(PAGE_BYTES - 1);
+      uintptr_t slab_end = (slab.second == rows) ? end
+        : (reinterpret_cast<uintptr_t>(data) + row_offset(slab.second)) & ~uintptr_t(PAGE_BYTES - 1);
+
+      slab_begin = slab_begin < begin ? begin : slab_begin;
+      slab_end = slab_end > end ? end : slab_end;
+
+      if(slab_begin < slab_end) {
+        mask[nodes[k] / (8 * sizeof(unsigned long))] = 1UL << (nodes[k] % (8 * sizeof(unsigned long)));
+        result = tnumasys::mbind(reinterpret_cast<void*>(slab_begin), slab_end - slab_begin, tnumasys::BIND, mask) && result;
+        mask[nodes[k] / (8 * sizeof(unsigned long))] = 0;
+      }
+    }
+    return result;
+  }
+
+  /**
+  numa_slabs
+
+  The nodes holding data that has rows slabs along axis 0, row r starting row_offset(r) bytes
+  in, as ranges of rows whose first page lives on the same node.  Each page is asked after
+  once, however many rows start in it.
+  */
+  template<
+    typename F
+  > std::vector<tnumaslab>
+  numa_slabs(const void* data, size_t rows, F row_offset) {
+    std::vector<tnumaslab> result;
+    std::vector<const void*> pages;
+    std::vector<size_t> row_page(rows);
+
+    for(size_t r = 0; r < rows; ++r) {
+      const void* page = reinterpret_cast<const void*>(
+        (reinterpret_cast<uintptr_t>(data) + row_offset(r)) & ~uintptr_t(PAGE_BYTES - 1));
+
+      if(pages.empty() || pages.back() != page) {
+        pages.push_back(page);
+      }
+      row_page[r] = pages.size() - 1;
+    }
+
+    std::vector<int> nodes(pages.size(), -1);
+
+    if(pages.empty() || !tnumasys::page_nodes(pages.size(), &pages[0], &nodes[0])) {
+      nodes.assign(pages.size(), -1);
+    }
+    for(size_t r = 0; r < rows; ++r) {
+      const int node = nodes[row_page[r]] < 0 ? -1 : nodes[row_page[r]];
+
+      if(result.empty() || result.back().node != node) {
+        tnumaslab slab = { r, r + 1, node };
+        result.push_back(slab);
+      }
+      else {
+        result.back().end = r + 1;
+      }
+    }
+    return result;
+  }
+
+  /**
+  placed_block
+
+  Allocates n objects from (a copy of) the allocator, applies placement to them as numa_place
+  does, and copy constructs each from value so that their pages land where placed.
+  */
+  template<
+    typename A,
+    typename F
+  > typename A::value_type*
+  placed_block(
+    A allocator,
+    size_t n,
+    const typename A::value_type& value,
+    const tnumaplacement& placement,
+    size_t rows,
+    F row_offset
+  ) {
+    typedef typename A::value_type T;
+    T* result = allocator.allocate(n);
+
+    numa_place(result, n * sizeof(T), placement, rows, row_offset);
+    try {
+      std::uninitialized_fill(result, result + n, value);
+    }
+    catch(...) {
+      allocator.deallocate(result, n);
+      throw;
+    }
+    return result;
+  }
+}
@@ -0,0 +1,315 @@
+/*
+ *    parallel.h
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace marray {
+
+  enum{ PAGE_BYTES = 4096 };
+
+  /**
+  hardware_threads
+
+  Number of threads the machine can run at once, or 1 where that is not known.
+  */
+  inline size_t
+  hardware_threads() {
+    size_t result = std::thread::hardware_concurrency();
+    return result > 0 ? result : 1;
+  }
+
+  /**
+  page_elements
+
+  Number of objects of type T in a page, the granule in which data is split between threads.
+  */
+  template<
+    typename T
+  > size_t
+  page_elements() {
+    return sizeof(T) < PAGE_BYTES ? PAGE_BYTES / sizeof(T) : 1;
+  }
+
+  /**
+  page_skew
+
+  How many objects of type T data lies past the start of its page, to the nearest object.
+  Passed to block_range as skew, it makes the boundaries between parts fall on pages of the
+  data however its block is aligned.
+  */
+  template<
+    typename T
+  > size_t
+  page_skew(const T* data) {
+    return (reinterpret_cast<uintptr_t>(data) % PAGE_BYTES) / sizeof(T);
+  }
+
+  /**
+  block_range
+
+  The part'th of parts contiguous ranges that [0, n) is split into.  Boundaries fall on
+  multiples of granule counted from -skew, that is, at element 0 taken to lie skew elements
+  into its first granule, and the ranges differ in length by at most one granule.  This is the
+  one partition of array data between threads: first touch construction and the parallel
+  loops over the data both use it, so each thread works on the pages it placed.
+  */
+  inline std::pair<size_t, size_t>
+  block_range(size_t n, size_t parts, size_t part, size_t granule = 1, size_t skew = 0) {
+    assert(skew < granule);
+    const size_t total = n + skew;
+    size_t granules = (total + granule - 1) / granule;
+    size_t begin = (granules / parts) * part + (part < granules % parts ? part : granules % parts);
+    size_t end = begin + granules / parts + (part < granules % parts ? 1 : 0);
+
+    begin = begin * granule < total ? begin * granule : total;
+    end = end * granule < total ? end * granule : total;
+    return std::make_pair(begin > skew ? begin - skew : 0, end > skew ? end - skew : 0);
+  }
+
+  /**
+  for_each_block
+
+  Calls f(begin, end) on each of the block_ranges of [0, n), one per thread, the first on the
+  calling thread, and waits for them all.  f must not throw.  Where a thread cannot be started
+  those already running are joined before the error is passed on.
+  */
+  template<
+    typename F
+  > void
+  for_each_block(size_t n, size_t threads, size_t granule, F f, size_t skew = 0) {
+    std::vector<std::thread> workers;
+
+    if(threads == 0) {
+      threads = 1;
+    }
+    workers.reserve(threads - 1);
+    try {
+      for(size_t t = 1; t < threads; ++t) {
+        std::pair<size_t, size_t> range = block_range(n, threads, t, granule, skew);
+
+        if(range.first < range.second) {
+          workers.push_back(std::thread(f, range.first, range.second));
+        }
+      }
+    }
+    catch(...) {
+      for(size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+      }
+      throw;
+    }
+    std::pair<size_t, size_t> range = block_range(n, threads, 0, granule, skew);
+    f(range.first, range.second);
+
+    for(size_t t = 0; t < workers.size(); ++t) {
+      workers[t].join();
+    }
+  }
+
+  /**
+  tthreadpool
+
+  A fixed set of threads kept waiting for work, so that parallel loops do not pay to start
+  threads each time.  run(tasks, f) calls f(task) for every task in [0, tasks), handing them
+  out one at a time to the pool's threads and the calling thread, and returns when all are
+  done.  f must not throw.  A run made while another is under way, such as one from inside a
+  task, is carried out on the calling thread alone.
+  */
+  struct tthreadpool {
+    explicit tthreadpool(size_t threads = hardware_threads())
+      : job_(nullptr), tasks_(0), next_(0), pending_(0), generation_(0), busy_(false), stop_(false) {
+      for(size_t t = 1; t < threads; ++t) {
+        workers_.push_back(std::thread(&tthreadpool::work, this));
+      }
+    }
+
+    tthreadpool(const tthreadpool&) = delete;
+    tthreadpool& operator=(const tthreadpool&) = delete;
+
+    ~tthreadpool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      wake_.notify_all();
+      for(size_t t = 0; t < workers_.size(); ++t) {
+        workers_[t].join();
+      }
+    }
+
+    /**
+    threads
+
+    Number of threads that take part in a run, counting the calling thread.
+    */
+    size_t
+    threads() const { return workers_.size() + 1; }
+
+    template<
+      typename F
+    > void
+    run(size_t tasks, F f) {
+      std::function<void(size_t)> job(f);
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      if(busy_ || workers_.empty() || tasks < 2) {
+        lock.unlock();
+        for(size_t task = 0; task < tasks; ++task) {
+          f(task);
+        }
+        return;
+      }
+      busy_ = true;
+      job_ = &job;
+      tasks_ = tasks;
+      next_ = 0;
+      pending_ = workers_.size();
+      ++generation_;
+      lock.unlock();
+      wake_.notify_all();
+
+      take(job, tasks);
+
+      lock.lock();
+      done_.wait(lock, [this] { return pending_ == 0; });
+      job_ = nullptr;
+      busy_ = false;
+    }
+
+  private:
+    void
+    take(const std::function<void(size_t)>& job, size_t tasks) {
+      for(size_t task = next_++; task < tasks; task = next_++) {
+        job(task);
+      }
+    }
+
+    void
+    work() {
+      size_t generation(0);
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      for(;;) {
+        wake_.wait(lock, [this, generation] { return stop_ || generation_ != generation; });
+        if(stop_) {
+          return;
+        }
+        generation = generation_;
+        const std::function<void(size_t)>* job = job_;
+        size_t tasks = tasks_;
+
+        lock.unlock();
+        take(*job, tasks);
+        lock.lock();
+        if(--pending_ == 0) {
+          done_.notify_one();
+        }
+      }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(size_t)>* job_;
+    size_t tasks_;
+    std::atomic<size_t> next_;
+    size_t pending_;
+    size_t generation_;
+    bool busy_;
+    bool stop_;
+  };
+
+  /**
+  default_pool
+
+  The pool of hardware_threads threads that parallel operations use unless given another.
+  */
+  inline tthreadpool&
+  default_pool() {
+    static tthreadpool pool;
+    return pool;
+  }
+
+  /**
+  tfirsttouch
+
+  Asks an owning array to construct its data on the given number of threads, each writing the
+  pages it will later work on, so that on NUMA machines the operating system places those
+  pages on that thread's node.
+  */
+  struct tfirsttouch {
+    explicit tfirsttouch(size_t threads = hardware_threads()) : threads(threads) {}
+
+    size_t threads;
+  };
+
+  /**
+  first_touch_block
+
+  Allocates n objects from (a copy of) the allocator and copy constructs them from value,
+  split between threads as by block_range in pages of the block.  Where a thread cannot be
+  started, the objects already built are destroyed and the block freed before the error is
+  passed on.
+  */
+  template<
+    typename A
+  > typename A::value_type*
+  first_touch_block(A allocator, size_t n, const typename A::value_type& value, size_t threads) {
+    typedef typename A::value_type T;
+    static_assert(std::is_nothrow_copy_constructible<T>::value, "construction on many threads must not throw");
+
+    T* result = allocator.allocate(n);
+    std::vector<std::pair<size_t, size_t> > built;
+    std::mutex mutex;
+
+    built.reserve(threads > 0 ? threads : 1);
+    try {
+      for_each_block(n, threads, page_elements<T>(), [result, &value, &built, &mutex](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; ++i) {
+          ::new(static_cast<void*>(result + i)) T(value);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        built.push_back(std::make_pair(begin, end));
+      }, page_skew(result));
+    }
+    catch(...) {
+      for(size_t k = 0; k < built.size() && !std::is_trivially_destructible<T>::value; ++k) {
+        for(size_t i = built[k].first; i < built[k].second; ++i) {
+          result[i].~T();
+        }
+      }
+      allocator.deallocate(result, n);
+      throw;
+    }
+    return result;
+  }
+}
@@ -0,0 +1,976 @@
+/*
+ *    reduction.h
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "multiarray.h"
+#include "simd.h"
+
+namespace marray {
+
+  /**
+  summation_type
+
+  How sum and mean add up the elements along the reduced axes.  SUM_NAIVE adds them in
+  vector lanes, with an error that grows with the number of elements.  SUM_PAIRWISE adds
+  blocks of PAIRWISE_BLOCK elements, or PAIRWISE_ROWS rows, in lanes and combines the block
+  sums pairwise, so that the error grows with its logarithm.  SUM_KAHAN carries a
+  compensation for the rounding error of each addition, so that the error does not grow with
+  the number of elements at all, at several times the cost.
+  */
+  enum summation_type { SUM_NAIVE, SUM_PAIRWISE, SUM_KAHAN };
+
+  enum{ PAIRWISE_BLOCK = 128, PAIRWISE_ROWS = 8 };
+
+  /**
+  forward_run
+
+  The lowest addressed of the n elements from p at stride -1, or p itself at stride 1.
+  */
+  template<
+    typename T
+  > const T*
+  forward_run(const T* p, size_t n, ptrdiff_t stride) {
+    return stride < 0 ? p - (n - 1) : p;
+  }
+
+  /*
+  The accumulators.  The reduction of one result element takes reset(), then add_run(p, n, s)
+  for each run of n elements from p at stride s, and then result().  The reduction of a row
+  of n result elements at once takes reset(n), then add_row(p, s) for each row of elements
+  from p at stride s, and then store(to, s), which writes the row to to at stride s.  Runs of
+  a single axis and rows come in the order of the index along it.  The sums read elements T
+  and add them up in V, which is T unless given.
+  */
+
+  /**
+  run_sum
+
+  Sum in V of the n elements from p, with the vector kernel where the elements are V.
+  */
+  template<
+    typename V,
+    typename T
+  > typename std::enable_if<!std::is_same<T, V>::value, V>::type
+  run_sum(const T* p, size_t n) {
+    V total = V();
+
+    for(size_t i = 0; i < n; ++i) {
+      total += V(p[i]);
+    }
+    return total;
+  }
+
+  template<
+    typename V,
+    typename T
+  > typename std::enable_if<std::is_same<T, V>::value, V>::type
+  run_sum(const T* p, size_t n) {
+    return simd_reduce<tadd>(p, n, V());
+  }
+
+  template<
+    typename T,
+    typename V = T
+  > struct tnaivesum {
+    void
+    reset() { total_ = V(); }
+
+    void
+    add_run(const T* p, size_t n, ptrdiff_t stride) {
+      if(stride == 1 || stride == -1) {
+        total_ += run_sum<V>(forward_run(p, n, stride), n);
+        return;
+      }
+      for(size_t i = 0; i < n; ++i) {
+        total_ += V(p[ptrdiff_t(i) * stride]);
+      }
+    }
+
+    V
+    result() const { return total_; }
+
+  private:
+    V total_;
+  };
+
+  /**
+  tpairwisesum
+
+  Adds up blocks of PAIRWISE_BLOCK elements and keeps the block sums as a binary counter
+  does its bits: a level holds the sum of 2^k blocks, and a new block is carried up through
+  the occupied levels, so that every addition is of two sums of about the same size.
+  */
+  template<
+    typename T,
+    typename V = T
+  > struct tpairwisesum {
+    void
+    reset() {
+      block_ = V();
+      in_block_ = 0;
+      blocks_ = 0;
+    }
+
+    void
+    add_run(const T* p, size_t n, ptrdiff_t stride) {
+      if(stride == 1 || stride == -1) {
+        p = forward_run(p, n, stride);
+        while(n > 0) {
+          size_t count = n < size_t(PAIRWISE_BLOCK) - in_block_ ? n : size_t(PAIRWISE_BLOCK) - in_block_;
+
+          block_ += run_sum<V>(p, count);
+          add_count(count);
+          p += count;
+          n -= count;
+        }
+        return;
+      }
+      for(size_t i = 0; i < n; ++i) {
+        block_ += V(p[ptrdiff_t(i) * stride]);
+        add_count(1);
+      }
+    }
+
+    V
+    result() const {
+      V total(block_);
+
+      for(size_t k = 0; blocks_ >> k; ++k) {
+        if(blocks_ >> k & 1) {
+          total = levels_[k] + total;
+        }
+      }
+      return total;
+    }
+
+  private:
+    void
+    add_count(size_t count) {
+      in_block_ += count;
+      if(in_block_ < size_t(PAIRWISE_BLOCK)) {
+        return;
+      }
+      size_t k = 0;
+
+      for(; blocks_ >> k & 1; ++k) {
+        block_ = levels_[k] + block_;
+      }
+      levels_[k] = block_;
+      ++blocks_;
+      block_ = V();
+      in_block_ = 0;
+    }
+
+    V levels_[8 * sizeof(size_t)];
+    V block_;
+    size_t in_block_;
+    size_t blocks_;
+  };
+
+  template<
+    typename T,
+    typename V = T
+  > struct tkahansum {
+    void
+    reset() {
+      total_ = V();
+      compensation_ = V();
+    }
+
+    void
+    add_run(const T* p, size_t n, ptrdiff_t stride) {
+      for(size_t i = 0; i < n; ++i) {
+        V y = V(p[ptrdiff_t(i) * stride]) - compensation_;
+        V t = total_ + y;
+
+        compensation_ = (t - total_) - y;
+        total_ = t;
+      }
+    }
+
+    V
+    result() const { return total_; }
+
+  private:
+    V total_;
+    V compensation_;
+  };
+
+  /**
+  textremum
+
+  The least element, for O tmin, or the greatest, for O tmax.
+  */
+  template<
+    typename T,
+    typename O
+  > struct textremum {
+    void
+    reset() { empty_ = true; }
+
+    void
+    add_run(const T* p, size_t n, ptrdiff_t stride) {
+      if(n == 0) {
+        return;
+      }
+      if(empty_) {
+        value_ = *p;
+        empty_ = false;
+      }
+      if(stride == 1 || stride == -1) {
+        value_ = simd_reduce<O>(forward_run(p, n, stride), n, value_);
+        return;
+      }
+      for(size_t i = 0; i < n; ++i) {
+        T v[2] = { value_, p[ptrdiff_t(i) * stride] };
+        value_ = O::apply(v);
+      }
+    }
+
+    T
+    result() const {
+      assert(!empty_);
+      return value_;
+    }
+
+  private:
+    T value_;
+    bool empty_;
+  };
+
+  /**
+  targmax
+
+  Index along the reduced axis of the first of its greatest elements.
+  */
+  template<
+    typename T
+  > struct targmax {
+    void
+    reset() { count_ = 0; }
+
+    void
+    add_run(const T* p, size_t n, ptrdiff_t stride) {
+      for(size_t i = 0; i < n; ++i, ++count_) {
+        if(count_ == 0 || p[ptrdiff_t(i) * stride] > best_) {
+          best_ = p[ptrdiff_t(i) * stride];
+          index_ = count_;
+        }
+      }
+    }
+
+    size_t
+    result() const {
+      assert(count_ > 0);
+      return index_;
+    }
+
+  private:
+    T best_;
+    size_t index_;
+    size_t count_;
+  };
+
+  /**
+  add_into
+
+  Adds the row of elements from p at stride to the elements of total, with the vector kernel
+  where the row is dense and its elements are V.
+  */
+  template<
+    typename V,
+    typename T
+  > void
+  add_into(std::vector<V>& total, const T* p, ptrdiff_t stride) {
+    for(size_t j = 0; j < total.size(); ++j) {
+      total[j] += V(p[ptrdiff_t(j) * stride]);
+    }
+  }
+
+  template<
+    typename V
+  > void
+  add_into(std::vector<V>& total, const V* p, ptrdiff_t stride) {
+    if(stride == 1 && !total.empty()) {
+      const V* from[2] = { &total[0], p };
+      simd_map<tadd>(&total[0], from, total.size());
+      return;
+    }
+    for(size_t j = 0; j < total.size(); ++j) {
+      total[j] += p[ptrdiff_t(j) * stride];
+    }
+  }
+
+  template<
+    typename T,
+    typename V = T
+  > struct tnaiverowsum {
+    void
+    reset(size_t n) { total_.assign(n, V()); }
+
+    void
+    add_row(const T* p, ptrdiff_t stride) {
+      add_into(total_, p, stride);
+    }
+
+    template<typename R>
+    void
+    store(R* to, ptrdiff_t stride) const {
+      for(size_t j = 0; j < total_.size(); ++j) {
+        to[ptrdiff_t(j) * stride] = total_[j];
+      }
+    }
+
+  private:
+    std::vector<V> total_;
+  };
+
+  /**
+  tpairwiserowsum
+
+  Adds up blocks of PAIRWISE_ROWS rows and combines the block sums as tpairwisesum does,
+  keeping a row for each level.
+  */
+  template<
+    typename T,
+    typename V = T
+  > struct tpairwiserowsum {
+    void
+    reset(size_t n) {
+      block_.assign(n, V());
+      in_block_ = 0;
+      blocks_ = 0;
+    }
+
+    void
+    add_row(const T* p, ptrdiff_t stride) {
+      if(block_.empty()) {
+        return;
+      }
+      add_into(block_, p, stride);
+      if(++in_block_ < size_t(PAIRWISE_ROWS)) {
+        return;
+      }
+      size_t k = 0;
+
+      for(; blocks_ >> k & 1; ++k) {
+        add_into(block_, &levels_[k][0], 1);
+      }
+      if(levels_.size() <= k) {
+        levels_.resize(k + 1);
+      }
+      levels_[k].swap(block_);
+      block_.assign(levels_[k].size(), V());
+      ++blocks_;
+      in_block_ = 0;
+    }
+
+    template<typename R>
+    void
+    store(R* to, ptrdiff_t stride) {
+      for(size_t k = 0; k < levels_.size(); ++k) {
+        if(!block_.empty() && blocks_ >> k & 1) {
+          add_into(block_, &levels_[k][0], 1);
+        }
+      }
+      for(size_t j = 0; j < block_.size(); ++j) {
+        to[ptrdiff_t(j) * stride] = block_[j];
+      }
+    }
+
+  private:
+    std::vector<V> block_;
+    std::vector<std::vector<V> > levels_;
+    size_t in_block_;
+    size_t blocks_;
+  };
+
+  template<
+    typename T,
+    typename V = T
+  > struct tkahanrowsum {
+    void
+    reset(size_t n) {
+      total_.assign(n, V());
+      compensation_.assign(n, V());
+    }
+
+    void
+    add_row(const T* p, ptrdiff_t stride) {
+      for(size_t j = 0; j < total_.size(); ++j) {
+        V y = V(p[ptrdiff_t(j) * stride]) - compensation_[j];
+        V t = total_[j] + y;
+
+        compensation_[j] = (t - total_[j]) - y;
+        total_[j] = t;
+      }
+    }
+
+    template<typename R>
+    void
+    store(R* to, ptrdiff_t stride) const {
+      for(size_t j = 0; j < total_.size(); ++j) {
+        to[ptrdiff_t(j) * stride] = total_[j];
+      }
+    }
+
+  private:
+    std::vector<V> total_;
+    std::vector<V> compensation_;
+  };
+
+  template<
+    typename T,
+    typename O
+  > struct textremumrow {
+    void
+    reset(size_t n) {
+      value_.resize(n);
+      empty_ = true;
+    }
+
+    void
+    add_row(const T* p, ptrdiff_t stride) {
+      if(value_.empty()) {
+        return;
+      }
+      if(empty_) {
+        for(size_t j = 0; j < value_.size(); ++j) {
+          value_[j] = p[ptrdiff_t(j) * stride];
+        }
+        empty_ = false;
+        return;
+      }
+      if(stride == 1) {
+        const T* from[2] = { &value_[0], p };
+        simd_map<O>(&value_[0], from, value_.size());
+        return;
+      }
+      for(size_t j = 0; j < value_.size(); ++j) {
+        T v[2] = { value_[j], p[ptrdiff_t(j) * stride] };
+        value_[j] = O::apply(v);
+      }
+    }
+
+    template<typename R>
+    void
+    store(R* to, ptrdiff_t stride) const {
+      assert(value_.empty() || !empty_);
+      for(size_t j = 0; j < value_.size(); ++j) {
+        to[ptrdiff_t(j) * stride] = value_[j];
+      }
+    }
+
+  private:
+    std::vector<T> value_;
+    bool empty_;
+  };
+
+  template<
+    typename T
+  > struct targmaxrow {
+    void
+    reset(size_t n) {
+      best_.resize(n);
+      index_.assign(n, 0);
+      count_ = 0;
+    }
+
+    void
+    add_row(const T* p, ptrdiff_t stride) {
+      for(size_t j = 0; j < best_.size(); ++j) {
+        if(count_ == 0 || p[ptrdiff_t(j) * stride] > best_[j]) {
+          best_[j] = p[ptrdiff_t(j) * stride];
+          index_[j] = count_;
+        }
+      }
+      ++count_;
+    }
+
+    void
+    store(size_t* to, ptrdiff_t stride) const {
+      assert(best_.empty() || count_ > 0);
+      for(size_t j = 0; j < index_.size(); ++j) {
+        to[ptrdiff_t(j) * stride] = index_[j];
+      }
+    }
+
+  private:
+    std::vector<T> best_;
+    std::vector<size_t> index_;
+    size_t count_;
+  };
+
+  /**
+  treduction
+
+  Plan of a reduction of M of the N axes of an array with a strided layout.  The result is a
+  dense, row major array over the kept axes, in their order.  Where the axis with the least
+  stride is reduced, each result element is reduced in turn from runs along it.  Where it is
+  kept, a whole row of results along it is reduced at once, a row of the input at a time, so
+  that the inner loop still walks the input in storage order.  Runs and rows of the remaining
+  reduced axes are visited in decreasing order of stride.
+  */
+  template<
+    typename T,
+    size_t N,
+    size_t M
+  > struct treduction {
+    enum{ K = N - M };
+    static_assert(M > 0 && M < N, "reductions keep at least one axis and reduce at least one");
+
+    typedef std::array<size_t, K> kept_index;
+    typedef std::array<size_t, M> reduced_index;
+
+    template<typename X>
+    treduction(const X& array, const reduced_index& axes) : row_axis_(K), size_(1) {
+      typename X::index_type origin = {};
+      std::array<typename X::difference_type, N> strides(layout_strides(array.layout()));
+      bool reduced[N] = {};
+
+      base_ = array.begin().data() + array.layout().get_stride(origin);
+      for(size_t m = 0; m < M; ++m) {
+        assert(axes[m] < N && !reduced[axes[m]]);
+        reduced[axes[m]] = true;
+        reduced_dims_[m] = array.dim(axes[m]);
+        reduced_strides_[m] = strides[axes[m]];
+        size_ *= reduced_dims_[m];
+      }
+      for(size_t m = 1; m < M; ++m) {
+        for(size_t n = m; n > 0 && magnitude(reduced_strides_[n - 1]) < magnitude(reduced_strides_[n]); --n) {
+          std::swap(reduced_dims_[n - 1], reduced_dims_[n]);
+          std::swap(reduced_strides_[n - 1], reduced_strides_[n]);
+        }
+      }
+
+      size_t least(0);
+      bool found(false);
+
+      for(size_t j = 0, k = 0; j < N; ++j) {
+        if(array.dim(j) > 1 && (!found || magnitude(strides[j]) < least)) {
+          least = magnitude(strides[j]);
+          found = true;
+          row_axis_ = reduced[j] ? size_t(K) : k;
+        }
+        if(!reduced[j]) {
+          kept_dims_[k] = array.dim(j);
+          kept_strides_[k] = strides[j];
+          ++k;
+        }
+      }
+    }
+
+    /**
+    result_layout
+
+    Layout of the result, over the kept axes.
+    */
+    trectlayout<K>
+    result_layout() const { return trectlayout<K>(kept_dims_); }
+
+    /**
+    size
+
+    Number of elements reduced into each result element.
+    */
+    size_t
+    size() const { return size_; }
+
+    /**
+    reduce
+
+    Reduces into the data of a result with result_layout, with the accumulator runs when the
+    least strided axis is reduced and rows when it is kept.
+    */
+    template<
+      typename R,
+      typename AR,
+      typename AW
+    > void
+    reduce(R* to, AR runs, AW rows) const {
+      if(row_axis_ == K) {
+        reduce_runs(to, runs);
+      }
+      else {
+        reduce_rows(to, rows);
+      }
+    }
+
+  private:
+    static size_t
+    magnitude(ptrdiff_t stride) { return stride < 0 ? size_t(-stride) : size_t(stride); }
+
+    /**
+    next
+
+    Steps idx to the next position in row major order within dims, leaving axis skip alone.
+    Returns false after the last position.
+    */
+    template<size_t R>
+    static bool
+    next(std::array<size_t, R>& idx, const std::array<size_t, R>& dims, size_t skip = R) {
+      for(size_t k = R; k-- > 0;) {
+        if(k == skip) {
+          continue;
+        }
+        if(++idx[k] < dims[k]) {
+          return true;
+        }
+        idx[k] = 0;
+      }
+      return false;
+    }
+
+    template<size_t R>
+    static ptrdiff_t
+    offset(const std::array<size_t, R>& idx, const std::array<ptrdiff_t, R>& strides, size_t count = R) {
+      ptrdiff_t result(0);
+
+      for(size_t k = 0; k < count; ++k) {
+        result += ptrdiff_t(idx[k]) * strides[k];
+      }
+      return result;
+    }
+
+    bool
+    empty() const {
+      for(size_t k = 0; k < K; ++k) {
+        if(kept_dims_[k] == 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    template<
+      typename R,
+      typename A
+    > void
+    reduce_runs(R* to, A& acc) const {
+      kept_index idx = {};
+
+      if(empty()) {
+        return;
+      }
+      do {
+        const T* p = base_ + offset(idx, kept_strides_);
+        reduced_index r = {};
+
+        acc.reset();
+        if(size_ > 0) {
+          do {
+            acc.add_run(p + offset(r, reduced_strides_, M - 1), reduced_dims_[M - 1], reduced_strides_[M - 1]);
+          } while(next(r, reduced_dims_, M - 1));
+        }
+        *to++ = acc.result();
+      } while(next(idx, kept_dims_));
+    }
+
+    template<
+      typename R,
+      typename A
+    > void
+    reduce_rows(R* to, A& acc) const {
+      std::array<ptrdiff_t, K> to_strides;
+      kept_index idx = {};
+      ptrdiff_t stride(1);
+
+      if(empty()) {
+        return;
+      }
+      for(size_t k = K; k-- > 0;) {
+        to_strides[k] = stride;
+        stride *= ptrdiff_t(kept_dims_[k]);
+      }
+      do {
+        const T* p = base_ + offset(idx, kept_strides_);
+        reduced_index r = {};
+
+        acc.reset(kept_dims_[row_axis_]);
+        if(size_ > 0) {
+          do {
+            acc.add_row(p + offset(r, reduced_strides_), kept_strides_[row_axis_]);
+          } while(next(r, reduced_dims_));
+        }
+        acc.store(to + offset(idx, to_strides), to_strides[row_axis_]);
+      } while(next(idx, kept_dims_, row_axis_));
+    }
+
+    const T* base_;
+    kept_index kept_dims_;
+    std::array<ptrdiff_t, K> kept_strides_;
+    reduced_index reduced_dims_;
+    std::array<ptrdiff_t, M> reduced_strides_;
+    size_t row_axis_;
+    size_t size_;
+  };
+
+  /**
+  sum_as
+
+  Sum of a multiarray with a strided layout over the given axes, as a dense, row major array
+  over the others, adding the elements up in V, as summation says.
+  */
+  template<
+    typename V,
+    size_t M,
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<V, N - M>
+  sum_as(const tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<size_t, M>& axes, summation_type summation = SUM_PAIRWISE) {
+    typedef typename std::remove_const<T>::type value_type;
+    treduction<value_type, N, M> plan(array, axes);
+    tmultiarray<V, N - M> result(plan.result_layout());
+
+    switch(summation) {
+    case SUM_NAIVE:
+      plan.reduce(result.begin().data(), tnaivesum<value_type, V>(), tnaiverowsum<value_type, V>());
+      break;
+    case SUM_KAHAN:
+      plan.reduce(result.begin().data(), tkahansum<value_type, V>(), tkahanrowsum<value_type, V>());
+      break;
+    default:
+      plan.reduce(result.begin().data(), tpairwisesum<value_type, V>(), tpairwiserowsum<value_type, V>());
+      break;
+    }
+    return result;
+  }
+
+  /**
+  sum
+
+  Sum of a multiarray with a strided layout over the given axes, as a dense, row major array
+  over the others.
+  */
+  template<
+    size_t M,
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename std::remove_const<T>::type, N - M>
+  sum(const tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<size_t, M>& axes, summation_type summation = SUM_PAIRWISE) {
+    return sum_as<typename std::remove_const<T>::type>(array, axes, summation);
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename std::remove_const<T>::type, N - 1>
+  sum(const tmultiarray<T, N, PT, S, D, W, L, A>& array, size_t axis, summation_type summation = SUM_PAIRWISE) {
+    std::array<size_t, 1> axes = {{ axis }};
+    return sum(array, axes, summation);
+  }
+
+  /**
+  tmeantype
+
+  Type of the mean of elements T: T itself for floating point, double otherwise.
+  */
+  template<
+    typename T
+  > struct tmeantype {
+    typedef typename std::conditional<std::is_floating_point<T>::value, T, double>::type type;
+  };
+
+  /**
+  divide_by_count
+
+  Turns a dense array of sums, each of count elements, into their means.
+  */
+  template<
+    typename V,
+    size_t K
+  > void
+  divide_by_count(tmultiarray<V, K>& total, size_t count) {
+    assert(count > 0);
+    for(V* p = total.begin().data(); p != total.end().data(); ++p) {
+      *p /= V(count);
+    }
+  }
+
+  /**
+  mean
+
+  Mean of a multiarray over the given axes, which must not be empty, summed as sum does but in
+  the type of the mean, so that a sum of integers cannot overflow.
+  */
+  template<
+    size_t M,
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename tmeantype<typename std::remove_const<T>::type>::type, N - M>
+  mean(const tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<size_t, M>& axes, summation_type summation = SUM_PAIRWISE) {
+    typedef typename tmeantype<typename std::remove_const<T>::type>::type mean_type;
+    typedef typename std::remove_const<T>::type value_type;
+    tmultiarray<mean_type, N - M> result(sum_as<mean_type>(array, axes, summation));
+
+    divide_by_count(result, treduction<value_type, N, M>(array, axes).size());
+    return result;
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename tmeantype<typename std::remove_const<T>::type>::type, N - 1>
+  mean(const tmultiarray<T, N, PT, S, D, W, L, A>& array, size_t axis, summation_type summation = SUM_PAIRWISE) {
+    std::array<size_t, 1> axes = {{ axis }};
+    return mean(array, axes, summation);
+  }
+
+  /**
+  min
+
+  Least element of a multiarray over the given axes, which must not be empty.
+  */
+  template<
+    size_t M,
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename std::remove_const<T>::type, N - M>
+  min(const tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<size_t, M>& axes) {
+    typedef typename std::remove_const<T>::type value_type;
+    treduction<value_type, N, M> plan(array, axes);
+    tmultiarray<value_type, N - M> result(plan.result_layout());
+
+    plan.reduce(result.begin().data(), textremum<value_type, tmin>(), textremumrow<value_type, tmin>());
+    return result;
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename std::remove_const<T>::type, N - 1>
+  min(const tmultiarray<T, N, PT, S, D, W, L, A>& array, size_t axis) {
+    std::array<size_t, 1> axes = {{ axis }};
+    return min(array, axes);
+  }
+
+  /**
+  max
+
+  Greatest element of a multiarray over the given axes, which must not be empty.
+  */
+  template<
+    size_t M,
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename std::remove_const<T>::type, N - M>
+  max(const tmultiarray<T, N, PT, S, D, W, L, A>& array, const std::array<size_t, M>& axes) {
+    typedef typename std::remove_const<T>::type value_type;
+    treduction<value_type, N, M> plan(array, axes);
+    tmultiarray<value_type, N - M> result(plan.result_layout());
+
+    plan.reduce(result.begin().data(), textremum<value_type, tmax>(), textremumrow<value_type, tmax>());
+    return result;
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<typename std::remove_const<T>::type, N - 1>
+  max(const tmultiarray<T, N, PT, S, D, W, L, A>& array, size_t axis) {
+    std::array<size_t, 1> axes = {{ axis }};
+    return max(array, axes);
+  }
+
+  /**
+  argmax
+
+  Index along axis of the first greatest element, for each position of the other axes.  The
+  axis must not be empty.
+  */
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename L,
+    typename A
+  > tmultiarray<size_t, N - 1>
+  argmax(const tmultiarray<T, N, PT, S, D, W, L, A>& array, size_t axis) {
+    typedef typename std::remove_const<T>::type value_type;
+    std::array<size_t, 1> axes = {{ axis }};
+    treduction<value_type, N, 1> plan(array, axes);
+    tmultiarray<size_t, N - 1> result(plan.result_layout());
+
+    plan.reduce(result.begin().data(), targmax<value_type>(), targmaxrow<value_type>());
+    return result;
+  }
+}
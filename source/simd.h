@@ -0,0 +1,820 @@
+/*
+ *    simd.h
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#pragma once
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "arraylayouts.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define MARRAY_SIMD_X86
+#define MARRAY_TARGET_SSE2
+#define MARRAY_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define MARRAY_TARGET_AVX512 __attribute__((target("avx512f")))
+#include <immintrin.h>
+#endif
+
+namespace marray {
+
+  /**
+  simd_isa
+
+  The instruction sets the elementwise kernels are written for, in increasing order of
+  width.  AVX2 is used only together with FMA.
+  */
+  enum simd_isa { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512 };
+
+  /**
+  simd_supported
+
+  The widest instruction set this machine and operating system support.
+  */
+  inline simd_isa
+  simd_supported() {
+#ifdef MARRAY_SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")) {
+      return SIMD_AVX512;
+    }
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return SIMD_AVX2;
+    }
+    return SIMD_SSE2;
+#else
+    return SIMD_SCALAR;
+#endif
+  }
+
+  inline simd_isa&
+  simd_selected() {
+    static simd_isa result(simd_supported());
+    return result;
+  }
+
+  /**
+  simd_active
+
+  The instruction set the kernels dispatch to, the widest supported unless simd_use has
+  narrowed it.
+  */
+  inline simd_isa
+  simd_active() { return simd_selected(); }
+
+  /**
+  simd_use
+
+  Makes the kernels dispatch to isa, or to the widest supported set if isa is not supported,
+  and returns the set used before.  Meant for tests and benchmarks; not thread safe.
+  */
+  inline simd_isa
+  simd_use(simd_isa isa) {
+    simd_isa result(simd_selected());
+    simd_isa supported(simd_supported());
+
+    simd_selected() = isa < supported ? isa : supported;
+    return result;
+  }
+
+  /**
+  tsimdtype
+
+  Element types that have vector kernels.  Other types go through the scalar loop.
+  */
+  template<
+    typename T
+  > struct tsimdtype : std::integral_constant<bool,
+    std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, int32_t>::value> {};
+
+  /*
+  The elementwise operations.  Each applies to the N operands at one position, here one
+  element of each; the vector traits apply it to a vector of each.  Integer arithmetic wraps,
+  as the vector instructions do.  min and max return the second operand where the operands
+  do not compare, fma rounds once, and select_less picks the third operand where the first
+  is less than the second and the fourth otherwise.
+  */
+  struct tadd {
+    template<typename T>
+    static T apply(const T (&v)[2]) { return v[0] + v[1]; }
+
+    static int32_t
+    apply(const int32_t (&v)[2]) { return static_cast<int32_t>(uint32_t(v[0]) + uint32_t(v[1])); }
+  };
+
+  struct tmul {
+    template<typename T>
+    static T apply(const T (&v)[2]) { return v[0] * v[1]; }
+
+    static int32_t
+    apply(const int32_t (&v)[2]) { return static_cast<int32_t>(uint32_t(v[0]) * uint32_t(v[1])); }
+  };
+
+  struct tfma {
+    template<typename T>
+    static T apply(const T (&v)[3]) { return v[0] * v[1] + v[2]; }
+
+    static float
+    apply(const float (&v)[3]) { return std::fma(v[0], v[1], v[2]); }
+
+    static double
+    apply(const double (&v)[3]) { return std::fma(v[0], v[1], v[2]); }
+
+    static int32_t
+    apply(const int32_t (&v)[3]) {
+      return static_cast<int32_t>(uint32_t(v[0]) * uint32_t(v[1]) + uint32_t(v[2]));
+    }
+  };
+
+  struct tmin {
+    template<typename T>
+    static T apply(const T (&v)[2]) { return v[0] < v[1] ? v[0] : v[1]; }
+  };
+
+  struct tmax {
+    template<typename T>
+    static T apply(const T (&v)[2]) { return v[0] > v[1] ? v[0] : v[1]; }
+  };
+
+  struct tabs {
+    template<typename T>
+    static T apply(const T (&v)[1]) { return v[0] < T(0) ? -v[0] : v[0]; }
+
+    static float
+    apply(const float (&v)[1]) { return std::fabs(v[0]); }
+
+    static double
+    apply(const double (&v)[1]) { return std::fabs(v[0]); }
+
+    static int32_t
+    apply(const int32_t (&v)[1]) { return v[0] < 0 ? static_cast<int32_t>(0u - uint32_t(v[0])) : v[0]; }
+  };
+
+  struct tselect_less {
+    template<typename T>
+    static T apply(const T (&v)[4]) { return v[0] < v[1] ? v[2] : v[3]; }
+  };
+
+  /**
+  scalar_map
+
+  to[i] = O(from[0][i], ...) for i in [begin, end), one element at a time.
+  */
+  template<
+    typename O,
+    size_t N,
+    typename T
+  > void
+  scalar_map(T* to, const T* const (&from)[N], size_t begin, size_t end) {
+    for(size_t i = begin; i < end; ++i) {
+      T v[N];
+      for(size_t k = 0; k < N; ++k) {
+        v[k] = from[k][i];
+      }
+      to[i] = O::apply(v);
+    }
+  }
+
+  template<
+    typename T
+  > void
+  scalar_fill(T* to, const T& value, size_t begin, size_t end) {
+    for(size_t i = begin; i < end; ++i) {
+      to[i] = value;
+    }
+  }
+
+  /**
+  scalar_reduce
+
+  value folded with from[i] by O for i in [begin, end), in order.
+  */
+  template<
+    typename O,
+    typename T
+  > T
+  scalar_reduce(const T* from, size_t begin, size_t end, T value) {
+    for(size_t i = begin; i < end; ++i) {
+      T v[2] = { value, from[i] };
+      value = O::apply(v);
+    }
+    return value;
+  }
+
+  /**
+  simd_head
+
+  Number of elements of to, at most n, before the first one aligned for a vector store of
+  V::BYTES.  All of them when to is not aligned to its element type.
+  */
+  template<
+    typename V,
+    typename T
+  > size_t
+  simd_head(const T* to, size_t n) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(to);
+    size_t result = address % sizeof(T) ? n : ((V::BYTES - address % V::BYTES) % V::BYTES) / sizeof(T);
+
+    return result < n ? result : n;
+  }
+
+#ifdef MARRAY_SIMD_X86
+  /**
+  tsimd
+
+  Vector traits for elements T under the instruction set I: the vector type, its WIDTH in
+  elements and BYTES, unaligned loads, aligned stores, a broadcast, and apply for each of the
+  operations.  SSE2 has no fused multiply add, so its fma of floating point falls back to
+  std::fma an element at a time, keeping the results of every instruction set the same.
+  */
+  template<
+    typename T,
+    simd_isa I
+  > struct tsimd;
+
+  template<> struct tsimd<float, SIMD_SSE2> {
+    typedef __m128 type;
+    enum{ WIDTH = 4, BYTES = 16 };
+
+    static type load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, type v) { _mm_store_ps(p, v); }
+    static type set(float value) { return _mm_set1_ps(value); }
+
+    static type apply(tadd, const type (&v)[2]) { return _mm_add_ps(v[0], v[1]); }
+    static type apply(tmul, const type (&v)[2]) { return _mm_mul_ps(v[0], v[1]); }
+    static type apply(tmin, const type (&v)[2]) { return _mm_min_ps(v[0], v[1]); }
+    static type apply(tmax, const type (&v)[2]) { return _mm_max_ps(v[0], v[1]); }
+    static type apply(tabs, const type (&v)[1]) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v[0]); }
+
+    static type
+    apply(tfma, const type (&v)[3]) {
+      alignas(16) float a[4], b[4], c[4];
+
+      _mm_store_ps(a, v[0]);
+      _mm_store_ps(b, v[1]);
+      _mm_store_ps(c, v[2]);
+      for(size_t k = 0; k < 4; ++k) {
+        a[k] = std::fma(a[k], b[k], c[k]);
+      }
+      return _mm_load_ps(a);
+    }
+
+    static type
+    apply(tselect_less, const type (&v)[4]) {
+      type mask = _mm_cmplt_ps(v[0], v[1]);
+      return _mm_or_ps(_mm_and_ps(mask, v[2]), _mm_andnot_ps(mask, v[3]));
+    }
+  };
+
+  template<> struct tsimd<double, SIMD_SSE2> {
+    typedef __m128d type;
+    enum{ WIDTH = 2, BYTES = 16 };
+
+    static type load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, type v) { _mm_store_pd(p, v); }
+    static type set(double value) { return _mm_set1_pd(value); }
+
+    static type apply(tadd, const type (&v)[2]) { return _mm_add_pd(v[0], v[1]); }
+    static type apply(tmul, const type (&v)[2]) { return _mm_mul_pd(v[0], v[1]); }
+    static type apply(tmin, const type (&v)[2]) { return _mm_min_pd(v[0], v[1]); }
+    static type apply(tmax, const type (&v)[2]) { return _mm_max_pd(v[0], v[1]); }
+    static type apply(tabs, const type (&v)[1]) { return _mm_andnot_pd(_mm_set1_pd(-0.0), v[0]); }
+
+    static type
+    apply(tfma, const type (&v)[3]) {
+      alignas(16) double a[2], b[2], c[2];
+
+      _mm_store_pd(a, v[0]);
+      _mm_store_pd(b, v[1]);
+      _mm_store_pd(c, v[2]);
+      return _mm_set_pd(std::fma(a[1], b[1], c[1]), std::fma(a[0], b[0], c[0]));
+    }
+
+    static type
+    apply(tselect_less, const type (&v)[4]) {
+      type mask = _mm_cmplt_pd(v[0], v[1]);
+      return _mm_or_pd(_mm_and_pd(mask, v[2]), _mm_andnot_pd(mask, v[3]));
+    }
+  };
+
+  template<> struct tsimd<int32_t, SIMD_SSE2> {
+    typedef __m128i type;
+    enum{ WIDTH = 4, BYTES = 16 };
+
+    static type load(const int32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void store(int32_t* p, type v) { _mm_store_si128(reinterpret_cast<__m128i*>(p), v); }
+    static type set(int32_t value) { return _mm_set1_epi32(value); }
+
+    static type
+    select(type mask, type x, type y) { return _mm_or_si128(_mm_and_si128(mask, x), _mm_andnot_si128(mask, y)); }
+
+    /*
+    SSE2 multiplies only the even lanes into 64 bits; the odd lanes are shifted down and
+    multiplied apart, and the low halves of both interleaved back.
+    */
+    static type
+    multiply(type a, type b) {
+      type even = _mm_mul_epu32(a, b);
+      type odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+      return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    static type apply(tadd, const type (&v)[2]) { return _mm_add_epi32(v[0], v[1]); }
+    static type apply(tmul, const type (&v)[2]) { return multiply(v[0], v[1]); }
+    static type apply(tfma, const type (&v)[3]) { return _mm_add_epi32(multiply(v[0], v[1]), v[2]); }
+    static type apply(tmin, const type (&v)[2]) { return select(_mm_cmplt_epi32(v[0], v[1]), v[0], v[1]); }
+    static type apply(tmax, const type (&v)[2]) { return select(_mm_cmpgt_epi32(v[0], v[1]), v[0], v[1]); }
+    static type apply(tselect_less, const type (&v)[4]) { return select(_mm_cmplt_epi32(v[0], v[1]), v[2], v[3]); }
+
+    static type
+    apply(tabs, const type (&v)[1]) {
+      type sign = _mm_srai_epi32(v[0], 31);
+      return _mm_sub_epi32(_mm_xor_si128(v[0], sign), sign);
+    }
+  };
+
+  template<> struct tsimd<float, SIMD_AVX2> {
+    typedef __m256 type;
+    enum{ WIDTH = 8, BYTES = 32 };
+
+    MARRAY_TARGET_AVX2 static type load(const float* p) { return _mm256_loadu_ps(p); }
+    MARRAY_TARGET_AVX2 static void store(float* p, type v) { _mm256_store_ps(p, v); }
+    MARRAY_TARGET_AVX2 static type set(float value) { return _mm256_set1_ps(value); }
+
+    MARRAY_TARGET_AVX2 static type apply(tadd, const type (&v)[2]) { return _mm256_add_ps(v[0], v[1]); }
+    MARRAY_TARGET_AVX2 static type apply(tmul, const type (&v)[2]) { return _mm256_mul_ps(v[0], v[1]); }
+    MARRAY_TARGET_AVX2 static type apply(tfma, const type (&v)[3]) { return _mm256_fmadd_ps(v[0], v[1], v[2]); }
+    MARRAY_TARGET_AVX2 static type apply(tmin, const type (&v)[2]) { return _mm256_min_ps(v[0], v[1]); }
+    MARRAY_TARGET_AVX2 static type apply(tmax, const type (&v)[2]) { return _mm256_max_ps(v[0], v[1]); }
+    MARRAY_TARGET_AVX2 static type apply(tabs, const type (&v)[1]) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v[0]); }
+
+    MARRAY_TARGET_AVX2 static type
+    apply(tselect_less, const type (&v)[4]) { return _mm256_blendv_ps(v[3], v[2], _mm256_cmp_ps(v[0], v[1], _CMP_LT_OQ)); }
+  };
+
+  template<> struct tsimd<double, SIMD_AVX2> {
+    typedef __m256d type;
+    enum{ WIDTH = 4, BYTES = 32 };
+
+    MARRAY_TARGET_AVX2 static type load(const double* p) { return _mm256_loadu_pd(p); }
+    MARRAY_TARGET_AVX2 static void store(double* p, type v) { _mm256_store_pd(p, v); }
+    MARRAY_TARGET_AVX2 static type set(double value) { return _mm256_set1_pd(value); }
+
+    MARRAY_TARGET_AVX2 static type apply(tadd, const type (&v)[2]) { return _mm256_add_pd(v[0], v[1]); }
+    MARRAY_TARGET_AVX2 static type apply(tmul, const type (&v)[2]) { return _mm256_mul_pd(v[0], v[1]); }
+    MARRAY_TARGET_AVX2 static type apply(tfma, const type (&v)[3]) { return _mm256_fmadd_pd(v[0], v[1], v[2]); }
+    MARRAY_TARGET_AVX2 static type apply(tmin, const type (&v)[2]) { return _mm256_min_pd(v[0], v[1]); }
+    MARRAY_TARGET_AVX2 static type apply(tmax, const type (&v)[2]) { return _mm256_max_pd(v[0], v[1]); }
+    MARRAY_TARGET_AVX2 static type apply(tabs, const type (&v)[1]) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), v[0]); }
+
+    MARRAY_TARGET_AVX2 static type
+    apply(tselect_less, const type (&v)[4]) { return _mm256_blendv_pd(v[3], v[2], _mm256_cmp_pd(v[0], v[1], _CMP_LT_OQ)); }
+  };
+
+  template<> struct tsimd<int32_t, SIMD_AVX2> {
+    typedef __m256i type;
+    enum{ WIDTH = 8, BYTES = 32 };
+
+    MARRAY_TARGET_AVX2 static type load(const int32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    MARRAY_TARGET_AVX2 static void store(int32_t* p, type v) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+    MARRAY_TARGET_AVX2 static type set(int32_t value) { return _mm256_set1_epi32(value); }
+
+    MARRAY_TARGET_AVX2 static type apply(tadd, const type (&v)[2]) { return _mm256_add_epi32(v[0], v[1]); }
+    MARRAY_TARGET_AVX2 static type apply(tmul, const type (&v)[2]) { return _mm256_mullo_epi32(v[0], v[1]); }
+    MARRAY_TARGET_AVX2 static type apply(tfma, const type (&v)[3]) { return _mm256_add_epi32(_mm256_mullo_epi32(v[0], v[1]), v[2]); }
+    MARRAY_TARGET_AVX2 static type apply(tmin, const type (&v)[2]) { return _mm256_min_epi32(v[0], v[1]); }
+    MARRAY_TARGET_AVX2 static type apply(tmax, const type (&v)[2]) { return _mm256_max_epi32(v[0], v[1]); }
+    MARRAY_TARGET_AVX2 static type apply(tabs, const type (&v)[1]) { return _mm256_abs_epi32(v[0]); }
+
+    MARRAY_TARGET_AVX2 static type
+    apply(tselect_less, const type (&v)[4]) { return _mm256_blendv_epi8(v[3], v[2], _mm256_cmpgt_epi32(v[1], v[0])); }
+  };
+
+  template<> struct tsimd<float, SIMD_AVX512> {
+    typedef __m512 type;
+    enum{ WIDTH = 16, BYTES = 64 };
+
+    MARRAY_TARGET_AVX512 static type load(const float* p) { return _mm512_loadu_ps(p); }
+    MARRAY_TARGET_AVX512 static void store(float* p, type v) { _mm512_store_ps(p, v); }
+    MARRAY_TARGET_AVX512 static type set(float value) { return _mm512_set1_ps(value); }
+
+    MARRAY_TARGET_AVX512 static type apply(tadd, const type (&v)[2]) { return _mm512_add_ps(v[0], v[1]); }
+    MARRAY_TARGET_AVX512 static type apply(tmul, const type (&v)[2]) { return _mm512_mul_ps(v[0], v[1]); }
+    MARRAY_TARGET_AVX512 static type apply(tfma, const type (&v)[3]) { return _mm512_fmadd_ps(v[0], v[1], v[2]); }
+    MARRAY_TARGET_AVX512 static type apply(tmin, const type (&v)[2]) { return _mm512_min_ps(v[0], v[1]); }
+    MARRAY_TARGET_AVX512 static type apply(tmax, const type (&v)[2]) { return _mm512_max_ps(v[0], v[1]); }
+    MARRAY_TARGET_AVX512 static type apply(tabs, const type (&v)[1]) { return _mm512_abs_ps(v[0]); }
+
+    MARRAY_TARGET_AVX512 static type
+    apply(tselect_less, const type (&v)[4]) { return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(v[0], v[1], _CMP_LT_OQ), v[3], v[2]); }
+  };
+
+  template<> struct tsimd<double, SIMD_AVX512> {
+    typedef __m512d type;
+    enum{ WIDTH = 8, BYTES = 64 };
+
+    MARRAY_TARGET_AVX512 static type load(const double* p) { return _mm512_loadu_pd(p); }
+    MARRAY_TARGET_AVX512 static void store(double* p, type v) { _mm512_store_pd(p, v); }
+    MARRAY_TARGET_AVX512 static type set(double value) { return _mm512_set1_pd(value); }
+
+    MARRAY_TARGET_AVX512 static type apply(tadd, const type (&v)[2]) { return _mm512_add_pd(v[0], v[1]); }
+    MARRAY_TARGET_AVX512 static type apply(tmul, const type (&v)[2]) { return _mm512_mul_pd(v[0], v[1]); }
+    MARRAY_TARGET_AVX512 static type apply(tfma, const type (&v)[3]) { return _mm512_fmadd_pd(v[0], v[1], v[2]); }
+    MARRAY_TARGET_AVX512 static type apply(tmin, const type (&v)[2]) { return _mm512_min_pd(v[0], v[1]); }
+    MARRAY_TARGET_AVX512 static type apply(tmax, const type (&v)[2]) { return _mm512_max_pd(v[0], v[1]); }
+    MARRAY_TARGET_AVX512 static type apply(tabs, const type (&v)[1]) { return _mm512_abs_pd(v[0]); }
+
+    MARRAY_TARGET_AVX512 static type
+    apply(tselect_less, const type (&v)[4]) { return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(v[0], v[1], _CMP_LT_OQ), v[3], v[2]); }
+  };
+
+  template<> struct tsimd<int32_t, SIMD_AVX512> {
+    typedef __m512i type;
+    enum{ WIDTH = 16, BYTES = 64 };
+
+    MARRAY_TARGET_AVX512 static type load(const int32_t* p) { return _mm512_loadu_si512(p); }
+    MARRAY_TARGET_AVX512 static void store(int32_t* p, type v) { _mm512_store_si512(p, v); }
+    MARRAY_TARGET_AVX512 static type set(int32_t value) { return _mm512_set1_epi32(value); }
+
+    MARRAY_TARGET_AVX512 static type apply(tadd, const type (&v)[2]) { return _mm512_add_epi32(v[0], v[1]); }
+    MARRAY_TARGET_AVX512 static type apply(tmul, const type (&v)[2]) { return _mm512_mullo_epi32(v[0], v[1]); }
+    MARRAY_TARGET_AVX512 static type apply(tfma, const type (&v)[3]) { return _mm512_add_epi32(_mm512_mullo_epi32(v[0], v[1]), v[2]); }
+    MARRAY_TARGET_AVX512 static type apply(tmin, const type (&v)[2]) { return _mm512_min_epi32(v[0], v[1]); }
+    MARRAY_TARGET_AVX512 static type apply(tmax, const type (&v)[2]) { return _mm512_max_epi32(v[0], v[1]); }
+    MARRAY_TARGET_AVX512 static type apply(tabs, const type (&v)[1]) { return _mm512_abs_epi32(v[0]); }
+
+    MARRAY_TARGET_AVX512 static type
+    apply(tselect_less, const type (&v)[4]) { return _mm512_mask_blend_epi32(_mm512_cmplt_epi32_mask(v[0], v[1]), v[3], v[2]); }
+  };
+
+  /*
+  The kernels proper, one set per instruction set, all generated by MARRAY_SIMD_KERNELS from
+  the prefix of their names, their function target and the instruction set of the vector
+  traits: the target of a function cannot be a template argument, and the vector traits
+  inline only into functions built for their set.
+
+  A map runs the unaligned head of the destination a scalar at a time, the body a vector at
+  a time with aligned stores, and the tail a scalar at a time.  The operand pointers are
+  copied out because a vector store may alias anything, and the loop over operands is
+  unrolled so that their vectors stay in registers.  A reduction keeps SIMD_ACCUMULATORS
+  vectors of partial results, so that successive operations do not wait on each other, and
+  folds their lanes and the tail in at the end.
+  */
+  enum{ SIMD_ACCUMULATORS = 4 };
+
+#define MARRAY_SIMD_KERNELS(PREFIX, TARGET, ISA) \
+  template< \
+    typename O, \
+    size_t N, \
+    typename T \
+  > TARGET void \
+  PREFIX##_map(T* to, const T* const (&from)[N], size_t n) { \
+    typedef tsimd<T, ISA> V; \
+    size_t i = simd_head<V>(to, n); \
+    const T* operands[N]; \
+ \
+    for(size_t k = 0; k < N; ++k) { \
+      operands[k] = from[k]; \
+    } \
+    scalar_map<O>(to, from, 0, i); \
+    for(; i + V::WIDTH <= n; i += V::WIDTH) { \
+      typename V::type v[N]; \
+      _Pragma("GCC unroll 4") \
+      for(size_t k = 0; k < N; ++k) { \
+        v[k] = V::load(operands[k] + i); \
+      } \
+      V::store(to + i, V::apply(O(), v)); \
+    } \
+    scalar_map<O>(to, from, i, n); \
+  } \
+ \
+  template< \
+    typename T \
+  > TARGET void \
+  PREFIX##_fill(T* to, const T& value, size_t n) { \
+    typedef tsimd<T, ISA> V; \
+    size_t i = simd_head<V>(to, n); \
+    typename V::type v = V::set(value); \
+ \
+    scalar_fill(to, value, 0, i); \
+    for(; i + V::WIDTH <= n; i += V::WIDTH) { \
+      V::store(to + i, v); \
+    } \
+    scalar_fill(to, value, i, n); \
+  } \
+ \
+  template< \
+    typename O, \
+    typename T \
+  > TARGET T \
+  PREFIX##_reduce(const T* from, size_t n, const T& init) { \
+    typedef tsimd<T, ISA> V; \
+    typename V::type acc[SIMD_ACCUMULATORS]; \
+    alignas(64) T lanes[SIMD_ACCUMULATORS * V::WIDTH]; \
+    size_t i = 0; \
+ \
+    _Pragma("GCC unroll 4") \
+    for(size_t k = 0; k < SIMD_ACCUMULATORS; ++k) { \
+      acc[k] = V::set(init); \
+    } \
+    for(; i + SIMD_ACCUMULATORS * V::WIDTH <= n; i += SIMD_ACCUMULATORS * V::WIDTH) { \
+      _Pragma("GCC unroll 4") \
+      for(size_t k = 0; k < SIMD_ACCUMULATORS; ++k) { \
+        typename V::type v[2] = { acc[k], V::load(from + i + k * V::WIDTH) }; \
+        acc[k] = V::apply(O(), v); \
+      } \
+    } \
+    for(; i + V::WIDTH <= n; i += V::WIDTH) { \
+      typename V::type v[2] = { acc[0], V::load(from + i) }; \
+      acc[0] = V::apply(O(), v); \
+    } \
+    _Pragma("GCC unroll 4") \
+    for(size_t k = 0; k < SIMD_ACCUMULATORS; ++k) { \
+      V::store(lanes + k * V::WIDTH, acc[k]); \
+    } \
+    return scalar_reduce<O>(from, i, n, scalar_reduce<O>(lanes, 0, SIMD_ACCUMULATORS * V::WIDTH, init)); \
+  }
+
+  MARRAY_SIMD_KERNELS(sse2, MARRAY_TARGET_SSE2, SIMD_SSE2)
+  MARRAY_SIMD_KERNELS(avx2, MARRAY_TARGET_AVX2, SIMD_AVX2)
+  MARRAY_SIMD_KERNELS(avx512, MARRAY_TARGET_AVX512, SIMD_AVX512)
+
+#undef MARRAY_SIMD_KERNELS
+#endif
+
+  /**
+  simd_map
+
+  to[i] = O(from[0][i], ...) for i in [0, n), by the kernel for simd_active where T has
+  vector kernels and a scalar at a time otherwise.  to may be one of the operands but must
+  not otherwise overlap them.
+  */
+  template<
+    typename O,
+    size_t N,
+    typename T
+  > typename std::enable_if<tsimdtype<T>::value>::type
+  simd_map(T* to, const T* const (&from)[N], size_t n) {
+#ifdef MARRAY_SIMD_X86
+    switch(simd_active()) {
+    case SIMD_AVX512:
+      avx512_map<O>(to, from, n);
+      return;
+    case SIMD_AVX2:
+      avx2_map<O>(to, from, n);
+      return;
+    case SIMD_SSE2:
+      sse2_map<O>(to, from, n);
+      return;
+    default:
+      break;
+    }
+#endif
+    scalar_map<O>(to, from, 0, n);
+  }
+
+  template<
+    typename O,
+    size_t N,
+    typename T
+  > typename std::enable_if<!tsimdtype<T>::value>::type
+  simd_map(T* to, const T* const (&from)[N], size_t n) {
+    scalar_map<O>(to, from, 0, n);
+  }
+
+  /**
+  simd_fill
+
+  Sets the n elements from to to value.
+  */
+  template<
+    typename T
+  > typename std::enable_if<tsimdtype<T>::value>::type
+  simd_fill(T* to, const T& value, size_t n) {
+#ifdef MARRAY_SIMD_X86
+    switch(simd_active()) {
+    case SIMD_AVX512:
+      avx512_fill(to, value, n);
+      return;
+    case SIMD_AVX2:
+      avx2_fill(to, value, n);
+      return;
+    case SIMD_SSE2:
+      sse2_fill(to, value, n);
+      return;
+    default:
+      break;
+    }
+#endif
+    scalar_fill(to, value, 0, n);
+  }
+
+  template<
+    typename T
+  > typename std::enable_if<!tsimdtype<T>::value>::type
+  simd_fill(T* to, const T& value, size_t n) {
+    scalar_fill(to, value, 0, n);
+  }
+
+  /**
+  simd_reduce
+
+  init folded with the n elements from from by O, by the kernel for simd_active where T has
+  vector kernels.  The elements are folded into several partial results, each starting from
+  init, so init must be an identity of O, such as 0 for tadd, or for tmin and tmax may be any
+  of the elements.
+  */
+  template<
+    typename O,
+    typename T
+  > typename std::enable_if<tsimdtype<T>::value, T>::type
+  simd_reduce(const T* from, size_t n, const T& init) {
+#ifdef MARRAY_SIMD_X86
+    switch(simd_active()) {
+    case SIMD_AVX512:
+      return avx512_reduce<O>(from, n, init);
+    case SIMD_AVX2:
+      return avx2_reduce<O>(from, n, init);
+    case SIMD_SSE2:
+      return sse2_reduce<O>(from, n, init);
+    default:
+      break;
+    }
+#endif
+    return scalar_reduce<O>(from, 0, n, init);
+  }
+
+  template<
+    typename O,
+    typename T
+  > typename std::enable_if<!tsimdtype<T>::value, T>::type
+  simd_reduce(const T* from, size_t n, const T& init) {
+    return scalar_reduce<O>(from, 0, n, init);
+  }
+
+  /**
+  data_size
+
+  Number of elements in the data range [begin(), end()) of an array.
+  */
+  template<
+    typename X
+  > size_t
+  data_size(const X& array) {
+    return static_cast<size_t>(array.end().data() - array.begin().data());
+  }
+
+  /**
+  dense_data
+
+  Whether the data range of an array holds its elements densely and in row major order: always
+  for a tarray, and for a multiarray or view where its layout is row_major.
+  */
+  template<
+    typename X
+  > auto
+  dense_data(const X& array, int) -> decltype(row_major(array.layout())) {
+    return row_major(array.layout());
+  }
+
+  template<
+    typename X
+  > bool
+  dense_data(const X&, long) {
+    return true;
+  }
+
+  template<
+    typename X
+  > bool
+  dense_data(const X& array) {
+    return dense_data(array, 0);
+  }
+
+  /*
+  The elementwise operations over the data ranges of arrays: the elements of a tarray, or of a
+  dense multiarray.  Every operand must be dense_data and have as many elements as the
+  destination, which may itself be one of the operands.
+  */
+  template<
+    typename X,
+    typename A,
+    typename B
+  > void
+  elementwise_add(X& to, const A& a, const B& b) {
+    assert(dense_data(to) && dense_data(a) && dense_data(b));
+    assert(data_size(a) == data_size(to) && data_size(b) == data_size(to));
+    const typename X::value_type* from[2] = { a.begin().data(), b.begin().data() };
+    simd_map<tadd>(to.begin().data(), from, data_size(to));
+  }
+
+  template<
+    typename X,
+    typename A,
+    typename B
+  > void
+  elementwise_mul(X& to, const A& a, const B& b) {
+    assert(dense_data(to) && dense_data(a) && dense_data(b));
+    assert(data_size(a) == data_size(to) && data_size(b) == data_size(to));
+    const typename X::value_type* from[2] = { a.begin().data(), b.begin().data() };
+    simd_map<tmul>(to.begin().data(), from, data_size(to));
+  }
+
+  /**
+  elementwise_fma
+
+  to = a * b + c, rounded once.
+  */
+  template<
+    typename X,
+    typename A,
+    typename B,
+    typename C
+  > void
+  elementwise_fma(X& to, const A& a, const B& b, const C& c) {
+    assert(dense_data(to) && dense_data(a) && dense_data(b) && dense_data(c));
+    assert(data_size(a) == data_size(to) && data_size(b) == data_size(to) && data_size(c) == data_size(to));
+    const typename X::value_type* from[3] = { a.begin().data(), b.begin().data(), c.begin().data() };
+    simd_map<tfma>(to.begin().data(), from, data_size(to));
+  }
+
+  template<
+    typename X,
+    typename A,
+    typename B
+  > void
+  elementwise_min(X& to, const A& a, const B& b) {
+    assert(dense_data(to) && dense_data(a) && dense_data(b));
+    assert(data_size(a) == data_size(to) && data_size(b) == data_size(to));
+    const typename X::value_type* from[2] = { a.begin().data(), b.begin().data() };
+    simd_map<tmin>(to.begin().data(), from, data_size(to));
+  }
+
+  template<
+    typename X,
+    typename A,
+    typename B
+  > void
+  elementwise_max(X& to, const A& a, const B& b) {
+    assert(dense_data(to) && dense_data(a) && dense_data(b));
+    assert(data_size(a) == data_size(to) && data_size(b) == data_size(to));
+    const typename X::value_type* from[2] = { a.begin().data(), b.begin().data() };
+    simd_map<tmax>(to.begin().data(), from, data_size(to));
+  }
+
+  template<
+    typename X,
+    typename A
+  > void
+  elementwise_abs(X& to, const A& a) {
+    assert(dense_data(to) && dense_data(a));
+    assert(data_size(a) == data_size(to));
+    const typename X::value_type* from[1] = { a.begin().data() };
+    simd_map<tabs>(to.begin().data(), from, data_size(to));
+  }
+
+  /**
+  elementwise_select_less
+
+  to = a < b ? x : y.
+  */
+  template<
+    typename X,
+    typename A,
+    typename B,
+    typename C,
+    typename E
+  > void
+  elementwise_select_less(X& to, const A& a, const B& b, const C& x, const E& y) {
+    assert(dense_data(to) && dense_data(a) && dense_data(b) && dense_data(x) && dense_data(y));
+    assert(data_size(a) == data_size(to) && data_size(b) == data_size(to) && data_size(x) == data_size(to) && data_size(y) == data_size(to));
+    const typename X::value_type* from[4] = { a.begin().data(), b.begin().data(), x.begin().data(), y.begin().data() };
+    simd_map<tselect_less>(to.begin().data(), from, data_size(to));
+  }
+
+  template<
+    typename X
+  > void
+  elementwise_fill(X& to, const typename X::value_type& value) {
+    assert(dense_data(to));
+    simd_fill(to.begin().data(), value, data_size(to));
+  }
+}
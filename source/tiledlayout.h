@@ -0,0 +1,398 @@
+/*
+ *  tiledlayout.h
+ *
+ *  Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include "multiarray.h"
+
+namespace marray {
+
+  /**
+  ttiledlayout
+
+  Blocked layout.  The array is cut into tiles of fixed extents along every axis, each tile is
+  stored contiguously in row major order, and the tiles themselves are stored in row major
+  order.  Tiles at the upper edges are padded out to full size, so every tile occupies the same
+  contiguous block.  Tile extents must be powers of two, so that finding the tile and the
+  position within it is a shift and a mask per axis.
+  */
+  template<
+    size_t N,
+    typename S = size_t,
+    typename D = ptrdiff_t
+  > struct ttiledlayout {
+
+    typedef S size_type;
+    typedef D difference_type;
+    typedef std::array<S, N> index_type;
+    typedef ttiledlayout<N - 1, S, D> slice_layout;
+
+    enum{ RANK = N };
+    enum{ MAX_INDEX = N - 1 };
+
+    ttiledlayout() : dims_(), shifts_(), strides_(), tile_strides_(), footprint_(0) {}
+
+    ttiledlayout(const index_type& dimensions, const index_type& tile)
+      : dims_(dimensions), shifts_(), strides_(), tile_strides_(), footprint_(0) {
+      size_type stride(1);
+
+      for(size_type j = RANK; j-- > 0;) {
+        assert(tile[j] > 0 && (tile[j] & (tile[j] - 1)) == 0);
+        while((size_type(1) << shifts_[j]) < tile[j]) {
+          ++shifts_[j];
+        }
+        strides_[j] = stride;
+        stride *= tile[j];
+      }
+
+      for(size_type j = RANK; j-- > 0;) {
+        tile_strides_[j] = stride;
+        stride *= tiles(j);
+      }
+      footprint_ = stride;
+    }
+
+    size_type
+    dim(size_type i) const {
+      assert(i < RANK);
+      return dims_[i];
+    }
+
+    /**
+    tile
+
+    Extent of a tile along the i axis.
+    */
+    size_type
+    tile(size_type i) const {
+      assert(i < RANK);
+      return size_type(1) << shifts_[i];
+    }
+
+    /**
+    tiles
+
+    Number of tiles along the i axis.
+    */
+    size_type
+    tiles(size_type i) const {
+      assert(i < RANK);
+      return (dims_[i] + tile(i) - 1) >> shifts_[i];
+    }
+
+    /**
+    tile_footprint
+
+    Number of elements in each tile.
+    */
+    size_type
+    tile_footprint() const {
+      return tile_strides_[MAX_INDEX];
+    }
+
+    /**
+    footprint
+
+    Number of elements in the array, including the padding of the edge tiles.  For a slice it is
+    the index position of the end() pointer in the underlying contiguous array.
+    */
+    size_type
+    footprint() const {
+      return footprint_;
+    }
+
+    /**
+    offset
+
+    The part of the data position contributed by coordinate i along the given axis.  The data
+    position of an index is the sum of these over the axes.
+    */
+    size_type
+    offset(size_type axis, size_type i) const {
+      return (i >> shifts_[axis]) * tile_strides_[axis]
+        + (i & ((size_type(1) << shifts_[axis]) - 1)) * strides_[axis];
+    }
+
+    /**
+    get_stride
+
+    Calculate the data position implied by idx in the contiguous array block.  This is a 'stride'
+    into the data from the data origin.
+    */
+    size_type
+    get_stride(const index_type& idx) const {
+      size_type result(0);
+
+      for(size_type j = 0; j < RANK; ++j) {
+        result += offset(j, idx[j]);
+      }
+      return result;
+    }
+
+    /**
+    get_stride
+
+    As above, but taking the index as a list of coordinates, one per axis.
+    */
+    template<typename... I>
+    size_type
+    get_stride(size_type i, I... rest) const {
+      static_assert(sizeof...(I) + 1 == RANK, "get_stride needs one coordinate per axis");
+      index_type idx = {{ i, static_cast<size_type>(rest)... }};
+      return get_stride(idx);
+    }
+
+    /**
+    slice
+
+    Layout with axis i fixed.  The remaining axes keep their tiling within the parent's data,
+    the fixed coordinate being accounted for by slice_stride.
+    */
+    slice_layout
+    slice(size_type i) const {
+      slice_layout result;
+      size_type k(0);
+
+      for(size_type j = 0; j < RANK; ++j) {
+        if(j != i) {
+          result.dims_[k] = dims_[j];
+          result.shifts_[k] = shifts_[j];
+          result.strides_[k] = strides_[j];
+          result.tile_strides_[k] = tile_strides_[j];
+          ++k;
+        }
+      }
+      result.footprint_ = 1;
+
+      for(size_type j = 0; j < RANK - 1; ++j) {
+        if(result.dims_[j] == 0) {
+          result.footprint_ = 0;
+          break;
+        }
+        result.footprint_ += result.offset(j, result.dims_[j] - 1);
+      }
+      return result;
+    }
+
+  private:
+    template<size_t, typename, typename> friend struct ttiledlayout;
+
+    index_type dims_;
+    index_type shifts_;
+    index_type strides_;
+    index_type tile_strides_;
+    size_type footprint_;
+  };
+
+  /**
+  slice_stride
+
+  Tiled layouts are not linear in the leading coordinate.
+  */
+  template<
+    size_t N,
+    typename S,
+    typename D
+  > S
+  slice_stride(const ttiledlayout<N, S, D>& layout, S i) {
+    return layout.offset(0, i);
+  }
+
+  /**
+  trowslice
+
+  Rows of a tiled layout cross tiles, and are given as rank 1 multiarrays.
+  */
+  template<
+    typename T,
+    typename PT,
+    typename S,
+    typename D
+  > struct trowslice<T, PT, S, D, ttiledlayout<2, S, D> > {
+    typedef tmultiarray<T, 1, PT, S, D, true, ttiledlayout<1, S, D> > type;
+
+    static type
+    row(typename type::iterator begin, const ttiledlayout<2, S, D>& layout) {
+      return type(begin, layout.slice(0));
+    }
+  };
+
+  /**
+  ttileiterator
+
+  Steps through the tiles of a tiled multiarray in storage order, presenting each one as a weak,
+  dense, row major multiarray over its contiguous block.  Edge tiles include their padding;
+  extents() gives the part of the tile that lies inside the array.
+  */
+  template<
+    typename T,
+    size_t N,
+    typename PT = T*,
+    typename S = size_t,
+    typename D = ptrdiff_t
+  > struct ttileiterator {
+    typedef S size_type;
+    typedef D difference_type;
+    typedef PT pointer_type;
+    typedef ttiledlayout<N, S, D> layout_type;
+    typedef typename layout_type::index_type index_type;
+    typedef trectlayout<N, S, D> tile_layout;
+    typedef tmultiarray<T, N, PT, S, D, true, tile_layout> value_type;
+    typedef titerator<T, PT, S, D> iterator;
+
+    ttileiterator(iterator begin, const layout_type& layout, size_type tile = 0)
+      : begin_(begin), layout_(layout), tile_(tile), tile_layout_(tile_extents(layout)) {}
+
+    ttileiterator&
+    operator++() { ++tile_; return *this; }
+
+    ttileiterator
+    operator++(int) { ttileiterator result(*this); ++tile_; return result; }
+
+    /**
+    operator*
+
+    The current tile as a dense multiarray.
+    */
+    value_type
+    operator*() const {
+      return value_type(begin_ + tile_ * layout_.tile_footprint(), tile_layout_);
+    }
+
+    /**
+    origin
+
+    Index in the whole array of the first point of the current tile.
+    */
+    index_type
+    origin() const {
+      index_type result;
+      size_type tile(tile_);
+
+      for(size_type j = N; j-- > 0;) {
+        result[j] = (tile % layout_.tiles(j)) * layout_.tile(j);
+        tile /= layout_.tiles(j);
+      }
+      return result;
+    }
+
+    /**
+    extents
+
+    Dimensions of the part of the current tile that lies inside the array.
+    */
+    index_type
+    extents() const {
+      index_type result(origin());
+
+      for(size_type j = 0; j < N; ++j) {
+        result[j] = std::min(layout_.tile(j), layout_.dim(j) - result[j]);
+      }
+      return result;
+    }
+
+    PT
+    data() const { return (begin_ + tile_ * layout_.tile_footprint()).data(); }
+
+  private:
+    static tile_layout
+    tile_extents(const layout_type& layout) {
+      index_type result;
+
+      for(size_type j = 0; j < N; ++j) {
+        result[j] = layout.tile(j);
+      }
+      return tile_layout(result);
+    }
+
+    iterator begin_;
+    layout_type layout_;
+    size_type tile_;
+    tile_layout tile_layout_;
+  };
+
+  /**
+  tiles_begin, tiles_end
+
+  The range of tiles of a tiled multiarray, of any allocator.  The tiles of a const multiarray 
+  are views over const elements.
+  */
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename A
+  > ttileiterator<T, N, PT, S, D>
+  tiles_begin(tmultiarray<T, N, PT, S, D, W, ttiledlayout<N, S, D>, A>& array) {
+    return ttileiterator<T, N, PT, S, D>(array.begin(), array.layout());
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename A
+  > ttileiterator<const T, N, typename tconstpointer<PT>::type, S, D>
+  tiles_begin(const tmultiarray<T, N, PT, S, D, W, ttiledlayout<N, S, D>, A>& array) {
+    typedef ttileiterator<const T, N, typename tconstpointer<PT>::type, S, D> result_type;
+    return result_type(typename result_type::iterator(array.begin().data()), array.layout());
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename A
+  > ttileiterator<T, N, PT, S, D>
+  tiles_end(tmultiarray<T, N, PT, S, D, W, ttiledlayout<N, S, D>, A>& array) {
+    return ttileiterator<T, N, PT, S, D>(
+      array.begin(),
+      array.layout(),
+      array.layout().footprint() / array.layout().tile_footprint());
+  }
+
+  template<
+    typename T,
+    size_t N,
+    typename PT,
+    typename S,
+    typename D,
+    bool W,
+    typename A
+  > ttileiterator<const T, N, typename tconstpointer<PT>::type, S, D>
+  tiles_end(const tmultiarray<T, N, PT, S, D, W, ttiledlayout<N, S, D>, A>& array) {
+    typedef ttileiterator<const T, N, typename tconstpointer<PT>::type, S, D> result_type;
+    return result_type(
+      typename result_type::iterator(array.begin().data()),
+      array.layout(),
+      array.layout().footprint() / array.layout().tile_footprint());
+  }
+}
@@ -0,0 +1,109 @@
+/*
+ *    allocatortest.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <multiarray.h>
+#include <cstdint>
+#include <catch/catch.hpp>
+
+using namespace marray;
+using namespace std;
+
+/*
+Aligned allocator that counts what it hands out and takes back.
+*/
+template<typename T>
+struct tcountingallocator : taligned_allocator<T, 128> {
+  tcountingallocator(size_t& allocated) : allocated_(&allocated) {}
+  
+  template<typename U>
+  tcountingallocator(const tcountingallocator<U>& rhs) : allocated_(rhs.allocated_) {}
+  
+  T*
+  allocate(size_t n) { *allocated_ += n; return taligned_allocator<T, 128>::allocate(n); }
+  
+  void
+  deallocate(T* ptr, size_t n) { *allocated_ -= n; taligned_allocator<T, 128>::deallocate(ptr, n); }
+  
+  size_t* allocated_;
+};
+
+TEST_CASE("Owning arrays are aligned to a cache line by default","[allocator]") {
+  for(size_t n = 1; n < 20; ++n) {
+    tarray<double> array_(n);
+    REQUIRE(reinterpret_cast<uintptr_t>(array_.begin().data()) % 64 == 0);
+  }
+  
+  array<size_t, 3> index3;
+  index3[0] = 2; index3[1] = 3; index3[2] = 5; 
+  tmultiarray<double, 3> array_3((trectlayout<3>(index3)));
+  REQUIRE(reinterpret_cast<uintptr_t>(array_3.begin().data()) % 64 == 0);
+  
+  array<size_t, 2> index2;
+  index2[0] = 3; index2[1] = 5;
+  tmultiarray<char, 2> array_2((trectlayout<2>(index2)));
+  REQUIRE(reinterpret_cast<uintptr_t>(array_2.begin().data()) % 64 == 0);
+}
+
+TEST_CASE("Owning arrays give their data back to their allocator","[allocator]") {
+  typedef tcountingallocator<double> allocator_type;
+  size_t allocated = 0;
+  
+  {
+    tarray<double, double*, false, size_t, ptrdiff_t, allocator_type> array_(10, allocator_type(allocated));
+    REQUIRE(allocated == 10);
+    REQUIRE(reinterpret_cast<uintptr_t>(array_.begin().data()) % 128 == 0);
+  }
+  REQUIRE(allocated == 0);
+  
+  {
+    array<size_t, 3> index3;
+    index3[0] = 2; index3[1] = 3; index3[2] = 4; 
+    tmultiarray<double, 3, double*, size_t, ptrdiff_t, false, trectlayout<3>, allocator_type> 
+      array_3((trectlayout<3>(index3)), allocator_type(allocated));
+    REQUIRE(allocated == 24);
+    
+    array<size_t, 2> index2;
+    index2[0] = 2; index2[1] = 3;
+    tmultiarray<double, 2, double*, size_t, ptrdiff_t, false, trectlayout<2>, allocator_type> 
+      array_2((trectlayout<2>(index2)), allocator_type(allocated));
+    REQUIRE(allocated == 30);
+  }
+  REQUIRE(allocated == 0);
+}
+
+TEST_CASE("Owning multiarrays can be filled or left uninitialized","[allocator]") {
+  array<size_t, 3> index3;
+  index3[0] = 2; index3[1] = 3; index3[2] = 4; 
+  
+  tmultiarray<double, 3> filled(trectlayout<3>(index3), 1.5);
+  for(tmultiarray<double, 3>::iterator ptr = filled.begin(); ptr != filled.end(); ++ptr) {
+    REQUIRE(*ptr == 1.5);
+  }
+  
+  tmultiarray<double, 3> untouched(trectlayout<3>(index3), uninitialized);
+  REQUIRE(untouched.end() - untouched.begin() == 24);
+  untouched(1, 2, 3) = 2.0;
+  REQUIRE(untouched(1, 2, 3) == 2.0);
+  
+  array<size_t, 2> index2;
+  index2[0] = 2; index2[1] = 3;
+  tmultiarray<int, 2> filled2(trectlayout<2>(index2), 7);
+  REQUIRE(filled2[1][2] == 7);
+}
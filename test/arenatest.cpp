@@ -0,0 +1,120 @@
+/*
+ *    arenatest.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <arena.h>
+#include <multiarray.h>
+#include <cstdint>
+#include <catch/catch.hpp>
+
+using namespace marray;
+using namespace std;
+
+typedef tresource_allocator<double, tarena> arena_allocator;
+typedef tresource_allocator<double, tpool> pool_allocator;
+typedef tmultiarray<double, 2, double*, size_t, ptrdiff_t, false, trectlayout<2>, arena_allocator> arena_array2;
+typedef tmultiarray<double, 3, double*, size_t, ptrdiff_t, false, trectlayout<3>, pool_allocator> pool_array3;
+
+TEST_CASE("Arenas hand out aligned memory and recover it on leaving scope","[arena]") {
+  tarena arena(4096);
+  array<size_t, 2> index2;
+  index2[0] = 3; index2[1] = 5;
+  
+  {
+    tarenascope scope(arena);
+    arena_array2 array_1((trectlayout<2>(index2)), arena_allocator(arena));
+    arena_array2 array_2((trectlayout<2>(index2)), arena_allocator(arena));
+    
+    REQUIRE(arena.owns(array_1.begin().data()));
+    REQUIRE(arena.owns(array_2.begin().data()));
+    REQUIRE(reinterpret_cast<uintptr_t>(array_1.begin().data()) % 64 == 0);
+    REQUIRE(reinterpret_cast<uintptr_t>(array_2.begin().data()) % 64 == 0);
+    REQUIRE(array_2.begin().data() >= array_1.begin().data() + 15);
+    REQUIRE(arena.stats().allocated == 2 * 15 * sizeof(double));
+    
+    array_1(2, 4) = 1.0;
+    array_2(2, 4) = 2.0;
+    REQUIRE(array_1(2, 4) == 1.0);
+  }
+  REQUIRE(arena.mark() == 0);
+  REQUIRE(arena.stats().allocated == 0);
+  REQUIRE(arena.stats().high_water == 2 * 15 * sizeof(double));
+  REQUIRE(arena.stats().fallbacks == 0);
+  
+  void* block = arena.allocate(100, 16);
+  REQUIRE(arena.mark() == 100);
+  arena.deallocate(block, 100, 16);
+  REQUIRE(arena.mark() == 0);
+}
+
+TEST_CASE("Arenas pass requests they cannot serve to the heap","[arena]") {
+  tarena arena(256);
+  tarenascope scope(arena);
+  
+  void* small = arena.allocate(200, 64);
+  void* large = arena.allocate(200, 64);
+  
+  REQUIRE(arena.owns(small));
+  REQUIRE_FALSE(arena.owns(large));
+  REQUIRE(reinterpret_cast<uintptr_t>(large) % 64 == 0);
+  REQUIRE(arena.stats().fallbacks == 1);
+  REQUIRE(arena.stats().allocated == 400);
+  
+  arena.deallocate(large, 200, 64);
+  arena.deallocate(small, 200, 64);
+  REQUIRE(arena.stats().allocated == 0);
+  REQUIRE(arena.stats().high_water == 400);
+}
+
+TEST_CASE("Pools reuse the blocks given back to them","[pool]") {
+  tpool pool(1024, 4096);
+  array<size_t, 3> index3;
+  index3[0] = 2; index3[1] = 3; index3[2] = 4; 
+  
+  REQUIRE(pool.block_size(1) == 64);
+  REQUIRE(pool.block_size(65) == 128);
+  REQUIRE(pool.block_size(1024) == 1024);
+  
+  double* first(0);
+  {
+    pool_array3 array_3((trectlayout<3>(index3)), pool_allocator(pool));
+    first = array_3.begin().data();
+    REQUIRE(reinterpret_cast<uintptr_t>(first) % 64 == 0);
+    REQUIRE(pool.stats().allocated == 24 * sizeof(double));
+  }
+  REQUIRE(pool.stats().allocated == 0);
+  
+  {
+    pool_array3 array_3((trectlayout<3>(index3)), pool_allocator(pool));
+    REQUIRE(array_3.begin().data() == first);
+    
+    pool_array3 array_4((trectlayout<3>(index3)), pool_allocator(pool));
+    REQUIRE(array_4.begin().data() != first);
+    REQUIRE(pool.stats().high_water == 2 * 24 * sizeof(double));
+  }
+  REQUIRE(pool.stats().fallbacks == 0);
+  
+  index3[2] = 100;
+  {
+    pool_array3 array_3((trectlayout<3>(index3)), pool_allocator(pool));
+    REQUIRE(pool.stats().fallbacks == 1);
+    REQUIRE(reinterpret_cast<uintptr_t>(array_3.begin().data()) % 64 == 0);
+  }
+  REQUIRE(pool.stats().allocated == 0);
+}
@@ -103,3 +103,40 @@ TEST_CASE("Iterators for weak arrays and arrays work the same way", "[array]") {
     }
 }
 
+
+TEST_CASE("Arrays move and clone their data", "[array]") {
+    d_array array_(10);
+    double* data = array_.begin().data();
+    
+    for(size_t i = 0; i < array_.dim(); ++i) {
+        array_[i] = i;
+    }
+    
+    d_array moved(std::move(array_));
+    REQUIRE(moved.begin().data() == data);
+    REQUIRE(moved.dim() == 10);
+    REQUIRE(array_.dim() == 0);
+    
+    d_array copy(moved.clone());
+    REQUIRE(copy.begin().data() != data);
+    REQUIRE(copy.dim() == 10);
+    REQUIRE(copy[9] == 9);
+    
+    d_array other(3);
+    other = std::move(copy);
+    REQUIRE(other.dim() == 10);
+    REQUIRE(copy.dim() == 0);
+    
+    swap(other, moved);
+    REQUIRE(other.begin().data() == data);
+    
+    vector<d_array> arrays;
+    for(size_t n = 1; n < 20; ++n) {
+        arrays.push_back(d_array(n));
+        arrays.back()[n - 1] = n;
+    }
+    for(size_t n = 1; n < 20; ++n) {
+        REQUIRE(arrays[n - 1].dim() == n);
+        REQUIRE(arrays[n - 1][n - 1] == n);
+    }
+}
@@ -0,0 +1,289 @@
+/*
+ *    executiontest.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <execution.h>
+#include <atomic>
+#include <cmath>
+#include <catch/catch.hpp>
+#include "fixtures.h"
+
+using namespace marray;
+using namespace std;
+using fixtures::make_array3;
+
+typedef tmultiarray<double, 3> dm_array3;
+typedef tmultiarray<double, 2> dm_array2;
+
+namespace {
+  template<typename X, typename Y>
+  bool
+  same(const X& x, const Y& y) {
+    return data_size(x) == data_size(y) && std::equal(x.begin().data(), x.end().data(), y.begin().data());
+  }
+}
+
+TEST_CASE("A thread pool runs every task once, and nested runs in the calling thread", "[execution]") {
+  tthreadpool pool(4);
+  vector<atomic<int> > visits(1000);
+
+  REQUIRE(pool.threads() == 4);
+  for(size_t round = 0; round < 3; ++round) {
+    for(size_t i = 0; i < visits.size(); ++i) {
+      visits[i] = 0;
+    }
+    pool.run(visits.size(), [&](size_t task) {
+      ++visits[task];
+    });
+    for(size_t i = 0; i < visits.size(); ++i) {
+      REQUIRE(visits[i] == 1);
+    }
+  }
+
+  atomic<int> inner(0);
+  pool.run(8, [&](size_t) {
+    pool.run(5, [&](size_t) { ++inner; });
+  });
+  REQUIRE(inner == 40);
+
+  tthreadpool serial(1);
+  int count(0);
+  serial.run(10, [&](size_t) { ++count; });
+  REQUIRE(serial.threads() == 1);
+  REQUIRE(count == 10);
+}
+
+TEST_CASE("Parallel elementwise operations, fills and copies agree with the serial ones", "[execution]") {
+  tthreadpool pool(3);
+  tparallel policy(pool);
+  const size_t n = 3 * page_elements<double>() + 17;
+  array<size_t, 2> dims = {{n / 7 + 1, 7}};
+  tmultiarray<double, 2> a((trectlayout<2>(dims))), b((trectlayout<2>(dims))), c((trectlayout<2>(dims)));
+  tmultiarray<double, 2> serial((trectlayout<2>(dims))), parallel((trectlayout<2>(dims)));
+
+  for(size_t i = 0; i < dims[0]; ++i) {
+    for(size_t j = 0; j < dims[1]; ++j) {
+      a(i, j) = double(i) - 3.0 * j;
+      b(i, j) = 0.5 * (i + j);
+      c(i, j) = double(j) - 1.0;
+    }}
+
+  elementwise_add(serial, a, b);
+  elementwise_add(policy, parallel, a, b);
+  REQUIRE(same(serial, parallel));
+  elementwise_mul(serial, a, b);
+  elementwise_mul(policy, parallel, a, b);
+  REQUIRE(same(serial, parallel));
+  elementwise_fma(serial, a, b, c);
+  elementwise_fma(policy, parallel, a, b, c);
+  REQUIRE(same(serial, parallel));
+  elementwise_min(serial, a, b);
+  elementwise_min(policy, parallel, a, b);
+  REQUIRE(same(serial, parallel));
+  elementwise_max(serial, a, b);
+  elementwise_max(policy, parallel, a, b);
+  REQUIRE(same(serial, parallel));
+  elementwise_abs(serial, a);
+  elementwise_abs(policy, parallel, a);
+  REQUIRE(same(serial, parallel));
+  elementwise_select_less(serial, a, b, c, a);
+  elementwise_select_less(policy, parallel, a, b, c, a);
+  REQUIRE(same(serial, parallel));
+  elementwise_fill(policy, parallel, 2.5);
+  for(size_t i = 0; i < dims[0]; ++i) {
+    for(size_t j = 0; j < dims[1]; ++j) {
+      REQUIRE(parallel(i, j) == 2.5);
+    }}
+
+  dm_array3 from(make_array3(2, 45, 31));
+  array<size_t, 3> transposed_dims = {{31, 45, 2}}, order = {{2, 1, 0}};
+  dm_array3 to((trectlayout<3>(transposed_dims)));
+  auto view = to.permute(order);
+
+  REQUIRE(split_axis(shape(from), 3) == 1);
+  blocked_copy(policy, from, view);
+  for(size_t i = 0; i < 2; ++i) {
+    for(size_t j = 0; j < 45; ++j) {
+      for(size_t k = 0; k < 31; ++k) {
+        REQUIRE(to(k, j, i) == from(i, j, k));
+      }}}
+}
+
+TEST_CASE("Parallel reductions agree with the serial ones along kept and reduced axes", "[execution]") {
+  tthreadpool pool(4);
+  tparallel policy(pool);
+  dm_array3 array_3(make_array3(9, 3, 50));
+  dm_array3 low_outer(make_array3(2, 13, 40));
+  array<size_t, 2> outer = {{0, 1}}, ends = {{0, 2}};
+
+  for(size_t axis = 0; axis < 3; ++axis) {
+    REQUIRE(same(sum(policy, array_3, axis), sum(array_3, axis)));
+    REQUIRE(same(sum(policy, low_outer, axis, SUM_KAHAN), sum(low_outer, axis, SUM_KAHAN)));
+    REQUIRE(same(min(policy, array_3, axis), min(array_3, axis)));
+    REQUIRE(same(max(policy, low_outer, axis), max(low_outer, axis)));
+    REQUIRE(same(mean(policy, array_3, axis), mean(array_3, axis)));
+  }
+  REQUIRE(same(sum(policy, array_3, outer), sum(array_3, outer)));
+  REQUIRE(same(sum(policy, low_outer, ends), sum(low_outer, ends)));
+  REQUIRE(same(max(policy, array_3, ends), max(array_3, ends)));
+
+  array<size_t, 3> order = {{2, 0, 1}};
+  auto permuted = array_3.permute(order);
+  REQUIRE(same(sum(policy, permuted, 1), sum(permuted, 1)));
+  REQUIRE(same(min(policy, permuted, 0), min(permuted, 0)));
+
+  array<size_t, 2> dims = {{4, 1000}};
+  tmultiarray<int32_t, 2> big((trectlayout<2>(dims)));
+  for(size_t i = 0; i < 4; ++i) {
+    for(size_t j = 0; j < 1000; ++j) {
+      big(i, j) = 2000000000 - int32_t(i);
+    }}
+  tmultiarray<double, 1> runs(mean(policy, big, 1)), rows(mean(policy, big, 0));
+  REQUIRE(runs[3] == 2e9 - 3.0);
+  REQUIRE(rows[999] == 2e9 - 1.5);
+}
+
+TEST_CASE("Deterministic parallel sums are the same on any number of threads", "[execution]") {
+  const size_t n = 100003;
+  array<size_t, 2> dims = {{n, 3}};
+  tmultiarray<float, 2> values((trectlayout<2>(dims)));
+
+  for(size_t i = 0; i < n; ++i) {
+    values(i, 0) = 0.1f;
+    values(i, 1) = (i % 3) ? 1e4f : 1e-3f;
+    values(i, 2) = float(i % 17) * 0.37f;
+  }
+
+  tthreadpool one(1), two(2), four(4);
+  tmultiarray<float, 1> expected(sum(tparallel(one, true), values, 0));
+
+  REQUIRE(same(sum(tparallel(two, true), values, 0), expected));
+  REQUIRE(same(sum(tparallel(four, true), values, 0), expected));
+  REQUIRE(same(sum(tparallel(four, true), values, 0, SUM_NAIVE), sum(tparallel(one, true), values, 0, SUM_NAIVE)));
+  REQUIRE(expected[0] == Approx(0.1 * n).epsilon(1e-5));
+
+  array<size_t, 2> tall = {{64 * 100, 2}};
+  tmultiarray<float, 2> spread((trectlayout<2>(tall)));
+  for(size_t i = 0; i < tall[0]; ++i) {
+    spread(i, 0) = spread(i, 1) = i == 0 ? 1e8f : 0.01f;
+  }
+  tmultiarray<float, 1> compensated(sum(tparallel(two, true), spread, 0, SUM_KAHAN));
+  tmultiarray<float, 1> serial(sum(spread, 0, SUM_KAHAN));
+  REQUIRE(fabs(double(compensated[0]) - (1e8 + 0.01 * (tall[0] - 1))) <= 8.0);
+  REQUIRE(compensated[1] == serial[1]);
+}
+
+TEST_CASE("parallel_for covers an index space once, in boxes that keep the innermost axis whole", "[execution]") {
+  tthreadpool pool(4);
+  tparallel policy(pool);
+  array<size_t, 3> dims = {{7, 33, 10}};
+  trectlayout<3> layout(dims);
+  vector<atomic<int> > visits(layout.footprint());
+  atomic<int> split_inner(0), oversized(0);
+
+  for(size_t i = 0; i < visits.size(); ++i) {
+    visits[i] = 0;
+  }
+  parallel_for(policy, layout, [&](const tindexbox<3>& box) {
+    if(box.size() > 20) {
+      ++oversized;
+    }
+    if(box.lower[2] != 0 || box.upper[2] != dims[2]) {
+      ++split_inner;
+    }
+    for(size_t i = box.lower[0]; i < box.upper[0]; ++i) {
+      for(size_t j = box.lower[1]; j < box.upper[1]; ++j) {
+        for(size_t k = box.lower[2]; k < box.upper[2]; ++k) {
+          ++visits[layout.get_stride(i, j, k)];
+        }}}
+  }, 20);
+  for(size_t i = 0; i < visits.size(); ++i) {
+    REQUIRE(visits[i] == 1);
+  }
+  REQUIRE(split_inner == 0);
+  REQUIRE(oversized == 0);
+
+  array<size_t, 1> line_dims = {{1000}};
+  vector<atomic<int> > line(1000);
+  for(size_t i = 0; i < line.size(); ++i) {
+    line[i] = 0;
+  }
+  parallel_for(policy, trectlayout<1>(line_dims), [&](const tindexbox<1>& box) {
+    for(size_t i = box.lower[0]; i < box.upper[0]; ++i) {
+      ++line[i];
+    }
+  }, 16);
+  for(size_t i = 0; i < line.size(); ++i) {
+    REQUIRE(line[i] == 1);
+  }
+
+  array<size_t, 2> empty_dims = {{0, 5}};
+  int calls(0);
+  parallel_for(trectlayout<2>(empty_dims), [&](const tindexbox<2>&) { ++calls; });
+  REQUIRE(calls == 0);
+}
+
+TEST_CASE("parallel_for hands each task a sub-box view of the array", "[execution]") {
+  tthreadpool pool(3);
+  dm_array3 array_3(make_array3(12, 5, 40)), expected(make_array3(12, 5, 40));
+  array<size_t, 3> order = {{2, 0, 1}};
+  auto permuted = array_3.permute(order);
+  atomic<int> boxes(0), uncut(0), misplaced(0);
+
+  parallel_for(tparallel(pool), permuted, [&](tmultiarray<double, 3, double*, size_t, ptrdiff_t, true, tboxlayout<3> >& view, const tindexbox<3>& box) {
+    ++boxes;
+    if(view.dim(0) == 40) {
+      ++uncut;
+    }
+    for(size_t j = 0; j < 3; ++j) {
+      if(view.dim(j) != box.upper[j] - box.lower[j]) {
+        ++misplaced;
+      }
+    }
+    if(&view(0, 0, 0) != &permuted(box.lower)) {
+      ++misplaced;
+    }
+    for(size_t i = 0; i < view.dim(0); ++i) {
+      for(size_t j = 0; j < view.dim(1); ++j) {
+        for(size_t k = 0; k < view.dim(2); ++k) {
+          view(i, j, k) += view(i, j, k) < 0.0 ? 0.0 : 100.0;
+        }}}
+  }, 64);
+  REQUIRE(boxes > 1);
+  REQUIRE(uncut == boxes);
+  REQUIRE(misplaced == 0);
+
+  const dm_array3& fixed(array_3);
+  atomic<int> positive(0);
+
+  parallel_for(tparallel(pool), fixed, [&](tmultiarray<const double, 3, const double*, size_t, ptrdiff_t, true, tboxlayout<3> >& view, const tindexbox<3>&) {
+    for(size_t i = 0; i < view.dim(0); ++i) {
+      for(size_t j = 0; j < view.dim(1); ++j) {
+        for(size_t k = 0; k < view.dim(2); ++k) {
+          positive += view(i, j, k) >= 100.0 ? 1 : 0;
+        }}}
+  });
+  for(size_t i = 0; i < 12; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      for(size_t k = 0; k < 40; ++k) {
+        REQUIRE(array_3(i, j, k) == expected(i, j, k) + (expected(i, j, k) < 0.0 ? 0.0 : 100.0));
+        positive -= expected(i, j, k) < 0.0 ? 0 : 1;
+      }}}
+  REQUIRE(positive == 0);
+}
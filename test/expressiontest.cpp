@@ -0,0 +1,175 @@
+/*
+ *    expressiontest.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <expression.h>
+#include <type_traits>
+#include <cmath>
+#include <limits>
+#include <catch/catch.hpp>
+
+using namespace marray;
+using namespace std;
+
+typedef tmultiarray<double, 2> dm_array2;
+typedef tarray<double> dm_array;
+
+namespace {
+  dm_array2
+  make_array2(size_t rows, size_t columns, double scale) {
+    array<size_t, 2> index2 = {{rows, columns}};
+    dm_array2 result((trectlayout<2>(index2)));
+    
+    for(size_t i = 0; i < rows; ++i) {
+      for(size_t j = 0; j < columns; ++j) {
+        result(i, j) = scale * (10.0 * i + j);
+      }}
+    return result;
+  }
+}
+
+TEST_CASE("Elementwise expressions are lazy and evaluate in one pass","[expression]") {
+  dm_array2 a(make_array2(3, 4, 1.0));
+  dm_array2 b(make_array2(3, 4, 2.0));
+  dm_array2 c(make_array2(3, 4, 0.0));
+  
+  auto expr = a * 2.0 + b;
+  REQUIRE(is_base_of<texpr<decltype(expr)>, decltype(expr)>::value);
+  REQUIRE(int(decltype(expr)::RANK) == 2);
+  REQUIRE(expr.dim(0) == 3);
+  REQUIRE(expr.dim(1) == 4);
+  REQUIRE(expr.flat());
+  REQUIRE(c(2, 3) == 0.0);
+  
+  c = a * 2.0 + b;
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 4; ++j) {
+      REQUIRE(c(i, j) == 4.0 * (10.0 * i + j));
+    }}
+  
+  c = -(a - b) / 2.0 + 1.0;
+  REQUIRE(c(1, 2) == 12.0 / 2.0 + 1.0);
+  
+  c = c * c;
+  REQUIRE(c(1, 2) == 49.0);
+  
+  dm_array2 d(evaluate(3.0 * a - b));
+  REQUIRE(d.dim(0) == 3);
+  REQUIRE(d(2, 1) == 21.0);
+}
+
+TEST_CASE("Expressions read and write strided views","[expression]") {
+  dm_array2 a(make_array2(4, 6, 1.0));
+  dm_array2 b(make_array2(6, 4, 1.0));
+  dm_array2 c(make_array2(4, 6, 0.0));
+  
+  c = a + b.transpose();
+  REQUIRE(!(a + b.transpose()).flat());
+  for(size_t i = 0; i < 4; ++i) {
+    for(size_t j = 0; j < 6; ++j) {
+      REQUIRE(c(i, j) == a(i, j) + b(j, i));
+    }}
+  
+  c(range(0, 4, 2), all) = a(range(1, 4, 2), all) * 10.0;
+  REQUIRE(c(0, 5) == 150.0);
+  REQUIRE(c(2, 0) == 300.0);
+  REQUIRE(c(1, 0) == a(1, 0) + b(0, 1));
+  
+  dm_array row(6);
+  for(size_t j = 0; j < 6; ++j) {
+    row[j] = 100.0 * j;
+  }
+  c = a + broadcast(row, shape(a));
+  REQUIRE(c(3, 4) == 34.0 + 400.0);
+  
+  c[1] = a[2] - row;
+  REQUIRE(c(1, 5) == 25.0 - 500.0);
+  REQUIRE(c(0, 5) == 5.0 + 500.0);
+}
+
+TEST_CASE("Expressions over one dimensional arrays","[expression]") {
+  dm_array x(5), y(5), z(5);
+  for(size_t i = 0; i < 5; ++i) {
+    x[i] = i;
+    y[i] = 2.0 * i;
+  }
+  
+  z = 0.5 * x + y - 1.0;
+  for(size_t i = 0; i < 5; ++i) {
+    REQUIRE(z[i] == 2.5 * i - 1.0);
+  }
+  
+  tarray<double, double*, true> view(z.begin(), 3);
+  tarray<double, double*, true> head(x.begin(), 3);
+  view = head * head;
+  REQUIRE(z[2] == 4.0);
+  REQUIRE(z[3] == 2.5 * 3 - 1.0);
+  
+  tmultiarray<double, 1> w(evaluate(x + y));
+  REQUIRE(w.dim(0) == 5);
+  REQUIRE(w[4] == 12.0);
+}
+
+TEST_CASE("Expressions over temporary views may be kept","[expression]") {
+  dm_array2 a(make_array2(4, 6, 1.0));
+  
+  auto kept = a(range(1, 3), all) + a(range(0, 4, 2), all) * 2.0;
+  dm_array2 padding(make_array2(8, 8, 3.0));
+  REQUIRE(padding(7, 7) == 231.0);
+  
+  dm_array2 sum(evaluate(kept));
+  REQUIRE(sum.dim(0) == 2);
+  REQUIRE(sum.dim(1) == 6);
+  for(size_t i = 0; i < 2; ++i) {
+    for(size_t j = 0; j < 6; ++j) {
+      REQUIRE(sum(i, j) == a(i + 1, j) + 2.0 * a(2 * i, j));
+    }}
+}
+
+TEST_CASE("Minimum, maximum and multiply add of arrays","[expression]") {
+  dm_array2 a(make_array2(5, 7, 1.0));
+  dm_array2 b(make_array2(5, 7, -1.0));
+  dm_array2 c(make_array2(5, 7, 0.5));
+  dm_array2 d(make_array2(5, 7, 0.0));
+  b(2, 3) = 100.0;
+  a(4, 6) = std::numeric_limits<double>::quiet_NaN();
+  
+  d = minimum(a, b);
+  for(size_t i = 0; i < 5; ++i) {
+    for(size_t j = 0; j + (i == 4 ? 1 : 0) < 7; ++j) {
+      REQUIRE(d(i, j) == (i == 2 && j == 3 ? 23.0 : -(10.0 * i + j)));
+    }}
+  REQUIRE(d(4, 6) == b(4, 6));
+  
+  d = maximum(b, a);
+  REQUIRE(d(2, 3) == 100.0);
+  REQUIRE(d(1, 1) == 11.0);
+  REQUIRE(std::isnan(d(4, 6)));
+  
+  d = maximum(a.transpose().transpose(), 20.0);
+  REQUIRE(d(0, 0) == 20.0);
+  REQUIRE(d(3, 1) == 31.0);
+  
+  a(4, 6) = 46.0;
+  d = a * b + c;
+  for(size_t i = 0; i < 5; ++i) {
+    for(size_t j = 0; j < 7; ++j) {
+      REQUIRE(d(i, j) == a(i, j) * b(i, j) + c(i, j));
+    }}
+}
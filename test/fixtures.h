@@ -0,0 +1,43 @@
+/*
+ *    fixtures.h
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#pragma once
+#include <array>
+#include <cstddef>
+#include <multiarray.h>
+
+namespace fixtures {
+
+  /*
+  Dense array of the given shape whose elements are small whole numbers of both signs, in a
+  pattern that repeats along no axis, so that reductions along every axis differ.
+  */
+  inline marray::tmultiarray<double, 3>
+  make_array3(size_t n0, size_t n1, size_t n2) {
+    std::array<size_t, 3> dims = {{n0, n1, n2}};
+    marray::tmultiarray<double, 3> result((marray::trectlayout<3>(dims)));
+
+    for(size_t i = 0; i < n0; ++i) {
+      for(size_t j = 0; j < n1; ++j) {
+        for(size_t k = 0; k < n2; ++k) {
+          result(i, j, k) = double((i * 37 + j * 11 + k * 5) % 29) - 14.0;
+        }}}
+    return result;
+  }
+}
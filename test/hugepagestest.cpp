@@ -0,0 +1,75 @@
+/*
+ *    hugepagestest.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <hugepages.h>
+#include <multiarray.h>
+#include <cstdint>
+#include <catch/catch.hpp>
+
+using namespace marray;
+using namespace std;
+
+typedef tresource_allocator<double, thugepages> huge_allocator;
+typedef tmultiarray<double, 2, double*, size_t, ptrdiff_t, false, trectlayout<2>, huge_allocator> huge_array2;
+
+TEST_CASE("Large arrays are mapped on huge page boundaries","[hugepages]") {
+  thugepages pages;
+  array<size_t, 2> index2;
+  index2[0] = 1024; index2[1] = 1000;
+  
+  {
+    huge_array2 array_2((trectlayout<2>(index2)), huge_allocator(pages));
+    REQUIRE(reinterpret_cast<uintptr_t>(array_2.begin().data()) % thugepages::HUGE_PAGE_BYTES == 0);
+    REQUIRE(pages.stats().transparent + pages.stats().fallbacks == 1);
+    REQUIRE(pages.stats().hugetlb == 0);
+    REQUIRE(pages.stats().allocated == 1024 * 1000 * sizeof(double));
+    
+    for(size_t i = 0; i < 1024; ++i) {
+      for(size_t j = 0; j < 1000; ++j) {
+        array_2(i, j) = i + j;
+      }}
+    REQUIRE(array_2(1023, 999) == 2022.0);
+  }
+  REQUIRE(pages.stats().allocated == 0);
+  
+  index2[0] = 4; index2[1] = 4;
+  {
+    huge_array2 array_2((trectlayout<2>(index2)), huge_allocator(pages));
+    REQUIRE(reinterpret_cast<uintptr_t>(array_2.begin().data()) % 64 == 0);
+    REQUIRE(pages.stats().transparent + pages.stats().fallbacks == 2);
+  }
+  REQUIRE(pages.stats().allocated == 0);
+}
+
+TEST_CASE("Explicit huge pages fall back when none are reserved","[hugepages]") {
+  thugepages pages(thugepages::EXPLICIT);
+  array<size_t, 2> index2;
+  index2[0] = 512; index2[1] = 1024;
+  
+  huge_array2 first((trectlayout<2>(index2)), huge_allocator(pages));
+  huge_array2 second((trectlayout<2>(index2)), huge_allocator(pages));
+  
+  REQUIRE(pages.stats().hugetlb + pages.stats().transparent + pages.stats().fallbacks == 2);
+  REQUIRE(reinterpret_cast<uintptr_t>(first.begin().data()) % thugepages::HUGE_PAGE_BYTES == 0);
+  first(511, 1023) = 1.0;
+  second(511, 1023) = 2.0;
+  REQUIRE(first(511, 1023) == 1.0);
+  REQUIRE(second(511, 1023) == 2.0);
+}
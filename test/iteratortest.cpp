@@ -18,6 +18,8 @@
  *      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 #include <array.h>
+#include <algorithm>
+#include <numeric>
 #include <vector>
 #include <catch/catch.hpp>
 
@@ -64,3 +66,57 @@ TEST_CASE("Can initialise const iterator with an iterator", "[marray]") {
     REQUIRE(10 == *(--cptr));
 }
 
+
+TEST_CASE("Stride iterators step a runtime stride at random", "[marray]") {
+    typedef tstrideiterator<double> s_iterator;
+    typedef tstrideiterator<const double, const double*> cs_iterator;
+    vector<double> data(12);
+    for(size_t i = 0; i < 12; ++i) {
+        data[i] = i;
+    }
+    
+    s_iterator begin(&data[1], 4), end(begin + 3);
+    REQUIRE(3 == end - begin);
+    REQUIRE(3 == strides(begin, end));
+    REQUIRE(4 == stride(begin));
+    REQUIRE(&data[9] == (end - 1).data());
+    REQUIRE(5 == begin[1]);
+    REQUIRE(9 == *(2 + begin));
+    REQUIRE(begin < end);
+    REQUIRE(end >= begin);
+    REQUIRE(!(end <= begin));
+    
+    s_iterator ptr(begin);
+    REQUIRE(1 == *ptr++);
+    REQUIRE(5 == *ptr);
+    REQUIRE(9 == *++ptr);
+    REQUIRE(ptr != end);
+    REQUIRE(++ptr == end);
+    ptr -= 2;
+    REQUIRE(5 == *ptr--);
+    REQUIRE(ptr == begin);
+    
+    REQUIRE(15 == accumulate(begin, end, 0.0));
+    
+    vector<double> column(3);
+    copy(begin, end, column.begin());
+    REQUIRE(1 == column[0]);
+    REQUIRE(5 == column[1]);
+    REQUIRE(9 == column[2]);
+    
+    cs_iterator cbegin(begin), cend(end);
+    REQUIRE(15 == accumulate(cbegin, cend, 0.0));
+    
+    s_iterator rbegin(&data[11], -5), rend(rbegin + 3);
+    REQUIRE(3 == rend - rbegin);
+    REQUIRE(rbegin < rend);
+    REQUIRE(11 + 6 + 1 == accumulate(rbegin, rend, 0.0));
+    REQUIRE(rend.base() == &data[11]);
+    REQUIRE(rend.steps() == 3);
+    REQUIRE(s_iterator(&data[6], -5) == rbegin + 1);
+    REQUIRE(s_iterator(&data[5], 4) - begin == 1);
+    
+    fill(begin, end, -1.0);
+    REQUIRE(-1 == data[5]);
+    REQUIRE(6 == data[6]);
+}
@@ -0,0 +1,89 @@
+/*
+ *    mortonlayouttest.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <mortonlayout.h>
+#include <catch/catch.hpp>
+
+using namespace marray;
+using namespace std;
+
+typedef tmortonlayout<2> morton_layout2;
+typedef tmortonlayout<3> morton_layout3;
+
+TEST_CASE("Morton layouts interleave the coordinate bits","[morton]") {
+  array<size_t, 2> index2;
+  index2[0] = 4; index2[1] = 4;
+  
+  morton_layout2 layout2(index2);
+  
+  REQUIRE(layout2.footprint() == 16);
+  REQUIRE(layout2.get_stride(0, 0) == 0);
+  REQUIRE(layout2.get_stride(0, 1) == 1);
+  REQUIRE(layout2.get_stride(1, 0) == 2);
+  REQUIRE(layout2.get_stride(1, 1) == 3);
+  REQUIRE(layout2.get_stride(0, 2) == 4);
+  REQUIRE(layout2.get_stride(2, 0) == 8);
+  REQUIRE(layout2.get_stride(3, 3) == 15);
+  
+  array<size_t, 3> index3;
+  index3[0] = 3; index3[1] = 5; index3[2] = 300;
+  
+  morton_layout3 layout3(index3);
+  
+  REQUIRE(layout3.get_stride(0, 0, 1) == 1);
+  REQUIRE(layout3.get_stride(0, 1, 0) == 2);
+  REQUIRE(layout3.get_stride(1, 0, 0) == 4);
+  REQUIRE(layout3.get_stride(0, 0, 256) == (size_t(1) << 24));
+  REQUIRE(layout3.get_stride(2, 4, 299) == layout3.footprint() - 1);
+}
+
+TEST_CASE("Morton multiarrays index and slice by logical axes","[morton]") {
+  array<size_t, 3> index3;
+  index3[0] = 3; index3[1] = 5; index3[2] = 6;
+  
+  tmultiarray<double, 3, double*, size_t, ptrdiff_t, false, morton_layout3> array_3((morton_layout3(index3)));
+  
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      for(size_t k = 0; k < 6; ++k) {
+        array_3(i, j, k) = 100.0 * i + 10.0 * j + k;
+      }}}
+  
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      for(size_t k = 0; k < 6; ++k) {
+        REQUIRE(array_3[i][j][k] == 100.0 * i + 10.0 * j + k);
+      }}}
+  
+  array<size_t, 2> index2;
+  index2[0] = 5; index2[1] = 6;
+  
+  tmultiarray<double, 2, double*, size_t, ptrdiff_t, false, morton_layout2> array_2((morton_layout2(index2)));
+  
+  for(size_t i = 0; i < 5; ++i) {
+    for(size_t j = 0; j < 6; ++j) {
+      array_2[i][j] = 10.0 * i + j;
+    }}
+  
+  for(size_t i = 0; i < 5; ++i) {
+    for(size_t j = 0; j < 6; ++j) {
+      REQUIRE(array_2(i, j) == 10.0 * i + j);
+    }}
+}
@@ -19,7 +19,12 @@
  */
 
 #include <multiarray.h>
+#include <algorithm>
+#include <numeric>
 #include <cmath>
+#include <type_traits>
+#include <thread>
+#include <vector>
 #include <iostream>
 #include <catch/catch.hpp>
 
@@ -116,10 +121,10 @@ TEST_CASE("Indexing in the natural direction is consistent","[marray]") {
 
   REQUIRE(0 == array_3[0][0][0]);
   REQUIRE(1 == array_3[0][0][1]);
-  REQUIRE(2 == array_3[0][1][0]);
-  REQUIRE(3 == array_3[0][1][1]);
-  REQUIRE(6 == array_3[1][0][1]);
-  REQUIRE(21 == array_3[3][1][1]);
+  REQUIRE(4 == array_3[0][1][0]);
+  REQUIRE(5 == array_3[0][1][1]);
+  REQUIRE(13 == array_3[1][0][1]);
+  REQUIRE(23 == array_3[1][2][3]);
 }
 
 TEST_CASE("Multidimensional iterators iterate along most coherent axis","[marray]") {
@@ -153,3 +158,846 @@ TEST_CASE("Multidimensional iterators iterate along most coherent axis","[marray
     ++index3[0]; index3[1] = 0; index3[2] = 0;
   }
 }
+
+TEST_CASE("Coordinate and index access refer to the same data","[marray]") {
+  array<size_t, 3> index3;
+  array<size_t, 2> index2;
+  index3[0] = 2; index3[1] = 3; index3[2] = 4; 
+  index2[0] = 2; index2[1] = 3;
+  
+  trectlayout<3> layout3(index3);
+  trectlayout<2> layout2(index2);
+  
+  REQUIRE(layout2.get_stride(index2 = {{1, 2}}) == 5);
+  REQUIRE(layout2.get_stride(1, 2) == 5);
+  REQUIRE(layout3.get_stride(index3 = {{1, 2, 3}}) == 23);
+  REQUIRE(layout3.get_stride(1, 2, 3) == 23);
+  
+  dm_array3 array_3(layout3);
+  double data = 0.0;
+  for(dm_array3::iterator ptr = array_3.begin(); ptr != array_3.end(); ++ptr) {
+    *ptr = data++;
+  }
+  
+  data = 0.0;
+  for(size_t i = 0; i < 2; ++i) {
+    for(size_t j = 0; j < 3; ++j) {
+      for(size_t k = 0; k < 4; ++k) {
+        index3[0] = i; index3[1] = j; index3[2] = k;
+        REQUIRE(array_3(i, j, k) == data++);
+        REQUIRE(array_3(i, j, k) == array_3(index3));
+      }}}
+}
+
+TEST_CASE("Static extents fix the shape of a layout at compile time","[marray]") {
+  typedef tstaticlayout<textents<3, 4> > fixed_layout2;
+  typedef tstaticlayout<textents<dynamic_extent, 3, 4> > mixed_layout3;
+  
+  REQUIRE(std::is_empty<fixed_layout2>::value);
+  
+  fixed_layout2 layout2;
+  REQUIRE(layout2.dim(0) == 3);
+  REQUIRE(layout2.dim(1) == 4);
+  REQUIRE(layout2.footprint() == 12);
+  REQUIRE(layout2.get_stride(2, 3) == 11);
+  
+  array<size_t, 3> index3;
+  index3[0] = 2; index3[1] = 3; index3[2] = 4; 
+  mixed_layout3 layout3(index3);
+  trectlayout<3> rlayout3(index3);
+  
+  REQUIRE(layout3.dim(0) == 2);
+  REQUIRE(layout3.footprint() == rlayout3.footprint());
+  REQUIRE(layout3.slice(0).footprint() == 12);
+  
+  tmultiarray<double, 3, double*, size_t, ptrdiff_t, false, mixed_layout3> array_3(layout3);
+  double data = 0.0;
+  for(dm_array3::iterator ptr = array_3.begin(); ptr != array_3.end(); ++ptr) {
+    *ptr = data++;
+  }
+  
+  for(size_t i = 0; i < 2; ++i) {
+    for(size_t j = 0; j < 3; ++j) {
+      for(size_t k = 0; k < 4; ++k) {
+        index3[0] = i; index3[1] = j; index3[2] = k;
+        REQUIRE(layout3.get_stride(index3) == rlayout3.get_stride(index3));
+        REQUIRE(array_3(i, j, k) == array_3[i][j][k]);
+      }}}
+}
+
+TEST_CASE("Permuted layouts address foreign ordered data by logical axes","[marray]") {
+  typedef tpermutedlayout<2> permuted_layout2;
+  typedef tpermutedlayout<3> permuted_layout3;
+  
+  array<size_t, 2> index2;
+  index2[0] = 2; index2[1] = 3;
+  
+  permuted_layout2 layout2 = permuted_layout2::column_major(index2);
+  REQUIRE(layout2.dim(0) == 2);
+  REQUIRE(layout2.dim(1) == 3);
+  REQUIRE(layout2.footprint() == 6);
+  REQUIRE(layout2.get_stride(1, 0) == 1);
+  REQUIRE(layout2.get_stride(0, 1) == 2);
+  
+  tmultiarray<double, 2, double*, size_t, ptrdiff_t, false, permuted_layout2> array_2(layout2);
+  double data = 0.0;
+  for(dm_array2::iterator ptr = array_2.begin(); ptr != array_2.end(); ++ptr) {
+    *ptr = data++;
+  }
+  
+  for(size_t i = 0; i < 2; ++i) {
+    for(size_t j = 0; j < 3; ++j) {
+      REQUIRE(array_2(i, j) == i + 2 * j);
+      REQUIRE(array_2[i][j] == i + 2 * j);
+    }}
+  
+  array<size_t, 3> index3, order3;
+  index3[0] = 2; index3[1] = 3; index3[2] = 4; 
+  order3[0] = 1; order3[1] = 2; order3[2] = 0; 
+  
+  permuted_layout3 layout3(index3, order3);
+  REQUIRE(layout3.footprint() == 24);
+  REQUIRE(layout3.slice(0).footprint() == 23);
+  
+  tmultiarray<double, 3, double*, size_t, ptrdiff_t, false, permuted_layout3> array_3(layout3);
+  data = 0.0;
+  for(dm_array3::iterator ptr = array_3.begin(); ptr != array_3.end(); ++ptr) {
+    *ptr = data++;
+  }
+  
+  for(size_t i = 0; i < 2; ++i) {
+    for(size_t j = 0; j < 3; ++j) {
+      for(size_t k = 0; k < 4; ++k) {
+        REQUIRE(array_3(i, j, k) == j * 8 + k * 2 + i);
+        REQUIRE(array_3[i][j][k] == j * 8 + k * 2 + i);
+      }}}
+}
+
+TEST_CASE("Padded layouts start every row on an aligned boundary","[marray]") {
+  typedef tpaddedlayout<2> padded_layout2;
+  typedef tpaddedlayout<3> padded_layout3;
+  
+  array<size_t, 2> index2;
+  index2[0] = 3; index2[1] = 5;
+  
+  padded_layout2 layout2(index2, 8);
+  REQUIRE(layout2.dim(0) == 3);
+  REQUIRE(layout2.dim(1) == 5);
+  REQUIRE(layout2.row() == 8);
+  REQUIRE(layout2.footprint() == 24);
+  REQUIRE(layout2.get_stride(2, 4) == 20);
+  
+  tmultiarray<double, 2, double*, size_t, ptrdiff_t, false, padded_layout2> array_2(layout2);
+  REQUIRE(array_2.end() - array_2.begin() == 24);
+  
+  for(size_t i = 0; i < 3; ++i) {
+    REQUIRE(array_2[i].dim() == 5);
+    REQUIRE(array_2[i].begin() - array_2.begin() == 8 * i);
+    
+    for(size_t j = 0; j < 5; ++j) {
+      array_2[i][j] = 10.0 * i + j;
+    }}
+  
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      REQUIRE(array_2(i, j) == 10.0 * i + j);
+    }}
+  
+  array<size_t, 3> index3;
+  index3[0] = 2; index3[1] = 3; index3[2] = 4; 
+  
+  padded_layout3 layout3(index3, 8);
+  REQUIRE(layout3.footprint() == 48);
+  REQUIRE(layout3.slice(0).footprint() == 24);
+  
+  tmultiarray<double, 3, double*, size_t, ptrdiff_t, false, padded_layout3> array_3(layout3);
+  
+  for(size_t i = 0; i < 2; ++i) {
+    for(size_t j = 0; j < 3; ++j) {
+      REQUIRE(array_3[i][j].begin() - array_3.begin() == 24 * i + 8 * j);
+      
+      for(size_t k = 0; k < 4; ++k) {
+        REQUIRE(&array_3(i, j, k) == &array_3[i][j][k]);
+      }}}
+}
+
+/*
+Builds and fills an array, handing it back by value.
+*/
+dm_array3
+make_array3(double start) {
+  array<size_t, 3> index3;
+  index3[0] = 2; index3[1] = 3; index3[2] = 4; 
+  
+  dm_array3 result((trectlayout<3>(index3)));
+  for(dm_array3::iterator ptr = result.begin(); ptr != result.end(); ++ptr) {
+    *ptr = start++;
+  }
+  return result;
+}
+
+TEST_CASE("Owning arrays move their data without copying it","[marray]") {
+  static_assert(!is_copy_constructible<dm_array3>::value, "owning arrays copy through clone()");
+  static_assert(is_nothrow_move_constructible<dm_array3>::value, "vector growth must move arrays");
+  static_assert(is_nothrow_move_assignable<dm_array2>::value, "vector growth must move arrays");
+  
+  dm_array3 array_3(make_array3(0.0));
+  double* data = array_3.begin().data();
+  REQUIRE(array_3.dim(2) == 4);
+  REQUIRE(array_3(1, 2, 3) == 23.0);
+  
+  dm_array3 moved(std::move(array_3));
+  REQUIRE(moved.begin().data() == data);
+  REQUIRE(moved(1, 2, 3) == 23.0);
+  REQUIRE(array_3.begin().data() == nullptr);
+  REQUIRE(array_3.begin() == array_3.end());
+  
+  dm_array3 other(make_array3(100.0));
+  other = std::move(moved);
+  REQUIRE(other.begin().data() == data);
+  REQUIRE(moved.begin().data() == nullptr);
+  
+  dm_array3 swapped(make_array3(100.0));
+  swap(other, swapped);
+  REQUIRE(swapped.begin().data() == data);
+  REQUIRE(swapped(1, 2, 3) == 23.0);
+  REQUIRE(other(1, 2, 3) == 123.0);
+  
+  vector<dm_array3> arrays;
+  vector<double*> datas;
+  for(size_t n = 0; n < 20; ++n) {
+    arrays.push_back(make_array3(100.0 * n));
+    datas.push_back(arrays.back().begin().data());
+  }
+  for(size_t n = 0; n < 20; ++n) {
+    REQUIRE(arrays[n].begin().data() == datas[n]);
+    REQUIRE(arrays[n](1, 2, 3) == 100.0 * n + 23.0);
+  }
+}
+
+TEST_CASE("Cloning an owning array copies its data","[marray]") {
+  dm_array3 array_3(make_array3(0.0));
+  dm_array3 copy(array_3.clone());
+  
+  REQUIRE(copy.begin().data() != array_3.begin().data());
+  REQUIRE(copy.dim(0) == 2);
+  REQUIRE(copy.dim(1) == 3);
+  REQUIRE(copy.dim(2) == 4);
+  for(size_t i = 0; i < 24; ++i) {
+    REQUIRE(*(copy.begin() + i) == *(array_3.begin() + i));
+  }
+  copy(0, 0, 0) = -1.0;
+  REQUIRE(array_3(0, 0, 0) == 0.0);
+  
+  array<size_t, 2> index2;
+  index2[0] = 2; index2[1] = 3;
+  dm_array2 array_2((trectlayout<2>(index2)));
+  array_2(1, 2) = 5.0;
+  
+  dm_array2 copy2(array_2.clone());
+  REQUIRE(copy2.begin().data() != array_2.begin().data());
+  REQUIRE(copy2[1][2] == 5.0);
+  
+  tmultiarray<double, 2, double*, size_t, ptrdiff_t, true> view2(array_2);
+  dm_array2 copy3(view2);
+  REQUIRE(copy3.begin().data() != array_2.begin().data());
+  REQUIRE(copy3(1, 2) == 5.0);
+}
+
+TEST_CASE("Transposed and permuted views share the data of their array","[marray]") {
+  array<size_t, 2> index2;
+  index2[0] = 3; index2[1] = 5;
+  dm_array2 array_2((trectlayout<2>(index2)));
+  
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      array_2(i, j) = 10.0 * i + j;
+    }}
+  
+  tmultiarray<double, 2, double*, size_t, ptrdiff_t, true, trectlayoutref<2, 2> > transposed(array_2.transpose());
+  REQUIRE(transposed.begin().data() == array_2.begin().data());
+  REQUIRE(transposed.dim(0) == 5);
+  REQUIRE(transposed.dim(1) == 3);
+  REQUIRE(transposed.layout().footprint() == 15);
+  REQUIRE(transposed.layout().layout().dim(0) == 5);
+  REQUIRE(transposed.layout().layout().dim(1) == 3);
+  
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      REQUIRE(transposed(j, i) == array_2(i, j));
+      REQUIRE(transposed[j][i] == array_2(i, j));
+    }}
+  
+  transposed(4, 2) = -1.0;
+  REQUIRE(array_2(2, 4) == -1.0);
+  
+  array<size_t, 3> index3;
+  index3[0] = 2; index3[1] = 3; index3[2] = 4; 
+  dm_array3 array_3((trectlayout<3>(index3)));
+  
+  for(size_t i = 0; i < 2; ++i) {
+    for(size_t j = 0; j < 3; ++j) {
+      for(size_t k = 0; k < 4; ++k) {
+        array_3(i, j, k) = 100.0 * i + 10.0 * j + k;
+      }}}
+  
+  array<size_t, 3> order = {{2, 0, 1}};
+  tmultiarray<double, 3, double*, size_t, ptrdiff_t, true, trectlayoutref<3, 3> > permuted(array_3.permute(order));
+  REQUIRE(permuted.dim(0) == 4);
+  REQUIRE(permuted.dim(1) == 2);
+  REQUIRE(permuted.dim(2) == 3);
+  
+  array<size_t, 3> back = {{1, 2, 0}};
+  tmultiarray<double, 3, double*, size_t, ptrdiff_t, true, trectlayoutref<3, 3> > restored(permuted.permute(back));
+  
+  for(size_t i = 0; i < 2; ++i) {
+    for(size_t j = 0; j < 3; ++j) {
+      for(size_t k = 0; k < 4; ++k) {
+        REQUIRE(permuted(k, i, j) == array_3(i, j, k));
+        REQUIRE(permuted[k][i][j] == array_3(i, j, k));
+        REQUIRE(restored(i, j, k) == array_3(i, j, k));
+        REQUIRE(array_3.transpose()(k, j, i) == array_3(i, j, k));
+      }}}
+  
+  typedef tpermutedlayout<2> permuted_layout2;
+  tmultiarray<double, 2, double*, size_t, ptrdiff_t, false, permuted_layout2> 
+    column_major(permuted_layout2::column_major(index2));
+  column_major(2, 4) = 3.0;
+  REQUIRE(column_major.transpose()(4, 2) == 3.0);
+  REQUIRE(&column_major.transpose()(1, 0) == &column_major(0, 1));
+  
+  const dm_array3& fixed(array_3);
+  static_assert(is_same<decltype(fixed.permute(order)(0, 0, 0)), const double&>::value, "views of const arrays are read only");
+  static_assert(is_same<decltype(fixed.transpose()(0, 0, 0)), const double&>::value, "views of const arrays are read only");
+  REQUIRE(fixed.permute(order)(3, 1, 2) == array_3(1, 2, 3));
+  REQUIRE(&fixed.transpose()(3, 2, 1) == &array_3(1, 2, 3));
+  
+  array<size_t, 3> repeated = {{0, 2, 0}}, beyond = {{0, 1, 3}};
+  REQUIRE(is_axis_order(order));
+  REQUIRE(!is_axis_order(repeated));
+  REQUIRE(!is_axis_order(beyond));
+}
+
+TEST_CASE("Views materialize into dense row major arrays","[marray]") {
+  array<size_t, 3> index3;
+  index3[0] = 3; index3[1] = 40; index3[2] = 70; 
+  dm_array3 array_3((trectlayout<3>(index3)));
+  
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 40; ++j) {
+      for(size_t k = 0; k < 70; ++k) {
+        array_3(i, j, k) = 10000.0 * i + 100.0 * j + k;
+      }}}
+  
+  array<size_t, 3> order = {{2, 0, 1}};
+  dm_array3 dense(materialize(array_3.permute(order)));
+  
+  REQUIRE(dense.begin().data() != array_3.begin().data());
+  REQUIRE(dense.dim(0) == 70);
+  REQUIRE(dense.dim(1) == 3);
+  REQUIRE(dense.dim(2) == 40);
+  
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 40; ++j) {
+      for(size_t k = 0; k < 70; ++k) {
+        REQUIRE(dense(k, i, j) == array_3(i, j, k));
+        REQUIRE(*(dense.begin() + (k * 3 + i) * 40 + j) == array_3(i, j, k));
+      }}}
+  
+  array<size_t, 2> index2;
+  index2[0] = 33; index2[1] = 65;
+  dm_array2 array_2((trectlayout<2>(index2)));
+  for(size_t i = 0; i < 33; ++i) {
+    for(size_t j = 0; j < 65; ++j) {
+      array_2(i, j) = 100.0 * i + j;
+    }}
+  
+  dm_array2 dense2(materialize(array_2.transpose()));
+  for(size_t i = 0; i < 33; ++i) {
+    for(size_t j = 0; j < 65; ++j) {
+      REQUIRE(dense2(j, i) == array_2(i, j));
+    }}
+}
+
+TEST_CASE("Slices may fix any axis without copying","[marray]") {
+  array<size_t, 3> index3;
+  index3[0] = 2; index3[1] = 3; index3[2] = 4; 
+  dm_array3 array_3((trectlayout<3>(index3)));
+  
+  for(size_t i = 0; i < 2; ++i) {
+    for(size_t j = 0; j < 3; ++j) {
+      for(size_t k = 0; k < 4; ++k) {
+        array_3(i, j, k) = 100.0 * i + 10.0 * j + k;
+      }}}
+  
+  for(size_t k = 0; k < 4; ++k) {
+    dm_array3::axis_slice_type plane(array_3.slice(2, k));
+    REQUIRE(plane.dim(0) == 2);
+    REQUIRE(plane.dim(1) == 3);
+    
+    for(size_t i = 0; i < 2; ++i) {
+      for(size_t j = 0; j < 3; ++j) {
+        REQUIRE(&plane(i, j) == &array_3(i, j, k));
+        REQUIRE(plane[i][j] == array_3(i, j, k));
+      }}
+    
+    dm_array3::axis_slice_type::axis_slice_type column(plane.slice(1, 2));
+    REQUIRE(column.dim(0) == 2);
+    REQUIRE(&column[1] == &array_3(1, 2, k));
+  }
+  
+  for(size_t j = 0; j < 3; ++j) {
+    dm_array3::axis_slice_type plane(array_3.slice(1, j));
+    
+    for(size_t i = 0; i < 2; ++i) {
+      for(size_t k = 0; k < 4; ++k) {
+        REQUIRE(&plane(i, k) == &array_3(i, j, k));
+      }}
+  }
+  
+  array<size_t, 2> index2;
+  index2[0] = 3; index2[1] = 5;
+  dm_array2 array_2((trectlayout<2>(index2)));
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      array_2(i, j) = 10.0 * i + j;
+    }}
+  
+  dm_array2::axis_slice_type column(array_2.slice(1, 4));
+  dm_array2::axis_slice_type row(array_2.slice(0, 2));
+  REQUIRE(column.dim(0) == 3);
+  REQUIRE(row.dim(0) == 5);
+  for(size_t i = 0; i < 3; ++i) {
+    REQUIRE(column[i] == array_2(i, 4));
+  }
+  for(size_t j = 0; j < 5; ++j) {
+    REQUIRE(row[j] == array_2(2, j));
+  }
+  column[1] = -1.0;
+  REQUIRE(array_2(1, 4) == -1.0);
+  
+  const dm_array3& fixed(array_3);
+  dm_array3::const_axis_slice_type plane(fixed.slice(1, 2));
+  static_assert(is_same<decltype(plane(0, 0)), const double&>::value, "slices of const arrays are read only");
+  static_assert(is_same<decltype(plane.slice(0, 1)[3]), const double&>::value, "slices of const arrays are read only");
+  REQUIRE(&plane(1, 3) == &array_3(1, 2, 3));
+  REQUIRE(&plane.slice(0, 1)[3] == &array_3(1, 2, 3));
+}
+
+TEST_CASE("Slices taken at once do not alias one another","[marray]") {
+  array<size_t, 3> index3;
+  index3[0] = 4; index3[1] = 5; index3[2] = 6; 
+  dm_array3 array_3((trectlayout<3>(index3)));
+  
+  for(size_t i = 0; i < 4; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      for(size_t k = 0; k < 6; ++k) {
+        array_3(i, j, k) = 100.0 * i + 10.0 * j + k;
+      }}}
+  
+  const dm_array3& const_3(array_3);
+  REQUIRE(const_3[0][1][2] + const_3[1][2][3] == 12.0 + 123.0);
+  REQUIRE(array_3[3][4][5] - array_3[2][0][1] == 345.0 - 201.0);
+  
+  dm_array3::slice_type first(array_3[1]);
+  dm_array3::slice_type second(array_3[2]);
+  REQUIRE(first[0][0] == 100.0);
+  REQUIRE(second[0][0] == 200.0);
+  second[4][5] = -1.0;
+  REQUIRE(array_3(2, 4, 5) == -1.0);
+  REQUIRE(first[4][5] == 145.0);
+  array_3(2, 4, 5) = 245.0;
+  
+  const size_t threads = 4;
+  vector<double> sums(threads, 0.0);
+  vector<std::thread> readers;
+  for(size_t t = 0; t < threads; ++t) {
+    readers.push_back(std::thread([&const_3, &sums, t]() {
+      for(size_t repeat = 0; repeat < 100; ++repeat) {
+        for(size_t i = 0; i < 4; ++i) {
+          for(size_t j = 0; j < 5; ++j) {
+            for(size_t k = 0; k < 6; ++k) {
+              sums[t] += const_3[(i + t) % 4][j][k];
+            }}}
+      }
+    }));
+  }
+  for(size_t t = 0; t < threads; ++t) {
+    readers[t].join();
+  }
+  
+  double expected = 0.0;
+  for(dm_array3::iterator ptr = array_3.begin(); ptr != array_3.end(); ++ptr) {
+    expected += *ptr;
+  }
+  for(size_t t = 0; t < threads; ++t) {
+    REQUIRE(sums[t] == 100.0 * expected);
+  }
+  
+  array<size_t, 2> index2;
+  index2[0] = 3; index2[1] = 4;
+  dm_array2 array_2((trectlayout<2>(index2)));
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 4; ++j) {
+      array_2(i, j) = 10.0 * i + j;
+    }}
+  REQUIRE(array_2[0][1] + array_2[2][3] == 1.0 + 23.0);
+  
+  dm_array2::slice_type row0(array_2[0]);
+  dm_array2::slice_type row2(array_2[2]);
+  REQUIRE(row0[3] == 3.0);
+  REQUIRE(row2[3] == 23.0);
+  
+  const dm_array2& const_2(array_2);
+  dm_array2::const_slice_type const_row(const_2[2]);
+  static_assert(is_same<decltype(const_row[3]), const double&>::value, "rows of const arrays are read only");
+  static_assert(is_same<decltype(const_3[1][2][3]), const double&>::value, "slices of const arrays are read only");
+  REQUIRE(&const_row[3] == &array_2(2, 3));
+}
+
+TEST_CASE("Columns and diagonals iterate with a stride","[marray]") {
+  array<size_t, 2> index2;
+  index2[0] = 4; index2[1] = 6;
+  dm_array2 array_2((trectlayout<2>(index2)));
+  for(size_t i = 0; i < 4; ++i) {
+    for(size_t j = 0; j < 6; ++j) {
+      array_2(i, j) = 10.0 * i + j;
+    }}
+  
+  dm_array2::axis_slice_type column(array_2.slice(1, 3));
+  REQUIRE(column.stride_end() - column.stride_begin() == 4);
+  REQUIRE(accumulate(column.stride_begin(), column.stride_end(), 0.0) == 60.0 + 4 * 3.0);
+  
+  vector<double> copied(4);
+  copy(column.stride_begin(), column.stride_end(), copied.begin());
+  for(size_t i = 0; i < 4; ++i) {
+    REQUIRE(copied[i] == array_2(i, 3));
+  }
+  
+  REQUIRE(array_2.diagonal_end() - array_2.diagonal_begin() == 4);
+  REQUIRE(accumulate(array_2.diagonal_begin(), array_2.diagonal_end(), 0.0) == 0.0 + 11.0 + 22.0 + 33.0);
+  
+  dm_array2::axis_slice_type::stride_iterator ptr(array_2.transpose().slice(0, 2).stride_begin());
+  for(size_t i = 0; i < 4; ++i, ++ptr) {
+    REQUIRE(&*ptr == &array_2(i, 2));
+  }
+}
+
+TEST_CASE("Subspace iterators visit strided views in storage order","[marray]") {
+  array<size_t, 3> index3;
+  index3[0] = 3; index3[1] = 4; index3[2] = 5;
+  dm_array3 array_3((trectlayout<3>(index3)));
+  double x = 0.0;
+  for(dm_array3::iterator ptr = array_3.begin(); ptr != array_3.end(); ++ptr) {
+    *ptr = x++;
+  }
+  
+  tsubspaceiterator<double, double*, size_t, ptrdiff_t, 3> dense(subspace_begin(array_3));
+  REQUIRE(dense.rank() == 1);
+  REQUIRE(dense.run() == 60);
+  for(size_t i = 0; dense != subspace_end(array_3); ++dense, ++i) {
+    REQUIRE(&*dense == array_3.begin().data() + i);
+  }
+  
+  tmultiarray<double, 3, double*, size_t, ptrdiff_t, true, trectlayoutref<3, 3> > permuted(
+    array_3.transpose());
+  size_t count = 0;
+  x = 0.0;
+  for(
+    tsubspaceiterator<double, double*, size_t, ptrdiff_t, 3> ptr = subspace_begin(permuted); 
+    ptr != subspace_end(permuted); 
+    ++ptr, ++count, ++x
+  ) {
+    REQUIRE(*ptr == x);
+  }
+  REQUIRE(count == 60);
+  
+  dm_array3::axis_slice_type plane(array_3.slice(1, 2));
+  vector<double> visited;
+  subspace_for_each(subspace_begin(plane), subspace_end(plane), [&visited](double value) { 
+    visited.push_back(value); 
+  });
+  REQUIRE(visited.size() == 15);
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t k = 0; k < 5; ++k) {
+      REQUIRE(visited[i * 5 + k] == array_3(i, 2, k));
+    }}
+  
+  tsubspaceiterator<double, double*, size_t, ptrdiff_t, 2> ptr(subspace_begin(plane));
+  REQUIRE(ptr.rank() == 2);
+  REQUIRE(ptr.run() == 5);
+  ptr += 7;
+  REQUIRE(*ptr == array_3(1, 2, 2));
+  REQUIRE(ptr.run() == 3);
+  REQUIRE(ptr.position() == 7);
+  
+  array<size_t, 2> extents = {{2, 0}};
+  array<ptrdiff_t, 2> strides = {{5, 1}};
+  tsubspaceiterator<double, double*, size_t, ptrdiff_t, 2> empty(array_3.begin().data(), extents, strides);
+  REQUIRE(empty == empty.end());
+}
+
+TEST_CASE("Subspace iterators of views into a larger buffer stay within it","[marray]") {
+  array<size_t, 2> index2 = {{6, 7}};
+  dm_array2 array_2((trectlayout<2>(index2)));
+  double x = 0.0;
+  for(dm_array2::iterator ptr = array_2.begin(); ptr != array_2.end(); ++ptr) {
+    *ptr = x++;
+  }
+  const double* first = array_2.begin().data();
+  const double* last = array_2.end().data();
+  
+  dm_array2::box_type column(array_2(all, range(6, 7)));
+  dm_array2::box_type corner(array_2(range(3, 6), range(4, 7)));
+  dm_array2::box_type reversed(array_2(range(5, -1, -2), range(6, 0, -3)));
+  dm_array2::box_type* views[3] = { &column, &corner, &reversed };
+  
+  for(size_t v = 0; v < 3; ++v) {
+    const dm_array2::box_type& view = *views[v];
+    tsubspaceiterator<double, double*, size_t, ptrdiff_t, 2> ptr(subspace_begin(view));
+    tsubspaceiterator<double, double*, size_t, ptrdiff_t, 2> end(subspace_end(view));
+    size_t count = 0;
+    
+    for(; ptr != end; ++ptr, ++count) {
+      REQUIRE(&*ptr >= first);
+      REQUIRE(&*ptr < last);
+    }
+    REQUIRE(count == view.dim(0) * view.dim(1));
+    REQUIRE(ptr.position() == count);
+    REQUIRE(subspace_begin(view) + count == end);
+    
+    double total = 0.0;
+    subspace_for_each(subspace_begin(view), end, [&total](double value) { total += value; });
+    double expected = 0.0;
+    for(size_t i = 0; i < view.dim(0); ++i) {
+      for(size_t j = 0; j < view.dim(1); ++j) {
+        expected += view(i, j);
+      }}
+    REQUIRE(total == expected);
+  }
+  REQUIRE(column.dim(0) == 6);
+  REQUIRE(reversed.dim(1) == 2);
+}
+
+TEST_CASE("Sub-box views take ranges along every axis","[marray]") {
+  array<size_t, 3> index3;
+  index3[0] = 6; index3[1] = 5; index3[2] = 8;
+  dm_array3 array_3((trectlayout<3>(index3)));
+  for(size_t i = 0; i < 6; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      for(size_t k = 0; k < 8; ++k) {
+        array_3(i, j, k) = 100.0 * i + 10.0 * j + k;
+      }}}
+  
+  dm_array3::box_type box(array_3(range(1, 5), all, range(0, 8, 3)));
+  REQUIRE(box.dim(0) == 4);
+  REQUIRE(box.dim(1) == 5);
+  REQUIRE(box.dim(2) == 3);
+  REQUIRE(!box.layout().contiguous());
+  for(size_t i = 0; i < 4; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      for(size_t k = 0; k < 3; ++k) {
+        REQUIRE(&box(i, j, k) == &array_3(1 + i, j, 3 * k));
+        REQUIRE(box[i][j][k] == array_3(1 + i, j, 3 * k));
+      }}}
+  
+  dm_array3::box_type reversed(array_3(range(4, 0, -2), range(4, -1, -1), all));
+  REQUIRE(reversed.dim(0) == 2);
+  REQUIRE(reversed.dim(1) == 5);
+  REQUIRE(reversed.dim(2) == 8);
+  REQUIRE(reversed.begin().data() == &array_3(2, 0, 0));
+  REQUIRE(reversed.layout().footprint() == 2 * 5 * 8 + 8 * 5);
+  for(size_t i = 0; i < 2; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      for(size_t k = 0; k < 8; ++k) {
+        REQUIRE(&reversed(i, j, k) == &array_3(4 - 2 * i, 4 - j, k));
+        REQUIRE(reversed[i][j][k] == array_3(4 - 2 * i, 4 - j, k));
+      }}}
+  REQUIRE(&reversed.slice(1, 3)(1, 2) == &array_3(2, 1, 2));
+  
+  size_t count = 0;
+  for(
+    tsubspaceiterator<double, double*, size_t, ptrdiff_t, 3> ptr = subspace_begin(reversed); 
+    ptr != subspace_end(reversed); 
+    ++ptr, ++count
+  ) {
+    REQUIRE(*ptr == array_3(2 + 2 * (count / 40), count / 8 % 5, count % 8));
+  }
+  REQUIRE(count == 80);
+  
+  dm_array3::box_type halo(array_3(range(2, 4), all, all));
+  REQUIRE(halo.layout().contiguous());
+  REQUIRE(halo.begin().data() == &array_3(2, 0, 0));
+  REQUIRE(subspace_begin(halo).rank() == 1);
+  REQUIRE(array_3(range(2, 3), range(1, 2), all).layout().contiguous());
+  REQUIRE(!array_3(all, range(1, 3), all).layout().contiguous());
+  
+  dm_array3::box_type::box_type inner(halo(all, range(1, 4), range(2, 6)));
+  REQUIRE(&inner(1, 2, 3) == &array_3(3, 3, 5));
+  REQUIRE(array_3(range(3, 3), all, all).dim(0) == 0);
+  
+  dm_array3 dense(materialize(reversed));
+  REQUIRE(dense(1, 0, 7) == array_3(2, 4, 7));
+  
+  array<size_t, 2> index2;
+  index2[0] = 4; index2[1] = 6;
+  dm_array2 array_2((trectlayout<2>(index2)));
+  for(size_t i = 0; i < 4; ++i) {
+    for(size_t j = 0; j < 6; ++j) {
+      array_2(i, j) = 10.0 * i + j;
+    }}
+  dm_array2::box_type flipped(array_2(range(3, -1, -1), range(5, -1, -2)));
+  REQUIRE(flipped[0][0] == 35.0);
+  REQUIRE(flipped[3][2] == 1.0);
+  REQUIRE(accumulate(flipped.diagonal_begin(), flipped.diagonal_end(), 0.0) == 35.0 + 23.0 + 11.0);
+  flipped[1][1] = -1.0;
+  REQUIRE(array_2(2, 3) == -1.0);
+  
+  dm_array2::axis_slice_type::box_type every_other(array_2.slice(0, 1)(range(0, 6, 2)));
+  REQUIRE(every_other.dim(0) == 3);
+  REQUIRE(accumulate(every_other.stride_begin(), every_other.stride_end(), 0.0) == 30.0 + 6.0);
+  
+  const dm_array2& fixed(array_2);
+  dm_array2::const_box_type corner(fixed(range(2, 4), range(3, 6)));
+  static_assert(is_same<decltype(corner(0, 0)), const double&>::value, "sub-boxes of const arrays are read only");
+  static_assert(is_same<decltype(subbox(fixed, array<trange, 2>())(0, 0)), const double&>::value, "sub-boxes of const arrays are read only");
+  REQUIRE(&corner(1, 2) == &array_2(3, 5));
+  static_assert(!is_convertible<int, trange>::value, "a coordinate is not a range");
+  static_assert(tranges<trange, trange>::value && !tranges<trange, int>::value, "sub-boxes take only ranges");
+}
+
+TEST_CASE("Broadcast views repeat data along zero stride axes","[marray]") {
+  array<size_t, 2> index2;
+  index2[0] = 3; index2[1] = 4;
+  dm_array2 array_2((trectlayout<2>(index2)));
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 4; ++j) {
+      array_2(i, j) = 10.0 * i + j;
+    }}
+  
+  dm_array row(4);
+  for(size_t j = 0; j < 4; ++j) {
+    row[j] = 100.0 * j;
+  }
+  dm_array2::const_box_type rows(broadcast(row, shape(array_2)));
+  REQUIRE(rows.dim(0) == 3);
+  REQUIRE(rows.dim(1) == 4);
+  REQUIRE(rows.layout().stride<0>() == 0);
+  REQUIRE(!rows.layout().contiguous());
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 4; ++j) {
+      REQUIRE(&rows(i, j) == &row[j]);
+      REQUIRE(rows[i][j] + array_2(i, j) == 100.0 * j + 10.0 * i + j);
+    }}
+  
+  array<size_t, 2> column_index;
+  column_index[0] = 3; column_index[1] = 1;
+  dm_array2 column((trectlayout<2>(column_index)));
+  for(size_t i = 0; i < 3; ++i) {
+    column(i, 0) = -1.0 * i;
+  }
+  array<size_t, 2> common(broadcast_shape(shape(column), shape(array_2)));
+  REQUIRE(common[0] == 3);
+  REQUIRE(common[1] == 4);
+  dm_array2::const_box_type columns(broadcast(column, common));
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 4; ++j) {
+      REQUIRE(&columns(i, j) == &column(i, 0));
+    }}
+  
+  array<size_t, 3> index3;
+  index3[0] = 2; index3[1] = 3; index3[2] = 4;
+  array<size_t, 3> raised(broadcast_shape(shape(array_2), index3));
+  REQUIRE(raised[0] == 2);
+  REQUIRE(raised[2] == 4);
+  dm_array3::const_box_type stacked(broadcast(array_2, raised));
+  REQUIRE(&stacked(1, 2, 3) == &array_2(2, 3));
+  REQUIRE(&stacked(0, 2, 3) == &array_2(2, 3));
+  
+  double sum = 0.0;
+  size_t count = 0;
+  for(
+    tsubspaceiterator<const double, const double*, size_t, ptrdiff_t, 2> ptr = subspace_begin(rows); 
+    ptr != subspace_end(rows); 
+    ++ptr, ++count
+  ) {
+    sum += *ptr;
+  }
+  REQUIRE(count == 12);
+  REQUIRE(sum == 3 * 600.0);
+  
+  dm_array2 dense(materialize(columns));
+  REQUIRE(dense(2, 3) == -2.0);
+  dense(2, 3) = 5.0;
+  REQUIRE(column(2, 0) == -2.0);
+  static_assert(
+    is_same<decltype(rows(0, 0)), const double&>::value, "broadcast views give only read access");
+  static_assert(
+    is_same<decltype(broadcast(array_2, raised)), dm_array3::const_box_type>::value, "broadcast views give only read access");
+  
+  dm_array2::box_type reversed(array_2(range(2, -1, -1), all));
+  dm_array3::const_box_type stacked_reversed(broadcast(reversed, raised));
+  REQUIRE(&stacked_reversed(1, 0, 1) == &array_2(2, 1));
+}
+
+TEST_CASE("Reshaping views the same data where the strides allow","[marray]") {
+  array<size_t, 3> index3;
+  index3[0] = 2; index3[1] = 3; index3[2] = 4;
+  dm_array3 array_3((trectlayout<3>(index3)));
+  double x = 0.0;
+  for(dm_array3::iterator ptr = array_3.begin(); ptr != array_3.end(); ++ptr) {
+    *ptr = x++;
+  }
+  
+  treshaped<double, 1, double*, size_t, ptrdiff_t> flat(array_3.flatten());
+  REQUIRE(!flat.copied());
+  REQUIRE(flat.view.dim(0) == 24);
+  REQUIRE(flat.view.layout().contiguous());
+  for(size_t i = 0; i < 24; ++i) {
+    REQUIRE(&flat.view[i] == array_3.begin().data() + i);
+  }
+  
+  array<size_t, 2> extents2 = {{6, 4}};
+  treshaped<double, 2, double*, size_t, ptrdiff_t> grid(flat.view.reshape(extents2));
+  REQUIRE(!grid.copied());
+  REQUIRE(&grid.view(5, 3) == &array_3(1, 2, 3));
+  
+  array<size_t, 4> extents4 = {{2, 1, 12, 1}};
+  treshaped<double, 4, double*, size_t, ptrdiff_t> padded(array_3.reshape(extents4));
+  REQUIRE(!padded.copied());
+  REQUIRE(&padded.view(1, 0, 7, 0) == &array_3(1, 1, 3));
+  
+  dm_array3::box_type every_other(array_3(all, all, range(0, 4, 2)));
+  array<size_t, 2> extents_pairs = {{6, 2}};
+  treshaped<double, 2, double*, size_t, ptrdiff_t> pairs(every_other.reshape(extents_pairs));
+  REQUIRE(!pairs.copied());
+  REQUIRE(&pairs.view(4, 1) == &array_3(1, 1, 2));
+  
+  treshaped<double, 1, double*, size_t, ptrdiff_t> flat_pairs(every_other.flatten());
+  REQUIRE(!flat_pairs.copied());
+  REQUIRE(flat_pairs.view.layout().stride<0>() == 2);
+  
+  dm_array3::box_type leading(array_3(all, all, range(0, 3)));
+  treshaped<double, 1, double*, size_t, ptrdiff_t> flat_leading(leading.flatten());
+  REQUIRE(flat_leading.copied());
+  for(size_t i = 0; i < 18; ++i) {
+    REQUIRE(flat_leading.view[i] == array_3(i / 9, i / 3 % 3, i % 3));
+  }
+  
+  tmultiarray<double, 3, double*, size_t, ptrdiff_t, true, trectlayoutref<3, 3> > transposed(array_3.transpose());
+  array<size_t, 2> extents_t = {{12, 2}};
+  treshaped<double, 2, double*, size_t, ptrdiff_t> split(transposed.reshape(extents_t));
+  REQUIRE(split.copied());
+  REQUIRE(split.view(0, 1) == array_3(1, 0, 0));
+  REQUIRE(split.view(11, 0) == array_3(0, 2, 3));
+  
+  treshaped<double, 2, double*, size_t, ptrdiff_t> moved(std::move(split));
+  REQUIRE(moved.copied());
+  REQUIRE(moved.view(11, 1) == array_3(1, 2, 3));
+  
+  array<size_t, 4> extents_tt = {{2, 2, 3, 2}};
+  treshaped<double, 4, double*, size_t, ptrdiff_t> split_columns(transposed.reshape(extents_tt));
+  REQUIRE(!split_columns.copied());
+  REQUIRE(&split_columns.view(1, 1, 2, 1) == &array_3(1, 2, 3));
+  REQUIRE(&split_columns.view(0, 1, 2, 0) == &array_3(0, 2, 1));
+}
@@ -0,0 +1,89 @@
+/*
+ *    numatest.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <multiarray.h>
+#include <numa.h>
+#include <catch/catch.hpp>
+
+using namespace marray;
+using namespace std;
+
+typedef taligned_allocator<double, PAGE_BYTES> page_allocator;
+typedef tmultiarray<double, 2, double*, size_t, ptrdiff_t, false, trectlayout<2>, page_allocator> page_array2;
+
+/*
+Checks that the slabs cover [0, rows) in order.
+*/
+void
+require_cover(const vector<tnumaslab>& slabs, size_t rows) {
+  size_t next(0);
+  
+  for(size_t s = 0; s < slabs.size(); ++s) {
+    REQUIRE(slabs[s].begin == next);
+    REQUIRE(slabs[s].begin < slabs[s].end);
+    next = slabs[s].end;
+  }
+  REQUIRE(next == rows);
+}
+
+TEST_CASE("Placed arrays hold their values wherever their pages land","[numa]") {
+  vector<int> nodes(numa_nodes());
+  REQUIRE(!nodes.empty());
+  
+  array<size_t, 2> index2;
+  index2[0] = 64; index2[1] = 1024;
+  
+  page_array2 interleaved(trectlayout<2>(index2), tnumaplacement(tnumaplacement::INTERLEAVE), 1.0);
+  page_array2 slabs(trectlayout<2>(index2), tnumaplacement(tnumaplacement::SLABS), 2.0);
+  
+  for(size_t i = 0; i < 64; ++i) {
+    for(size_t j = 0; j < 1024; ++j) {
+      REQUIRE(interleaved(i, j) == 1.0);
+      REQUIRE(slabs(i, j) == 2.0);
+    }}
+  
+  vector<tnumaslab> placed(numa_slabs(slabs));
+  require_cover(placed, 64);
+  require_cover(numa_slabs(interleaved), 64);
+  
+  if(numa_available() && nodes.size() == 1) {
+    REQUIRE(placed.size() == 1);
+    REQUIRE(placed[0].node == nodes[0]);
+  }
+}
+
+TEST_CASE("Placed one dimensional arrays report their nodes by element","[numa]") {
+  tarray<double> array_(5000, tnumaplacement(tnumaplacement::SLABS), 3.0);
+  
+  for(size_t i = 0; i < array_.dim(); ++i) {
+    REQUIRE(array_[i] == 3.0);
+  }
+  require_cover(numa_slabs(array_), 5000);
+}
+
+TEST_CASE("Placement leaves alone pages the array shares with other data","[numa]") {
+  vector<double> data(4 * page_elements<double>());
+  double* page = data.data() + (page_elements<double>() - page_skew(data.data()));
+  auto by_element = [](size_t i) { return i * sizeof(double); };
+
+  REQUIRE(numa_place(page + 1, 100 * sizeof(double), tnumaplacement(tnumaplacement::INTERLEAVE), 100, by_element));
+  REQUIRE(numa_place(page + 1, 100 * sizeof(double), tnumaplacement(tnumaplacement::SLABS), 100, by_element));
+  REQUIRE(numa_slabs(page, 2 * page_elements<double>(), by_element).size() >= 1);
+}
@@ -0,0 +1,109 @@
+/*
+ *    paralleltest.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <multiarray.h>
+#include <parallel.h>
+#include <atomic>
+#include <catch/catch.hpp>
+
+using namespace marray;
+using namespace std;
+
+TEST_CASE("Block ranges split data into whole granules","[parallel]") {
+  for(size_t n = 0; n < 50; ++n) {
+    for(size_t parts = 1; parts < 6; ++parts) {
+      size_t next(0);
+      
+      for(size_t part = 0; part < parts; ++part) {
+        pair<size_t, size_t> range = block_range(n, parts, part, 4);
+        REQUIRE(range.first == next);
+        REQUIRE(range.first <= range.second);
+        if(range.second < n) {
+          REQUIRE(range.second % 4 == 0);
+        }
+        next = range.second;
+      }
+      REQUIRE(next == n);
+    }}
+  
+  REQUIRE(block_range(10, 3, 0) == make_pair(size_t(0), size_t(4)));
+  REQUIRE(block_range(10, 3, 1) == make_pair(size_t(4), size_t(7)));
+  REQUIRE(block_range(10, 3, 2) == make_pair(size_t(7), size_t(10)));
+}
+
+TEST_CASE("Skewed block ranges put their boundaries on the granules of the data","[parallel]") {
+  for(size_t n = 0; n < 50; ++n) {
+    for(size_t parts = 1; parts < 6; ++parts) {
+      for(size_t skew = 0; skew < 4; ++skew) {
+        size_t next(0);
+
+        for(size_t part = 0; part < parts; ++part) {
+          pair<size_t, size_t> range = block_range(n, parts, part, 4, skew);
+          REQUIRE(range.first == next);
+          REQUIRE(range.first <= range.second);
+          if(range.second < n) {
+            REQUIRE((range.second + skew) % 4 == 0);
+          }
+          next = range.second;
+        }
+        REQUIRE(next == n);
+      }}}
+
+  vector<double> data(3 * page_elements<double>());
+  const double* page = data.data() + (page_elements<double>() - page_skew(data.data()));
+  REQUIRE(reinterpret_cast<uintptr_t>(page) % PAGE_BYTES == 0);
+  REQUIRE(page_skew(page) == 0);
+  REQUIRE(page_skew(page + 3) == 3);
+}
+
+TEST_CASE("Blocks are each handed to one thread","[parallel]") {
+  vector<atomic<int> > visits(1000);
+  
+  for(size_t i = 0; i < visits.size(); ++i) {
+    visits[i] = 0;
+  }
+  for_each_block(visits.size(), 4, 16, [&visits](size_t begin, size_t end) {
+    for(size_t i = begin; i < end; ++i) {
+      ++visits[i];
+    }
+  });
+  for(size_t i = 0; i < visits.size(); ++i) {
+    REQUIRE(visits[i] == 1);
+  }
+}
+
+TEST_CASE("First touch construction fills the whole array","[parallel]") {
+  array<size_t, 3> index3;
+  index3[0] = 20; index3[1] = 30; index3[2] = 40; 
+  
+  tmultiarray<double, 3> array_3(trectlayout<3>(index3), tfirsttouch(3), 2.5);
+  REQUIRE(array_3.end() - array_3.begin() == 24000);
+  for(tmultiarray<double, 3>::iterator ptr = array_3.begin(); ptr != array_3.end(); ++ptr) {
+    REQUIRE(*ptr == 2.5);
+  }
+  
+  array<size_t, 2> index2;
+  index2[0] = 3; index2[1] = 5;
+  tmultiarray<double, 2> array_2((trectlayout<2>(index2)), tfirsttouch());
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      REQUIRE(array_2(i, j) == 0.0);
+    }}
+}
@@ -0,0 +1,210 @@
+/*
+ *    reductiontest.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <reduction.h>
+#include <cmath>
+#include <catch/catch.hpp>
+#include "fixtures.h"
+
+using namespace marray;
+using namespace std;
+using fixtures::make_array3;
+
+typedef tmultiarray<double, 3> dm_array3;
+typedef tmultiarray<double, 2> dm_array2;
+
+namespace {
+  const summation_type all_summations[] = { SUM_NAIVE, SUM_PAIRWISE, SUM_KAHAN };
+
+  /*
+  Checks sum, min, max, mean and argmax over each axis of a view against loops over its
+  elements by coordinates.  The elements are small integers, so every summation is exact.
+  */
+  template<typename X>
+  void
+  check_axes(const X& view) {
+    for(size_t axis = 0; axis < 3; ++axis) {
+      size_t a = axis == 0 ? 1 : 0, b = axis == 2 ? 1 : 2;
+      dm_array2 low(min(view, axis)), high(max(view, axis)), average(mean(view, axis));
+      tmultiarray<size_t, 2> where(argmax(view, axis));
+
+      for(size_t k = 0; k < sizeof(all_summations) / sizeof(all_summations[0]); ++k) {
+        dm_array2 total(sum(view, axis, all_summations[k]));
+
+        REQUIRE(total.dim(0) == view.dim(a));
+        REQUIRE(total.dim(1) == view.dim(b));
+        for(size_t i = 0; i < view.dim(a); ++i) {
+          for(size_t j = 0; j < view.dim(b); ++j) {
+            double expected(0.0);
+            array<size_t, 3> idx;
+
+            idx[a] = i;
+            idx[b] = j;
+            for(idx[axis] = 0; idx[axis] < view.dim(axis); ++idx[axis]) {
+              expected += view(idx);
+            }
+            REQUIRE(total(i, j) == expected);
+          }}
+      }
+
+      for(size_t i = 0; i < view.dim(a); ++i) {
+        for(size_t j = 0; j < view.dim(b); ++j) {
+          double expected_low(1e300), expected_high(-1e300), total(0.0);
+          size_t expected_where(0);
+          array<size_t, 3> idx;
+
+          idx[a] = i;
+          idx[b] = j;
+          for(idx[axis] = 0; idx[axis] < view.dim(axis); ++idx[axis]) {
+            expected_low = view(idx) < expected_low ? view(idx) : expected_low;
+            if(view(idx) > expected_high) {
+              expected_high = view(idx);
+              expected_where = idx[axis];
+            }
+            total += view(idx);
+          }
+          REQUIRE(low(i, j) == expected_low);
+          REQUIRE(high(i, j) == expected_high);
+          REQUIRE(where(i, j) == expected_where);
+          REQUIRE(average(i, j) == Approx(total / view.dim(axis)));
+        }}
+    }
+  }
+}
+
+TEST_CASE("Reductions along each axis of dense arrays and views", "[reduction]") {
+  dm_array3 array_3(make_array3(6, 7, 300));
+
+  check_axes(array_3);
+
+  array<size_t, 3> order = {{2, 0, 1}};
+  check_axes(array_3.permute(order));
+
+  dm_array3::box_type reversed(array_3(range(5, 0, -2), range(6, -1, -1), range(3, 290, 3)));
+  check_axes(reversed);
+  check_axes(array_3(all, all, range(299, -1, -1)));
+}
+
+TEST_CASE("Reductions over sets of axes keep the others in order", "[reduction]") {
+  dm_array3 array_3(make_array3(5, 4, 70));
+  array<size_t, 2> outer = {{0, 1}}, ends = {{2, 0}};
+
+  tmultiarray<double, 1> by_column(sum(array_3, outer)), by_row(sum(array_3, ends));
+  tmultiarray<double, 1> least(min(array_3, ends)), most(max(array_3, outer));
+  tmultiarray<double, 1> average(mean(array_3, ends, SUM_KAHAN));
+
+  REQUIRE(by_column.dim(0) == 70);
+  REQUIRE(by_row.dim(0) == 4);
+  for(size_t k = 0; k < 70; ++k) {
+    double expected(0.0), expected_most(-1e300);
+    for(size_t i = 0; i < 5; ++i) {
+      for(size_t j = 0; j < 4; ++j) {
+        expected += array_3(i, j, k);
+        expected_most = array_3(i, j, k) > expected_most ? array_3(i, j, k) : expected_most;
+      }}
+    REQUIRE(by_column[k] == expected);
+    REQUIRE(most[k] == expected_most);
+  }
+  for(size_t j = 0; j < 4; ++j) {
+    double expected(0.0), expected_least(1e300);
+    for(size_t i = 0; i < 5; ++i) {
+      for(size_t k = 0; k < 70; ++k) {
+        expected += array_3(i, j, k);
+        expected_least = array_3(i, j, k) < expected_least ? array_3(i, j, k) : expected_least;
+      }}
+    REQUIRE(by_row[j] == expected);
+    REQUIRE(least[j] == expected_least);
+    REQUIRE(average[j] == Approx(expected / 350));
+  }
+
+  array<size_t, 3> empty_dims = {{0, 4, 3}};
+  dm_array3 empty((trectlayout<3>(empty_dims)));
+  dm_array2 zeros(sum(empty, 0));
+  REQUIRE(zeros.dim(0) == 4);
+  REQUIRE(zeros(3, 2) == 0.0);
+  REQUIRE(sum(empty, 1).dim(0) == 0);
+}
+
+TEST_CASE("Pairwise and compensated summation bound the error on long axes", "[reduction]") {
+  const size_t n = (1 << 20) + 77;
+  array<size_t, 2> dims = {{2, n}}, transposed_dims = {{n, 2}};
+  tmultiarray<float, 2> along((trectlayout<2>(dims))), across((trectlayout<2>(transposed_dims)));
+
+  for(size_t i = 0; i < n; ++i) {
+    along(0, i) = across(i, 0) = 0.1f;
+    along(1, i) = across(i, 1) = (i % 2) ? 1e4f : 1e-3f;
+  }
+  const double expected[2] = { double(0.1f) * n, (1e4 * (n / 2) + double(1e-3f) * (n - n / 2)) };
+
+  for(size_t k = 1; k < sizeof(all_summations) / sizeof(all_summations[0]); ++k) {
+    tmultiarray<float, 1> runs(sum(along, 1, all_summations[k])), rows(sum(across, 0, all_summations[k]));
+
+    for(size_t j = 0; j < 2; ++j) {
+      REQUIRE(fabs(runs[j] - expected[j]) / expected[j] < 1e-6);
+      REQUIRE(fabs(rows[j] - expected[j]) / expected[j] < 1e-6);
+    }
+  }
+
+  tmultiarray<float, 1> sequential(sum(across, 0, SUM_NAIVE));
+  REQUIRE(fabs(sequential[0] - expected[0]) / expected[0] > 1e-3);
+}
+
+TEST_CASE("Reductions agree on every instruction set", "[reduction]") {
+  array<size_t, 3> dims = {{3, 9, 133}};
+  tmultiarray<int32_t, 3> array_3((trectlayout<3>(dims)));
+  simd_isa previous = simd_active();
+
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 9; ++j) {
+      for(size_t k = 0; k < 133; ++k) {
+        array_3(i, j, k) = int32_t((i * 1009 + j * 101 + k * 13) % 211) - 105;
+      }}}
+  simd_use(SIMD_SCALAR);
+  tmultiarray<int32_t, 2> total(sum(array_3, 2, SUM_NAIVE)), low(min(array_3, 2)), high(max(array_3, 0));
+
+  for(int isa = SIMD_SSE2; isa <= SIMD_AVX512; ++isa) {
+    simd_use(simd_isa(isa));
+    tmultiarray<int32_t, 2> other_total(sum(array_3, 2, SUM_PAIRWISE)), other_low(min(array_3, 2)), other_high(max(array_3, 0));
+
+    REQUIRE(std::equal(total.begin().data(), total.end().data(), other_total.begin().data()));
+    REQUIRE(std::equal(low.begin().data(), low.end().data(), other_low.begin().data()));
+    REQUIRE(std::equal(high.begin().data(), high.end().data(), other_high.begin().data()));
+  }
+  simd_use(previous);
+}
+
+TEST_CASE("Means of integers add up without overflow", "[reduction]") {
+  array<size_t, 2> dims = {{3, 301}};
+  tmultiarray<int32_t, 2> big((trectlayout<2>(dims)));
+
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 301; ++j) {
+      big(i, j) = 2000000000 - int32_t(i * 1000 + j % 2);
+    }}
+  for(size_t k = 0; k < sizeof(all_summations) / sizeof(all_summations[0]); ++k) {
+    tmultiarray<double, 1> runs(mean(big, 1, all_summations[k])), rows(mean(big, 0, all_summations[k]));
+
+    for(size_t i = 0; i < 3; ++i) {
+      REQUIRE(runs[i] == 2e9 - 1000.0 * i - 150.0 / 301.0);
+    }
+    REQUIRE(rows[0] == 2e9 - 1000.0);
+    REQUIRE(rows[1] == 2e9 - 1001.0);
+  }
+}
@@ -0,0 +1,241 @@
+/*
+ *    simdtest.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <simd.h>
+#include <array.h>
+#include <expression.h>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <catch/catch.hpp>
+
+using namespace marray;
+using namespace std;
+
+namespace {
+  const simd_isa all_isas[] = { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512 };
+
+  template<typename T>
+  T
+  sample(size_t i, size_t seed) {
+    return static_cast<T>(static_cast<int>((i * 7919 + seed * 104729) % 23) - 11) / T(is_floating_point<T>::value ? 4 : 1);
+  }
+
+  /*
+  Puts NaN and zeros of both signs into the operands of floating point kernels, both within
+  the first vector and past it, where min, max and select see operands that do not compare or
+  compare equal.
+  */
+  template<typename T, typename A>
+  typename enable_if<is_floating_point<T>::value>::type
+  add_specials(A& a, A& b) {
+    const T nan = numeric_limits<T>::quiet_NaN();
+    for(size_t base = 5; base < 60; base += 27) {
+      a[base] = nan;
+      b[base + 1] = nan;
+      a[base + 2] = nan;
+      b[base + 2] = nan;
+      a[base + 3] = T(-0.0);
+      b[base + 3] = T(0.0);
+      a[base + 4] = T(0.0);
+      b[base + 4] = T(-0.0);
+      a[base + 5] = T(-0.0);
+      b[base + 5] = T(-0.0);
+    }
+  }
+
+  template<typename T, typename A>
+  typename enable_if<!is_floating_point<T>::value>::type
+  add_specials(A&, A&) {}
+
+  /*
+  Whether two results are the same: equal with the same sign, or both NaN.
+  */
+  template<typename T>
+  bool
+  same(T x, T y) {
+    return x != x ? y != y : x == y && signbit(double(x)) == signbit(double(y));
+  }
+
+  /*
+  Checks every kernel against the scalar operations, over weak arrays starting at each
+  offset into the data, so that the head, body and tail of each kernel are all exercised.
+  */
+  template<typename T>
+  void
+  check_kernels(simd_isa isa) {
+    typedef tarray<T> array_type;
+    typedef tarray<T, T*, true> view_type;
+    const size_t capacity = 80;
+    array_type a(capacity), b(capacity), c(capacity), d(capacity), to(capacity);
+
+    for(size_t i = 0; i < capacity; ++i) {
+      a[i] = sample<T>(i, 1);
+      b[i] = sample<T>(i, 2);
+      c[i] = sample<T>(i, 3);
+      d[i] = sample<T>(i, 4);
+    }
+    add_specials<T>(a, b);
+    INFO("instruction set " << isa);
+    for(size_t offset = 0; offset < 4; ++offset) {
+      for(size_t n = 0; offset + n <= capacity; n += (n < 40 ? 1 : 7)) {
+        view_type va(a.begin() + offset, n), vb(b.begin() + offset, n), vc(c.begin() + offset, n),
+          vd(d.begin() + offset, n), vto(to.begin() + offset, n);
+        if(offset + n < capacity) {
+          to[offset + n] = T(1000);
+        }
+
+        elementwise_add(vto, va, vb);
+        for(size_t i = 0; i < n; ++i) {
+          REQUIRE(same(vto[i], T(va[i] + vb[i])));
+        }
+        elementwise_mul(vto, va, vb);
+        for(size_t i = 0; i < n; ++i) {
+          REQUIRE(same(vto[i], T(va[i] * vb[i])));
+        }
+        elementwise_fma(vto, va, vb, vc);
+        for(size_t i = 0; i < n; ++i) {
+          T v[3] = { va[i], vb[i], vc[i] };
+          REQUIRE(same(vto[i], tfma::apply(v)));
+        }
+        elementwise_min(vto, va, vb);
+        for(size_t i = 0; i < n; ++i) {
+          REQUIRE(same(vto[i], va[i] < vb[i] ? va[i] : vb[i]));
+        }
+        elementwise_max(vto, va, vb);
+        for(size_t i = 0; i < n; ++i) {
+          REQUIRE(same(vto[i], va[i] > vb[i] ? va[i] : vb[i]));
+        }
+        elementwise_abs(vto, va);
+        for(size_t i = 0; i < n; ++i) {
+          T v[1] = { va[i] };
+          REQUIRE(same(vto[i], tabs::apply(v)));
+          REQUIRE(!signbit(double(vto[i])));
+        }
+        elementwise_select_less(vto, va, vb, vc, vd);
+        for(size_t i = 0; i < n; ++i) {
+          REQUIRE(same(vto[i], va[i] < vb[i] ? vc[i] : vd[i]));
+        }
+        elementwise_fill(vto, T(7));
+        for(size_t i = 0; i < n; ++i) {
+          REQUIRE(vto[i] == T(7));
+        }
+        if(offset + n < capacity) {
+          REQUIRE(to[offset + n] == T(1000));
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Elementwise kernels agree with the scalar operations on every instruction set", "[simd]") {
+  simd_isa previous = simd_active();
+
+  for(size_t k = 0; k < sizeof(all_isas) / sizeof(all_isas[0]); ++k) {
+    simd_use(all_isas[k]);
+    REQUIRE(simd_active() <= all_isas[k]);
+    REQUIRE(simd_active() <= simd_supported());
+    check_kernels<float>(simd_active());
+    check_kernels<double>(simd_active());
+    check_kernels<int32_t>(simd_active());
+  }
+  simd_use(previous);
+  REQUIRE(simd_active() == previous);
+}
+
+TEST_CASE("Elementwise kernels work in place and on types without vector kernels", "[simd]") {
+  tarray<double> a(37), b(37);
+  tarray<long> x(37), y(37);
+
+  for(size_t i = 0; i < 37; ++i) {
+    a[i] = -double(i);
+    b[i] = 0.5 * i;
+    x[i] = -long(i);
+    y[i] = 2 * long(i);
+  }
+  elementwise_fma(a, a, a, b);
+  elementwise_abs(b, b);
+  elementwise_max(x, x, y);
+  for(size_t i = 0; i < 37; ++i) {
+    REQUIRE(a[i] == double(i) * i + 0.5 * i);
+    REQUIRE(b[i] == 0.5 * i);
+    REQUIRE(x[i] == 2 * long(i));
+  }
+}
+
+TEST_CASE("Sums and products of dense arrays go through the kernels", "[simd]") {
+  array<size_t, 2> dims = {{5, 13}};
+  tmultiarray<float, 2> a((trectlayout<2>(dims))), b((trectlayout<2>(dims))), c((trectlayout<2>(dims)));
+
+  for(size_t i = 0; i < 5; ++i) {
+    for(size_t j = 0; j < 13; ++j) {
+      a(i, j) = float(i) - 2.5f * j;
+      b(i, j) = 0.25f * (i + j);
+    }}
+
+  c = a + b;
+  for(size_t i = 0; i < 5; ++i) {
+    for(size_t j = 0; j < 13; ++j) {
+      REQUIRE(c(i, j) == a(i, j) + b(i, j));
+    }}
+
+  c = a * b;
+  for(size_t i = 0; i < 5; ++i) {
+    for(size_t j = 0; j < 13; ++j) {
+      REQUIRE(c(i, j) == a(i, j) * b(i, j));
+    }}
+
+  elementwise_min(c, a, b);
+  REQUIRE(c(4, 0) == 1.0f);
+  REQUIRE(c(0, 12) == -30.0f);
+
+  REQUIRE(dense_data(a));
+  REQUIRE(dense_data(a(range(1, 3), all)));
+  REQUIRE(!dense_data(a(all, range(1, 3))));
+  REQUIRE(!dense_data(a.transpose()));
+  REQUIRE(dense_data(tarray<float>(4)));
+}
+
+TEST_CASE("Arrays of static extents go through the kernels", "[simd]") {
+  typedef tstaticlayout<textents<5, 13> > fixed_layout2;
+  typedef tmultiarray<float, 2, float*, size_t, ptrdiff_t, false, fixed_layout2> fixed_array2;
+  fixed_array2 a((fixed_layout2())), b((fixed_layout2())), c((fixed_layout2()));
+
+  for(size_t i = 0; i < 5; ++i) {
+    for(size_t j = 0; j < 13; ++j) {
+      a(i, j) = float(i) - 2.5f * j;
+      b(i, j) = 0.25f * (i + j);
+    }}
+
+  REQUIRE(dense_data(a));
+  REQUIRE((a + b).flat());
+  REQUIRE(flat_kernel(c.begin().data(), a * b, 65));
+  for(size_t i = 0; i < 5; ++i) {
+    for(size_t j = 0; j < 13; ++j) {
+      REQUIRE(c(i, j) == a(i, j) * b(i, j));
+    }}
+
+  c = a + b;
+  elementwise_max(c, c, a);
+  for(size_t i = 0; i < 5; ++i) {
+    for(size_t j = 0; j < 13; ++j) {
+      REQUIRE(c(i, j) == std::max(a(i, j) + b(i, j), a(i, j)));
+    }}
+}
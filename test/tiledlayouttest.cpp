@@ -0,0 +1,143 @@
+/*
+ *    tiledlayouttest.cpp
+ *
+ *    Copyright 2008 E. Onono <etuka@persistentnotions.co.uk>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <tiledlayout.h>
+#include <type_traits>
+#include <catch/catch.hpp>
+
+using namespace marray;
+using namespace std;
+
+typedef ttiledlayout<2> tiled_layout2;
+typedef ttiledlayout<3> tiled_layout3;
+typedef tmultiarray<double, 2, double*, size_t, ptrdiff_t, false, tiled_layout2> dt_array2;
+typedef tmultiarray<double, 3, double*, size_t, ptrdiff_t, false, tiled_layout3> dt_array3;
+
+TEST_CASE("Tiled layouts store each tile contiguously","[tiled]") {
+  array<size_t, 2> index2, tile2;
+  index2[0] = 5; index2[1] = 6;
+  tile2[0] = 2; tile2[1] = 4;
+  
+  tiled_layout2 layout2(index2, tile2);
+  
+  REQUIRE(layout2.dim(0) == 5);
+  REQUIRE(layout2.dim(1) == 6);
+  REQUIRE(layout2.tiles(0) == 3);
+  REQUIRE(layout2.tiles(1) == 2);
+  REQUIRE(layout2.tile_footprint() == 8);
+  REQUIRE(layout2.footprint() == 48);
+  
+  REQUIRE(layout2.get_stride(0, 0) == 0);
+  REQUIRE(layout2.get_stride(0, 3) == 3);
+  REQUIRE(layout2.get_stride(1, 0) == 4);
+  REQUIRE(layout2.get_stride(0, 4) == 8);
+  REQUIRE(layout2.get_stride(2, 0) == 16);
+  REQUIRE(layout2.get_stride(4, 5) == 41);
+}
+
+TEST_CASE("Tiled multiarrays index and slice by logical axes","[tiled]") {
+  array<size_t, 3> index3, tile3;
+  index3[0] = 3; index3[1] = 5; index3[2] = 6;
+  tile3[0] = 2; tile3[1] = 2; tile3[2] = 4;
+  
+  dt_array3 array_3(tiled_layout3(index3, tile3));
+  
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      for(size_t k = 0; k < 6; ++k) {
+        array_3(i, j, k) = 100.0 * i + 10.0 * j + k;
+      }}}
+  
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      for(size_t k = 0; k < 6; ++k) {
+        REQUIRE(array_3[i][j][k] == 100.0 * i + 10.0 * j + k);
+      }}}
+}
+
+TEST_CASE("Tile iterators hand out every tile as a dense block","[tiled]") {
+  array<size_t, 2> index2, tile2;
+  index2[0] = 5; index2[1] = 6;
+  tile2[0] = 2; tile2[1] = 4;
+  
+  dt_array2 array_2(tiled_layout2(index2, tile2));
+  
+  for(size_t i = 0; i < 5; ++i) {
+    for(size_t j = 0; j < 6; ++j) {
+      array_2(i, j) = 10.0 * i + j;
+    }}
+  
+  size_t tiles = 0, points = 0;
+  for(
+    ttileiterator<double, 2> ptr = tiles_begin(array_2);
+    ptr != tiles_end(array_2);
+    ++ptr, ++tiles
+  ) {
+    ttileiterator<double, 2>::value_type tile = *ptr;
+    array<size_t, 2> origin = ptr.origin(), extents = ptr.extents();
+    
+    REQUIRE(tile.dim(0) == 2);
+    REQUIRE(tile.dim(1) == 4);
+    REQUIRE(tile.begin() - array_2.begin() == 8 * tiles);
+    
+    for(size_t i = 0; i < extents[0]; ++i) {
+      for(size_t j = 0; j < extents[1]; ++j, ++points) {
+        REQUIRE(tile(i, j) == 10.0 * (origin[0] + i) + origin[1] + j);
+      }}
+  }
+  REQUIRE(tiles == 6);
+  REQUIRE(points == 30);
+}
+
+TEST_CASE("Tile iterators walk arrays of any allocator, and const arrays read only","[tiled]") {
+  typedef tmultiarray<double, 2, double*, size_t, ptrdiff_t, false, tiled_layout2, taligned_allocator<double> > aligned_array2;
+  array<size_t, 2> index2, tile2;
+  index2[0] = 5; index2[1] = 6;
+  tile2[0] = 2; tile2[1] = 4;
+  
+  aligned_array2 array_2(tiled_layout2(index2, tile2));
+  for(size_t i = 0; i < 5; ++i) {
+    for(size_t j = 0; j < 6; ++j) {
+      array_2(i, j) = 10.0 * i + j;
+    }}
+  
+  size_t tiles = 0;
+  for(ttileiterator<double, 2> ptr = tiles_begin(array_2); ptr != tiles_end(array_2); ++ptr, ++tiles) {
+    (*ptr)(0, 0) += 1000.0;
+  }
+  REQUIRE(tiles == 6);
+  REQUIRE(array_2(2, 4) == 1024.0);
+  
+  const aligned_array2& fixed(array_2);
+  double total = 0.0;
+  for(
+    ttileiterator<const double, 2, const double*> ptr = tiles_begin(fixed);
+    ptr != tiles_end(fixed);
+    ++ptr
+  ) {
+    static_assert(is_same<decltype((*ptr)(0, 0)), const double&>::value, "tiles of const arrays are read only");
+    array<size_t, 2> extents = ptr.extents();
+    for(size_t i = 0; i < extents[0]; ++i) {
+      for(size_t j = 0; j < extents[1]; ++j) {
+        total += (*ptr)(i, j);
+      }}
+  }
+  REQUIRE(total == 6 * 1000.0 + 6 * 10.0 * (0 + 1 + 2 + 3 + 4) + 5 * (0 + 1 + 2 + 3 + 4 + 5));
+}